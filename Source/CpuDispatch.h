@@ -0,0 +1,149 @@
+/*
+  ==============================================================================
+
+    Runtime instruction set dispatch for the enhancer kernels.
+
+    Every kernel is built once per instruction set and the processor picks
+    the best one the CPU supports in prepareToPlay, so one binary runs on
+    SSE2-only machines and uses AVX2 where it exists. The AVX2 copy is
+    EnhancerKernelAVX2.cpp, which switches the target to AVX2 and FMA only
+    after JUCE, the standard library and this header are included.
+
+    The processor lays its filter state out for JUCE's 128 bit SIMDRegister,
+    so the AVX2 copy keeps those lanes. It gains from VEX encoding, fused
+    multiply-add and the larger register file, not from wider vectors, and
+    there is no AVX-512 copy: without 512 bit lanes it would only be the
+    AVX2 code again. On ARM the build target decides: NEON is the baseline
+    on AArch64 (the LinuxMakefileAArch64 exporter) and on ARMv7 builds that
+    enable it.
+
+    The restriction: an inline helper the AVX2 copy emits out of line is
+    merged with the baseline's copy by the linker, and either may win. So
+    helpers must keep the baseline target, and the kernel entry points
+    inline everything they call. Only GCC and Clang guarantee both, with a
+    target pragma and flatten. MSVC has neither, /arch:AVX2 applies to the
+    whole file, and debug builds do not inline, so those builds only run
+    the baseline.
+
+    BASS_ENHANCER_ISA=sse2|avx2 in the environment forces a path in any
+    host, setInstructionSetOverride() does the same per instance.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+enum InstructionSet
+{
+	// SSE2 on x86, NEON on ARM, whatever the plugin is built for elsewhere
+	INSTRUCTION_SET_BASELINE = 0,
+	INSTRUCTION_SET_AVX2,
+	N_INSTRUCTION_SETS
+};
+
+#if JUCE_INTEL && ! JUCE_DEBUG && (JUCE_GCC || JUCE_CLANG)
+ #define BASS_ENHANCER_MULTI_TARGET 1
+#else
+ #define BASS_ENHANCER_MULTI_TARGET 0
+#endif
+
+// Kernel entry points inline every stage and helper where the compiler can be told to
+#if JUCE_GCC || JUCE_CLANG
+ #define BASS_ENHANCER_FLATTEN __attribute__((flatten))
+#else
+ #define BASS_ENHANCER_FLATTEN
+#endif
+
+//==============================================================================
+namespace CpuDispatch
+{
+	inline const char* getName(int instructionSet)
+	{
+		switch (instructionSet)
+		{
+			case INSTRUCTION_SET_AVX2: return "AVX2";
+			default: break;
+		}
+
+	#if JUCE_INTEL
+		return "SSE2";
+	#elif JUCE_USE_ARM_NEON
+		return "NEON";
+	#else
+		return "Generic";
+	#endif
+	}
+
+	inline bool isBuilt(int instructionSet)
+	{
+		return instructionSet == INSTRUCTION_SET_BASELINE || (BASS_ENHANCER_MULTI_TARGET && juce::isPositiveAndBelow(instructionSet, (int)N_INSTRUCTION_SETS));
+	}
+
+	inline bool isSupported(int instructionSet)
+	{
+		if (!isBuilt(instructionSet))
+			return false;
+
+		using Stats = juce::SystemStats;
+
+		switch (instructionSet)
+		{
+			case INSTRUCTION_SET_AVX2:
+				return Stats::hasAVX2() && Stats::hasFMA3();
+
+			default:
+				return true;
+		}
+	}
+
+	// Case insensitive, "avx2" and "AVX-2" both work. -1 when unknown.
+	inline int findByName(const juce::String& name)
+	{
+		const juce::String key = name.removeCharacters("-_ ").toLowerCase();
+
+		if (key.isEmpty())
+			return -1;
+
+		for (int instructionSet = 0; instructionSet < N_INSTRUCTION_SETS; ++instructionSet)
+			if (key == juce::String(getName(instructionSet)).removeCharacters("-").toLowerCase())
+				return instructionSet;
+
+		return key == "baseline" ? (int)INSTRUCTION_SET_BASELINE : -1;
+	}
+
+	// Read once per process
+	inline int getEnvironmentOverride()
+	{
+		static const int instructionSet = findByName(juce::SystemStats::getEnvironmentVariable("BASS_ENHANCER_ISA", {}));
+		return instructionSet;
+	}
+
+	inline int getBest()
+	{
+		for (int instructionSet = N_INSTRUCTION_SETS - 1; instructionSet > INSTRUCTION_SET_BASELINE; --instructionSet)
+			if (isSupported(instructionSet))
+				return instructionSet;
+
+		return INSTRUCTION_SET_BASELINE;
+	}
+
+	// A forced set the CPU cannot run would crash, it falls back to the best supported one
+	inline int choose(int instructionSetOverride)
+	{
+		for (int candidate : { instructionSetOverride, getEnvironmentOverride() })
+		{
+			if (candidate < 0)
+				continue;
+
+			jassert(isSupported(candidate));
+
+			if (isSupported(candidate))
+				return candidate;
+		}
+
+		return getBest();
+	}
+}
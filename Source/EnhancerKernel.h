@@ -0,0 +1,778 @@
+/*
+  ==============================================================================
+
+    Enhancer processing kernel assembled from compile time stages.
+
+    Every distortion mode is one instantiation of EnhancerKernel with its own
+    prefilter and shaper policy, so all modes share the same sample loop.
+    Each shaper runs directly or through first / second order antiderivative
+    anti-aliasing (ADAA). Mode E is a Chebyshev harmonic generator.
+    Everything is templated on the sample type, float and double kernels
+    are built from the same stages. EnhancerTimeKernel runs the same stages
+    on one channel with successive samples in the lanes, see TimeSIMDFilters.h.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "FilterCoefficients.h"
+#include "SIMDFilters.h"
+#include "TimeSIMDFilters.h"
+#include "CpuDispatch.h"
+#include "EnhancerKernelAVX2.h"
+
+//==============================================================================
+// Previous shaper inputs and antiderivatives for the ADAA shapers. The shapers
+// read the previous sample of a value through delayed() and store the
+// current one through update(), which works for both lane layouts.
+template <typename SampleType>
+struct AntiderivativeState
+{
+	using SIMDType = SIMDVector<SampleType>;
+
+	SIMDType x1 = SIMDType::expand(0);
+	SIMDType x2 = SIMDType::expand(0);
+	SIMDType F1 = SIMDType::expand(0);
+	SIMDType F2 = SIMDType::expand(0);
+	SIMDType d1 = SIMDType::expand(0);
+
+	void reset()
+	{
+		x1 = x2 = F1 = F2 = d1 = SIMDType::expand(0);
+	}
+
+	// Lanes hold channels, the previous sample of each lane is the stored register
+	SIMDType delayed(SIMDType, SIMDType previous) const { return previous; }
+	SIMDType delayedTwice(SIMDType) const { return x2; }
+	SIMDType update(SIMDType, SIMDType current) const { return current; }
+
+	void pushInput(SIMDType in)
+	{
+		x2 = x1;
+		x1 = in;
+	}
+};
+
+// The same for lanes holding successive samples of one channel. Every
+// register keeps the previous register, earlier samples are shifted in
+// from it, so the shapers need no second copy of x1.
+template <typename SampleType>
+struct TimeAntiderivativeState
+{
+	using SIMDType = SIMDVector<SampleType>;
+
+	SIMDType x1 = SIMDType::expand(0);
+	SIMDType F1 = SIMDType::expand(0);
+	SIMDType F2 = SIMDType::expand(0);
+	SIMDType d1 = SIMDType::expand(0);
+
+	// See TimeSIMDFilter::setPreview()
+	bool preview = false;
+
+	void reset()
+	{
+		x1 = F1 = F2 = d1 = SIMDType::expand(0);
+	}
+
+	SIMDType delayed(SIMDType current, SIMDType previous) const { return SIMDHelpers::shiftIn(current, previous, 1); }
+	SIMDType delayedTwice(SIMDType current) const { return SIMDHelpers::shiftIn(current, x1, 2); }
+	SIMDType update(SIMDType previous, SIMDType current) const { return preview ? previous : current; }
+
+	void pushInput(SIMDType in)
+	{
+		x1 = update(x1, in);
+	}
+};
+
+//==============================================================================
+// Weighted sum of Chebyshev polynomials T2..T8, stored in the power basis so
+// it evaluates with Horner's scheme. For |x| <= 1, Tn(cos w) = cos(n w), so
+// a full scale sine produces exactly harmonics 2..8 at the given weights.
+struct HarmonicRange
+{
+	static const int FIRST_HARMONIC = 2;
+	static const int LAST_HARMONIC = 8;
+	static const int N_HARMONICS = LAST_HARMONIC - FIRST_HARMONIC + 1;
+};
+
+template <typename SampleType>
+struct HarmonicPolynomial : public HarmonicRange
+{
+	using SIMDType = SIMDVector<SampleType>;
+
+	// coefficients[i] multiplies x^i, coefficients[0] is kept at 0 so even
+	// harmonics add no DC offset
+	SIMDType coefficients[LAST_HARMONIC + 1] = {};
+
+	void setWeights(const float* weights)
+	{
+		// Tn+1 = 2 x Tn - Tn-1, in the power basis
+		double previous[LAST_HARMONIC + 1] = { 1.0 };
+		double current[LAST_HARMONIC + 1] = { 0.0, 1.0 };
+		double sum[LAST_HARMONIC + 1] = {};
+
+		for (int n = 1; n < LAST_HARMONIC; ++n)
+		{
+			double next[LAST_HARMONIC + 1] = {};
+
+			for (int i = 0; i < LAST_HARMONIC; ++i)
+				next[i + 1] = 2.0 * current[i];
+
+			for (int i = 0; i <= LAST_HARMONIC; ++i)
+			{
+				next[i] -= previous[i];
+				previous[i] = current[i];
+				current[i] = next[i];
+			}
+
+			// current is now T(n + 1)
+			for (int i = 0; i <= LAST_HARMONIC; ++i)
+				sum[i] += weights[n + 1 - FIRST_HARMONIC] * current[i];
+		}
+
+		coefficients[0] = SIMDType::expand(0);
+
+		for (int i = 1; i <= LAST_HARMONIC; ++i)
+			coefficients[i] = SIMDType::expand((SampleType)sum[i]);
+	}
+
+	SIMDType process(SIMDType in) const
+	{
+		SIMDType out = coefficients[LAST_HARMONIC];
+
+		for (int i = LAST_HARMONIC - 1; i >= 0; --i)
+			out = out * in + coefficients[i];
+
+		return out;
+	}
+};
+
+//==============================================================================
+template <typename SampleType>
+struct EnhancerFilters
+{
+	LowPassFilter12dBSIMD<SampleType>  lowPass;
+	LadderFilterSIMD<SampleType>       ladder;
+	SecondOrderAllPassSIMD<SampleType> allPass;
+	AntiderivativeState<SampleType>    antiderivative;
+	HarmonicPolynomial<SampleType>     harmonics;
+
+	void init(int sampleRate)
+	{
+		lowPass.init(sampleRate);
+		ladder.init(sampleRate);
+		allPass.init(sampleRate);
+	}
+	void reset()
+	{
+		lowPass.reset();
+		ladder.reset();
+		allPass.reset();
+		antiderivative.reset();
+	}
+	void setCoef(const FilterCoefficientTable::Entry& coefficients)
+	{
+		lowPass.setCoef(coefficients.lowPass);
+		ladder.setCoef(coefficients.ladder);
+		allPass.setCoef(coefficients.allPass);
+	}
+};
+
+// The filters of one channel for EnhancerTimeKernel, same member names so
+// the stages below serve both
+template <typename SampleType>
+struct EnhancerTimeFilters
+{
+	static const int LANES = (int)SIMDVector<SampleType>::SIMDNumElements;
+
+	// The register the last block ended in, lanes below count are filled
+	struct PartialRegister
+	{
+		SampleType in[LANES] = {};
+		SampleType dry[LANES] = {};
+		SampleType gain[LANES] = {};
+		SampleType wet[LANES] = {};
+		SampleType dryGain[LANES] = {};
+		SampleType out[LANES] = {};
+		int count = 0;
+	};
+
+	LowPassFilter12dBTimeSIMD<SampleType>  lowPass;
+	LadderFilterTimeSIMD<SampleType>       ladder;
+	SecondOrderAllPassTimeSIMD<SampleType> allPass;
+	TimeAntiderivativeState<SampleType>    antiderivative;
+	HarmonicPolynomial<SampleType>         harmonics;
+	PartialRegister                        partial;
+
+	void init(int sampleRate)
+	{
+		lowPass.init(sampleRate);
+		ladder.init(sampleRate);
+		allPass.init(sampleRate);
+	}
+	void reset()
+	{
+		lowPass.reset();
+		ladder.reset();
+		allPass.reset();
+		antiderivative.reset();
+		partial = {};
+	}
+	void setCoef(const FilterCoefficientTable::Entry& coefficients)
+	{
+		lowPass.setCoef(coefficients.lowPass);
+		ladder.setCoef(coefficients.ladder);
+		allPass.setCoef(coefficients.allPass);
+	}
+	void setPreview(bool preview)
+	{
+		lowPass.setPreview(preview);
+		ladder.setPreview(preview);
+		allPass.setPreview(preview);
+		antiderivative.preview = preview;
+	}
+};
+
+// Per sample smoothed gains for one sub-block
+template <typename SampleType>
+struct EnhancerGains
+{
+	static const int MAX_SAMPLES = 16;
+
+	SIMDVector<SampleType> gain[MAX_SAMPLES];
+	SIMDVector<SampleType> wet[MAX_SAMPLES];
+	SIMDVector<SampleType> dry[MAX_SAMPLES];
+};
+
+// The same for EnhancerTimeKernel, one value per sample
+template <typename SampleType>
+struct EnhancerTimeGains
+{
+	static const int MAX_SAMPLES = EnhancerGains<SampleType>::MAX_SAMPLES;
+
+	SampleType gain[MAX_SAMPLES] = {};
+	SampleType wet[MAX_SAMPLES] = {};
+	SampleType dry[MAX_SAMPLES] = {};
+};
+
+//==============================================================================
+// Prefilters
+template <typename SampleType>
+struct LowPassPrefilter
+{
+	using SIMDType = SIMDVector<SampleType>;
+
+	template <typename Filters>
+	static SIMDType process(Filters& filters, SIMDType in)
+	{
+		return filters.lowPass.process(in);
+	}
+};
+
+// Band around Frequency extracted as the difference to the all-pass
+template <typename SampleType>
+struct AllPassBandPrefilter
+{
+	using SIMDType = SIMDVector<SampleType>;
+
+	template <typename Filters>
+	static SIMDType process(Filters& filters, SIMDType in)
+	{
+		return SIMDType::expand(SampleType(0.5)) * (in - filters.allPass.process(in));
+	}
+};
+
+// Input already split by LinearPhaseBandSplit
+template <typename SampleType>
+struct PrefilteredInput
+{
+	using SIMDType = SIMDVector<SampleType>;
+
+	template <typename Filters>
+	static SIMDType process(Filters&, SIMDType in)
+	{
+		return in;
+	}
+};
+
+//==============================================================================
+// Shaper functions with their first and second antiderivatives, all taken
+// to be zero at 0. The plain value is the original processBlock expression.
+template <typename SampleType>
+struct SoftClipShaper
+{
+	using SIMDType = SIMDVector<SampleType>;
+
+	static SIMDType process(SIMDType in)
+	{
+		const SIMDType one = SIMDType::expand(1);
+		return SIMDType::max(SIMDType::expand(-1), SIMDType::min(one, SIMDHelpers::divide(in, one + SIMDType::abs(in))));
+	}
+
+	// |x| - ln(1 + |x|)
+	static SIMDType antiderivative1(SIMDType in)
+	{
+		const SIMDType abs = SIMDType::abs(in);
+		return abs - SIMDHelpers::log(SIMDType::expand(1) + abs);
+	}
+
+	// sign(x) * (x^2 / 2 + |x| - (1 + |x|) ln(1 + |x|))
+	static SIMDType antiderivative2(SIMDType in)
+	{
+		const SIMDType abs = SIMDType::abs(in);
+		const SIMDType onePlusAbs = SIMDType::expand(1) + abs;
+		return SIMDHelpers::sign(in) * (SIMDType::expand(SampleType(0.5)) * abs * abs + abs - onePlusAbs * SIMDHelpers::log(onePlusAbs));
+	}
+};
+
+template <typename SampleType>
+struct ThresholdGateShaper
+{
+	using SIMDType = SIMDVector<SampleType>;
+
+	static SIMDType process(SIMDType in)
+	{
+		return SIMDHelpers::select(SIMDType::greaterThan(SIMDType::abs(in), SIMDType::expand(SampleType(0.25))), SIMDHelpers::sign(in), SIMDType::expand(0));
+	}
+
+	// max(|x| - 0.25, 0)
+	static SIMDType antiderivative1(SIMDType in)
+	{
+		return SIMDType::max(SIMDType::abs(in) - SIMDType::expand(SampleType(0.25)), SIMDType::expand(0));
+	}
+
+	// sign(x) * max(|x| - 0.25, 0)^2 / 2
+	static SIMDType antiderivative2(SIMDType in)
+	{
+		const SIMDType above = antiderivative1(in);
+		return SIMDHelpers::sign(in) * SIMDType::expand(SampleType(0.5)) * above * above;
+	}
+};
+
+template <typename SampleType>
+struct ClampedSquareShaper
+{
+	using SIMDType = SIMDVector<SampleType>;
+
+	static SIMDType process(SIMDType in)
+	{
+		const SIMDType clipped = SIMDType::min(SIMDType::abs(in), SIMDType::expand(1));
+		return SIMDHelpers::sign(in) * clipped * clipped;
+	}
+
+	// |x| <= 1 ? |x|^3 / 3 : |x| - 2 / 3
+	static SIMDType antiderivative1(SIMDType in)
+	{
+		const SIMDType abs = SIMDType::abs(in);
+		const auto inside = SIMDType::lessThanOrEqual(abs, SIMDType::expand(1));
+		return SIMDHelpers::select(inside, SIMDType::expand(SampleType(1) / SampleType(3)) * abs * abs * abs, abs - SIMDType::expand(SampleType(2) / SampleType(3)));
+	}
+
+	// sign(x) * (|x| <= 1 ? x^4 / 12 : x^2 / 2 - 2 |x| / 3 + 1 / 4)
+	static SIMDType antiderivative2(SIMDType in)
+	{
+		const SIMDType abs = SIMDType::abs(in);
+		const SIMDType square = abs * abs;
+		const auto inside = SIMDType::lessThanOrEqual(abs, SIMDType::expand(1));
+		const SIMDType inner = SIMDType::expand(SampleType(1) / SampleType(12)) * square * square;
+		const SIMDType outer = SIMDType::expand(SampleType(0.5)) * square - SIMDType::expand(SampleType(2) / SampleType(3)) * abs + SIMDType::expand(SampleType(0.25));
+		return SIMDHelpers::sign(in) * SIMDHelpers::select(inside, inner, outer);
+	}
+};
+
+//==============================================================================
+// Antialiasing stages around a shaper function.
+//
+// ADAA replaces f(x[n]) by the mean of f over the segment between successive
+// samples, computed from antiderivatives. When the samples are closer than
+// the tolerance the divided differences lose more precision than the
+// fallback to f at the segment midpoint is off by, O(dx^2). In float that
+// happens below 1e-3, double keeps enough digits down to 1e-4. The first
+// order stage delays the wet path by half a sample, the second order stage
+// by one sample, both negligible at bass frequencies.
+template <typename SampleType>
+constexpr SampleType getADAATolerance()
+{
+	return std::is_same<SampleType, double>::value ? SampleType(1.0e-4) : SampleType(1.0e-3);
+}
+
+template <typename Shape>
+struct DirectShaper
+{
+	using SIMDType = typename Shape::SIMDType;
+	using SampleType = typename SIMDType::ElementType;
+
+	template <typename Filters>
+	static SIMDType process(Filters&, SIMDType in)
+	{
+		return Shape::process(in);
+	}
+};
+
+template <typename Shape>
+struct FirstOrderADAAShaper
+{
+	using SIMDType = typename Shape::SIMDType;
+	using SampleType = typename SIMDType::ElementType;
+
+	template <typename Filters>
+	static SIMDType process(Filters& filters, SIMDType in)
+	{
+		auto& state = filters.antiderivative;
+		const SIMDType x1 = state.delayed(in, state.x1);
+		const SIMDType delta = in - x1;
+		const auto illConditioned = SIMDType::lessThan(SIMDType::abs(delta), SIMDType::expand(getADAATolerance<SampleType>()));
+
+		// Ill-conditioned lanes divide by one and are replaced below
+		const SIMDType safeDelta = SIMDHelpers::select(illConditioned, SIMDType::expand(1), delta);
+		const SIMDType F1 = Shape::antiderivative1(in);
+		const SIMDType adaa = SIMDHelpers::divide(F1 - state.delayed(F1, state.F1), safeDelta);
+		const SIMDType midpoint = Shape::process(SIMDType::expand(SampleType(0.5)) * (in + x1));
+
+		state.pushInput(in);
+		state.F1 = state.update(state.F1, F1);
+
+		return SIMDHelpers::select(illConditioned, midpoint, adaa);
+	}
+};
+
+template <typename Shape>
+struct SecondOrderADAAShaper
+{
+	using SIMDType = typename Shape::SIMDType;
+	using SampleType = typename SIMDType::ElementType;
+
+	template <typename Filters>
+	static SIMDType process(Filters& filters, SIMDType in)
+	{
+		auto& state = filters.antiderivative;
+		const SIMDType half = SIMDType::expand(SampleType(0.5));
+		const SIMDType two = SIMDType::expand(2);
+		const SIMDType one = SIMDType::expand(1);
+		const SIMDType tolerance = SIMDType::expand(getADAATolerance<SampleType>());
+
+		const SIMDType x1 = state.delayed(in, state.x1);
+		const SIMDType x2 = state.delayedTwice(in);
+
+		// First divided difference of F2 between in and x1
+		const SIMDType F2 = Shape::antiderivative2(in);
+		const SIMDType F2Previous = state.delayed(F2, state.F2);
+		const SIMDType delta1 = in - x1;
+		const auto illConditioned1 = SIMDType::lessThan(SIMDType::abs(delta1), tolerance);
+		const SIMDType d0 = SIMDHelpers::select(illConditioned1,
+			Shape::antiderivative1(half * (in + x1)),
+			SIMDHelpers::divide(F2 - F2Previous, SIMDHelpers::select(illConditioned1, one, delta1)));
+
+		// Second divided difference between in and x2
+		const SIMDType delta2 = in - x2;
+		const auto illConditioned2 = SIMDType::lessThan(SIMDType::abs(delta2), tolerance);
+		const SIMDType adaa = two * SIMDHelpers::divide(d0 - state.delayed(d0, state.d1), SIMDHelpers::select(illConditioned2, one, delta2));
+
+		// in ~ x2: first order ADAA between x1 and the midpoint of in and x2
+		const SIMDType mean = half * (in + x2);
+		const SIMDType deltaMean = mean - x1;
+		const auto illConditionedMean = SIMDType::lessThan(SIMDType::abs(deltaMean), tolerance);
+		const SIMDType safeDeltaMean = SIMDHelpers::select(illConditionedMean, one, deltaMean);
+		const SIMDType fallback = SIMDHelpers::select(illConditionedMean,
+			Shape::process(half * (mean + x1)),
+			two * SIMDHelpers::divide(Shape::antiderivative1(mean) + SIMDHelpers::divide(F2Previous - Shape::antiderivative2(mean), safeDeltaMean), safeDeltaMean));
+
+		state.pushInput(in);
+		state.F2 = state.update(state.F2, F2);
+		state.d1 = state.update(state.d1, d0);
+
+		return SIMDHelpers::select(illConditioned2, fallback, adaa);
+	}
+};
+
+// Harmonic generator, the input is clamped to [-1, 1] where the Chebyshev
+// sum keeps its harmonic structure. Its output is band limited to the 8th
+// harmonic inside that range, so it runs without ADAA.
+template <typename SampleType>
+struct ChebyshevShaper
+{
+	using SIMDType = SIMDVector<SampleType>;
+
+	template <typename Filters>
+	static SIMDType process(Filters& filters, SIMDType in)
+	{
+		const SIMDType clipped = SIMDType::max(SIMDType::expand(-1), SIMDType::min(SIMDType::expand(1), in));
+		return filters.harmonics.process(clipped);
+	}
+};
+
+//==============================================================================
+// Post filters
+template <typename SampleType>
+struct LadderPostFilter
+{
+	using SIMDType = SIMDVector<SampleType>;
+
+	template <typename Filters>
+	static SIMDType process(Filters& filters, SIMDType in)
+	{
+		return filters.ladder.process(in);
+	}
+};
+
+//==============================================================================
+// Mix stages
+template <typename SampleType>
+struct DryWetMix
+{
+	using SIMDType = SIMDVector<SampleType>;
+
+	static SIMDType process(SIMDType in, SIMDType processed, SIMDType wet, SIMDType dry)
+	{
+		return wet * processed + dry * in;
+	}
+};
+
+//==============================================================================
+// Channels are processed in groups of SIMDNumElements, one EnhancerFilters per
+// group. lanes holds samples * numGroups registers, all groups of a sample next
+// to each other. The groups are independent recursions, so stepping them in
+// the same sample loop overlaps their latencies. dryLanes is laid out the same
+// way and may be lanes itself, every register is read before it is written.
+template <typename SampleType, typename Prefilter, typename Shaper, typename PostFilter = LadderPostFilter<SampleType>, typename Mix = DryWetMix<SampleType>>
+struct EnhancerKernel
+{
+	using SIMDType = SIMDVector<SampleType>;
+	using Function = void (*)(EnhancerFilters<SampleType>*, int, const EnhancerGains<SampleType>&, SIMDType*, const SIMDType*, int);
+
+	static void process(EnhancerFilters<SampleType>* filters, int numGroups, const EnhancerGains<SampleType>& gains, SIMDType* lanes, const SIMDType* dryLanes, int samples)
+	{
+		jassert(samples <= EnhancerGains<SampleType>::MAX_SAMPLES);
+
+		for (int sample = 0; sample < samples; ++sample)
+		{
+			SIMDType* groupLanes = lanes + sample * numGroups;
+			const SIMDType* groupDryLanes = dryLanes + sample * numGroups;
+
+			for (int group = 0; group < numGroups; ++group)
+			{
+				// Get input
+				const SIMDType in = groupLanes[group];
+				const SIMDType dry = groupDryLanes[group];
+
+				// Prefilter
+				const SIMDType inPreFilter = Prefilter::process(filters[group], in) * gains.gain[sample];
+
+				// Distort
+				const SIMDType inDistort = Shaper::process(filters[group], inPreFilter);
+
+				// Post filter
+				const SIMDType inPostFilter = PostFilter::process(filters[group], inDistort);
+
+				// Apply volume, mix and send to output
+				groupLanes[group] = Mix::process(dry, inPostFilter, gains.wet[sample], gains.dry[sample]);
+			}
+		}
+	}
+};
+
+template <typename SampleType>
+using EnhancerKernelFunction = void (*)(EnhancerFilters<SampleType>*, int, const EnhancerGains<SampleType>&, SIMDVector<SampleType>*, const SIMDVector<SampleType>*, int);
+
+//==============================================================================
+// One channel, a register holds SIMDNumElements successive samples. Linear
+// stages run as block recursions, memoryless shapers do not care how the
+// lanes are laid out and ADAA shifts its previous samples in. Registers are
+// aligned to the stream: an unfinished one is collected in
+// EnhancerTimeFilters::partial and previewed, the next block completes it.
+// Every register takes the same path, so all block sizes give the same
+// output. A coefficient change reaches the register being collected when it
+// completes. in, dry and out may be the same buffer.
+template <typename SampleType, typename Prefilter, typename Shaper, typename PostFilter = LadderPostFilter<SampleType>, typename Mix = DryWetMix<SampleType>>
+struct EnhancerTimeKernel
+{
+	using SIMDType = SIMDVector<SampleType>;
+	using Function = void (*)(EnhancerTimeFilters<SampleType>&, const EnhancerTimeGains<SampleType>&, const SampleType*, const SampleType*, SampleType*, int);
+
+	static const int LANES = (int)SIMDType::SIMDNumElements;
+
+	static void process(EnhancerTimeFilters<SampleType>& filters, const EnhancerTimeGains<SampleType>& gains, const SampleType* in, const SampleType* dry, SampleType* out, int samples)
+	{
+		jassert(samples <= EnhancerTimeGains<SampleType>::MAX_SAMPLES);
+
+		auto& partial = filters.partial;
+
+		for (int sample = 0; sample < samples;)
+		{
+			const int start = partial.count;
+			const int count = juce::jmin(LANES - start, samples - sample);
+			const bool complete = start + count == LANES;
+
+			// Whole registers are read in place, others go through partial
+			const SampleType* registerIn = in + sample;
+			const SampleType* registerDry = dry + sample;
+			const SampleType* registerGain = gains.gain + sample;
+			const SampleType* registerWet = gains.wet + sample;
+			const SampleType* registerDryGain = gains.dry + sample;
+			SampleType* registerOut = out + sample;
+
+			if (count < LANES)
+			{
+				std::copy(in + sample, in + sample + count, partial.in + start);
+				std::copy(dry + sample, dry + sample + count, partial.dry + start);
+				std::copy(gains.gain + sample, gains.gain + sample + count, partial.gain + start);
+				std::copy(gains.wet + sample, gains.wet + sample + count, partial.wet + start);
+				std::copy(gains.dry + sample, gains.dry + sample + count, partial.dryGain + start);
+
+				registerIn = partial.in;
+				registerDry = partial.dry;
+				registerGain = partial.gain;
+				registerWet = partial.wet;
+				registerDryGain = partial.dryGain;
+				registerOut = partial.out;
+			}
+
+			filters.setPreview(!complete);
+
+			const SIMDType inPreFilter = Prefilter::process(filters, SIMDHelpers::load(registerIn)) * SIMDHelpers::load(registerGain);
+			const SIMDType inDistort = Shaper::process(filters, inPreFilter);
+			const SIMDType inPostFilter = PostFilter::process(filters, inDistort);
+
+			SIMDHelpers::store(registerOut, Mix::process(SIMDHelpers::load(registerDry), inPostFilter, SIMDHelpers::load(registerWet), SIMDHelpers::load(registerDryGain)));
+
+			if (count < LANES)
+				std::copy(partial.out + start, partial.out + start + count, out + sample);
+
+			partial.count = complete ? 0 : start + count;
+			sample += count;
+		}
+
+		filters.setPreview(false);
+	}
+};
+
+template <typename SampleType>
+using EnhancerTimeKernelFunction = typename EnhancerTimeKernel<SampleType, void, void>::Function;
+
+//==============================================================================
+enum DistortionMode
+{
+	DISTORTION_MODE_A = 0,
+	DISTORTION_MODE_B,
+	DISTORTION_MODE_C,
+	DISTORTION_MODE_D,
+	DISTORTION_MODE_E,
+	N_DISTORTION_MODES
+};
+
+enum AntialiasingMode
+{
+	ANTIALIASING_OFF = 0,
+	ANTIALIASING_ADAA1,
+	ANTIALIASING_ADAA2,
+	N_ANTIALIASING_MODES
+};
+
+// Entry point of one kernel, Kernel::Function is the signature of
+// Kernel::process. Flattened, so the copy in EnhancerKernelAVX2.cpp inlines
+// the JUCE and standard library helpers instead of sharing an out-of-line
+// one with the baseline.
+struct KernelEntry
+{
+	template <typename Kernel, typename... Arguments>
+	BASS_ENHANCER_FLATTEN
+	static void process(Arguments... arguments)
+	{
+		Kernel::process(arguments...);
+	}
+
+	template <typename Kernel, typename... Arguments>
+	static auto getFor(void (*)(Arguments...)) { return &process<Kernel, Arguments...>; }
+
+	template <typename Kernel>
+	static typename Kernel::Function get() { return getFor<Kernel>(typename Kernel::Function()); }
+};
+
+// Every distortion mode with one antialiasing stage, Kernel is EnhancerKernel or EnhancerTimeKernel
+template <template <typename, typename, typename, typename, typename> class Kernel, typename SampleType,
+          template <typename> class LowPass, template <typename> class Band, template <typename> class Antialiasing>
+struct EnhancerKernelRow
+{
+	template <typename Prefilter, typename Shaper>
+	using ModeKernel = Kernel<SampleType, Prefilter, Shaper, LadderPostFilter<SampleType>, DryWetMix<SampleType>>;
+
+	using Function = typename ModeKernel<void, void>::Function;
+
+	static const Function* get()
+	{
+		static const Function kernels[N_DISTORTION_MODES] =
+		{
+			KernelEntry::get<ModeKernel<LowPass<SampleType>, Antialiasing<SoftClipShaper<SampleType>>>>(),
+			KernelEntry::get<ModeKernel<Band<SampleType>,    Antialiasing<SoftClipShaper<SampleType>>>>(),
+			KernelEntry::get<ModeKernel<Band<SampleType>,    Antialiasing<ThresholdGateShaper<SampleType>>>>(),
+			KernelEntry::get<ModeKernel<Band<SampleType>,    Antialiasing<ClampedSquareShaper<SampleType>>>>(),
+			KernelEntry::get<ModeKernel<Band<SampleType>,    ChebyshevShaper<SampleType>>>()
+		};
+
+		return kernels;
+	}
+};
+
+// Every row, with linearPhase the prefilter already ran as LinearPhaseBandSplit
+template <template <typename, typename, typename, typename, typename> class Kernel, typename SampleType>
+struct EnhancerKernelTable
+{
+	using Function = typename Kernel<SampleType, void, void, LadderPostFilter<SampleType>, DryWetMix<SampleType>>::Function;
+
+	static const Function* get(int antialiasing, bool linearPhase)
+	{
+		using Row = const Function* (*)();
+
+		static const Row rows[2][N_ANTIALIASING_MODES] =
+		{
+			{
+				&EnhancerKernelRow<Kernel, SampleType, LowPassPrefilter, AllPassBandPrefilter, DirectShaper>::get,
+				&EnhancerKernelRow<Kernel, SampleType, LowPassPrefilter, AllPassBandPrefilter, FirstOrderADAAShaper>::get,
+				&EnhancerKernelRow<Kernel, SampleType, LowPassPrefilter, AllPassBandPrefilter, SecondOrderADAAShaper>::get
+			},
+			{
+				&EnhancerKernelRow<Kernel, SampleType, PrefilteredInput, PrefilteredInput, DirectShaper>::get,
+				&EnhancerKernelRow<Kernel, SampleType, PrefilteredInput, PrefilteredInput, FirstOrderADAAShaper>::get,
+				&EnhancerKernelRow<Kernel, SampleType, PrefilteredInput, PrefilteredInput, SecondOrderADAAShaper>::get
+			}
+		};
+
+		return rows[linearPhase ? 1 : 0][antialiasing]();
+	}
+
+	// instructionSet must be one CpuDispatch::isSupported() accepts
+	static Function select(int mode, int antialiasing, bool linearPhase, int instructionSet)
+	{
+		jassert(juce::isPositiveAndBelow(mode, (int)N_DISTORTION_MODES));
+		jassert(juce::isPositiveAndBelow(antialiasing, (int)N_ANTIALIASING_MODES));
+		jassert(CpuDispatch::isBuilt(instructionSet));
+
+	// BASS_ENHANCER_KERNEL_COPY is set while EnhancerKernelAVX2.cpp builds its copy
+	#if BASS_ENHANCER_MULTI_TARGET && ! BASS_ENHANCER_KERNEL_COPY
+		// The copy's types are laid out like these, its functions take the same arguments
+		if (instructionSet == INSTRUCTION_SET_AVX2)
+		{
+			const bool timeKernel = std::is_same<Function, EnhancerTimeKernelFunction<SampleType>>::value;
+			const bool doublePrecision = std::is_same<SampleType, double>::value;
+
+			return reinterpret_cast<Function>(EnhancerKernelAVX2::get(timeKernel, doublePrecision, mode, antialiasing, linearPhase));
+		}
+	#endif
+
+		return get(antialiasing, linearPhase)[mode];
+	}
+};
+
+template <typename SampleType>
+EnhancerKernelFunction<SampleType> getEnhancerKernel(int mode, int antialiasing, bool linearPhase, int instructionSet = INSTRUCTION_SET_BASELINE)
+{
+	return EnhancerKernelTable<EnhancerKernel, SampleType>::select(mode, antialiasing, linearPhase, instructionSet);
+}
+
+template <typename SampleType>
+EnhancerTimeKernelFunction<SampleType> getEnhancerTimeKernel(int mode, int antialiasing, bool linearPhase, int instructionSet = INSTRUCTION_SET_BASELINE)
+{
+	return EnhancerKernelTable<EnhancerTimeKernel, SampleType>::select(mode, antialiasing, linearPhase, instructionSet);
+}
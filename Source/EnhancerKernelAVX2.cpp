@@ -0,0 +1,56 @@
+/*
+  ==============================================================================
+
+    The AVX2 copy of the enhancer kernels, see CpuDispatch.h.
+
+    Compiled with the baseline flags. The target pragma below only covers
+    the kernels in AVX2Kernels, so JUCE keeps SIMDRegister at the 128 bit
+    lanes the processor's state is laid out for, and any JUCE or standard
+    library helper emitted out of line here stays baseline code.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <complex>
+
+// Included before the namespace below, so the copy shares them with the baseline
+#include "CpuDispatch.h"
+#include "EnhancerKernelAVX2.h"
+
+#if BASS_ENHANCER_MULTI_TARGET
+
+#define BASS_ENHANCER_KERNEL_COPY 1
+
+#if JUCE_CLANG
+ #pragma clang attribute push (__attribute__((target("avx2,fma"))), apply_to = function)
+#else
+ #pragma GCC push_options
+ #pragma GCC target ("avx2,fma")
+#endif
+
+namespace AVX2Kernels
+{
+	#include "EnhancerKernel.h"
+}
+
+//==============================================================================
+EnhancerKernelAVX2::ErasedFunction EnhancerKernelAVX2::get(bool timeKernel, bool doublePrecision, int mode, int antialiasing, bool linearPhase)
+{
+	using namespace AVX2Kernels;
+
+	if (timeKernel)
+		return doublePrecision ? reinterpret_cast<ErasedFunction>(getEnhancerTimeKernel<double>(mode, antialiasing, linearPhase))
+		                       : reinterpret_cast<ErasedFunction>(getEnhancerTimeKernel<float>(mode, antialiasing, linearPhase));
+
+	return doublePrecision ? reinterpret_cast<ErasedFunction>(getEnhancerKernel<double>(mode, antialiasing, linearPhase))
+	                       : reinterpret_cast<ErasedFunction>(getEnhancerKernel<float>(mode, antialiasing, linearPhase));
+}
+
+#if JUCE_CLANG
+ #pragma clang attribute pop
+#else
+ #pragma GCC pop_options
+#endif
+
+#endif
@@ -0,0 +1,23 @@
+/*
+  ==============================================================================
+
+    The enhancer kernels built for AVX2 and FMA.
+
+    EnhancerKernelAVX2.cpp compiles its own copy of EnhancerKernel.h with an
+    AVX2 and FMA target pragma. The copy lives in its own namespace, so its
+    types are not the baseline's and its functions come back type erased.
+    EnhancerKernelTable::select casts them to its own signatures, the
+    arguments are laid out the same.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+//==============================================================================
+namespace EnhancerKernelAVX2
+{
+	using ErasedFunction = void (*)();
+
+	ErasedFunction get(bool timeKernel, bool doublePrecision, int mode, int antialiasing, bool linearPhase);
+}
@@ -0,0 +1,246 @@
+/*
+  ==============================================================================
+
+    Filter design for the enhancer filters, plus a coefficient table so the
+    audio thread can look coefficients up instead of calling tan/cos.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <complex>
+
+//==============================================================================
+// Polynomial / rational approximations usable in constant expressions.
+//
+// tan: [5/4] Pade approximant, valid for x in [0, pi/4] (cutoff up to fs/4).
+//      Max abs error 1.4e-8, 2.1e-7 when evaluated in float (std::tanf: 1.8e-7).
+// cos: Taylor series up to x^12, valid for x in [-pi/2, pi/2].
+//      Max abs error 6.4e-9, 1.8e-7 when evaluated in float.
+//
+// Errors measured against double precision std::tan/std::cos over 1e6 points.
+struct FastMath
+{
+	template <typename SampleType>
+	static constexpr SampleType tan(SampleType x)
+	{
+		const SampleType x2 = x * x;
+		return x * (SampleType(945) + x2 * (SampleType(-105) + x2)) / (SampleType(945) + x2 * (SampleType(-420) + x2 * SampleType(15)));
+	}
+
+	template <typename SampleType>
+	static constexpr SampleType cos(SampleType x)
+	{
+		const SampleType x2 = x * x;
+		return SampleType(1) + x2 * (SampleType(-1) / SampleType(2) + x2 * (SampleType(1) / SampleType(24) + x2 * (SampleType(-1) / SampleType(720) + x2 * (SampleType(1) / SampleType(40320) + x2 * (SampleType(-1) / SampleType(3628800) + x2 * (SampleType(1) / SampleType(479001600)))))));
+	}
+};
+
+struct PreciseMath
+{
+	template <typename SampleType>
+	static SampleType tan(SampleType x) { return std::tan(x); }
+
+	template <typename SampleType>
+	static SampleType cos(SampleType x) { return std::cos(x); }
+};
+
+//==============================================================================
+// Coefficients in the precision of the filter using them. Low cutoffs at high
+// sample rates put the poles close to 1, where float keeps few digits of
+// their distance to it, so the tables are designed in double.
+template <typename SampleType>
+struct LowPassCoefficients
+{
+	SampleType inCoef = SampleType(1);
+	SampleType outLastCoef = SampleType(0);
+};
+
+template <typename SampleType>
+struct AllPassCoefficients
+{
+	SampleType a1 = SampleType(0);
+	SampleType a2 = SampleType(0);
+};
+
+namespace FilterDesign
+{
+	// Bilinear one-pole used by LowPassFilter
+	template <typename Math = PreciseMath, typename SampleType>
+	constexpr LowPassCoefficients<SampleType> lowPass(SampleType frequency, SampleType sampleRate)
+	{
+		const SampleType warp = Math::tan((frequency * juce::MathConstants<SampleType>::pi) / sampleRate);
+		return { warp / (1 + warp), (1 - warp) / (1 + warp) };
+	}
+
+	// Second order all-pass used by SecondOrderAllPass
+	template <typename Math = PreciseMath, typename SampleType>
+	constexpr AllPassCoefficients<SampleType> allPass(SampleType frequency, SampleType Q, SampleType sampleRate)
+	{
+		const SampleType bandWidth = frequency / Q;
+		const SampleType t = Math::tan(juce::MathConstants<SampleType>::pi * bandWidth / sampleRate);
+		const SampleType c = (t - 1) / (t + 1);
+		const SampleType d = -Math::cos(juce::MathConstants<SampleType>::twoPi * frequency / sampleRate);
+
+		return { d * (1 - c), -c };
+	}
+
+	// Largest pole radius of LadderFilter, i.e. how much its ringing decays per
+	// sample. Four one-poles (b (1 + 1/z) / (1 - p/z)) with the output fed back
+	// one sample late, closed loop denominator z (z - p)^4 + k b^4 (z + 1)^4.
+	inline double ladderPoleRadius(const LowPassCoefficients<double>& stage, double resonance)
+	{
+		using Complex = std::complex<double>;
+
+		const double p = stage.outLastCoef;
+		const double k = resonance * std::pow(stage.inCoef, 4.0);
+		const double polynomial[] = { 1.0, k - 4.0 * p, 6.0 * p * p + 4.0 * k, 6.0 * k - 4.0 * p * p * p, p * p * p * p + 4.0 * k, k };
+		const int order = 5;
+
+		auto evaluate = [&] (Complex z)
+		{
+			Complex result = polynomial[0];
+
+			for (int i = 1; i <= order; ++i)
+				result = result * z + polynomial[i];
+
+			return result;
+		};
+
+		// Durand-Kerner, all roots at once
+		Complex roots[order];
+
+		for (int i = 0; i < order; ++i)
+			roots[i] = std::pow(Complex(0.4, 0.9), i);
+
+		for (int iteration = 0; iteration < 500; ++iteration)
+		{
+			double change = 0.0;
+
+			for (int i = 0; i < order; ++i)
+			{
+				Complex denominator = 1.0;
+
+				for (int j = 0; j < order; ++j)
+					if (j != i)
+						denominator *= roots[i] - roots[j];
+
+				const Complex step = evaluate(roots[i]) / denominator;
+				roots[i] -= step;
+				change = juce::jmax(change, std::abs(step));
+			}
+
+			if (change < 1.0e-14)
+				break;
+		}
+
+		double radius = 0.0;
+
+		for (const auto& root : roots)
+			radius = juce::jmax(radius, std::abs(root));
+
+		return radius;
+	}
+}
+
+static_assert(FilterDesign::lowPass<FastMath>(0.0f, 48000.0f).inCoef == 0.0f, "FastMath must stay constexpr");
+
+//==============================================================================
+// Coefficients of the whole enhancer chain sampled on a frequency grid for one
+// sample rate. Built off the audio thread in double, lookups interpolate
+// linearly between neighbouring grid points and filters of either precision
+// take the result.
+class FilterCoefficientTable
+{
+public:
+	struct Entry
+	{
+		LowPassCoefficients<double> lowPass;
+		LowPassCoefficients<double> ladder;
+		AllPassCoefficients<double> allPass;
+
+		// Largest pole radius of the chain, the per sample decay of its slowest ringing
+		double decay = 0.0;
+	};
+
+	void build(double minFrequency, double maxFrequency, double step, double sampleRate, double ladderFactor, double ladderResonance, double allPassQ)
+	{
+		m_minFrequency = minFrequency;
+		m_maxFrequency = maxFrequency;
+		m_step = step;
+		m_sampleRate = sampleRate;
+		m_ladderFactor = ladderFactor;
+		m_allPassQ = allPassQ;
+
+		const int size = (int)std::ceil((maxFrequency - minFrequency) / step) + 1;
+		m_entries.resize((size_t)size);
+
+		for (int i = 0; i < size; ++i)
+		{
+			Entry& entry = m_entries[(size_t)i];
+			entry = design<PreciseMath>(minFrequency + i * step);
+
+			// The all-pass poles have radius sqrt(a2), the 12 dB low-pass a double pole at outLastCoef
+			entry.decay = juce::jmax(std::sqrt(juce::jmax(0.0, entry.allPass.a2)),
+			                         std::abs(entry.lowPass.outLastCoef),
+			                         FilterDesign::ladderPoleRadius(entry.ladder, ladderResonance));
+		}
+	}
+
+	Entry lookup(double frequency) const
+	{
+		// Outside the grid fall back to the polynomial design, with the decay of the nearest grid point
+		if (frequency < m_minFrequency || frequency > m_maxFrequency || m_entries.empty())
+		{
+			Entry entry = design<FastMath>(frequency);
+
+			if (!m_entries.empty())
+				entry.decay = (frequency < m_minFrequency ? m_entries.front() : m_entries.back()).decay;
+
+			return entry;
+		}
+
+		const double position = (frequency - m_minFrequency) / m_step;
+		const int index = juce::jmin((int)position, (int)m_entries.size() - 2);
+		const double fraction = position - index;
+
+		const Entry& a = m_entries[(size_t)index];
+		const Entry& b = m_entries[(size_t)index + 1];
+
+		Entry result;
+		result.lowPass.inCoef      = a.lowPass.inCoef      + fraction * (b.lowPass.inCoef      - a.lowPass.inCoef);
+		result.lowPass.outLastCoef = a.lowPass.outLastCoef + fraction * (b.lowPass.outLastCoef - a.lowPass.outLastCoef);
+		result.ladder.inCoef       = a.ladder.inCoef       + fraction * (b.ladder.inCoef       - a.ladder.inCoef);
+		result.ladder.outLastCoef  = a.ladder.outLastCoef  + fraction * (b.ladder.outLastCoef  - a.ladder.outLastCoef);
+		result.allPass.a1          = a.allPass.a1          + fraction * (b.allPass.a1          - a.allPass.a1);
+		result.allPass.a2          = a.allPass.a2          + fraction * (b.allPass.a2          - a.allPass.a2);
+		result.decay               = a.decay               + fraction * (b.decay               - a.decay);
+
+		return result;
+	}
+
+	double getSampleRate() const { return m_sampleRate; }
+
+private:
+	template <typename Math>
+	Entry design(double frequency) const
+	{
+		Entry entry;
+		entry.lowPass = FilterDesign::lowPass<Math>(frequency, m_sampleRate);
+		entry.ladder  = FilterDesign::lowPass<Math>(frequency * m_ladderFactor, m_sampleRate);
+		entry.allPass = FilterDesign::allPass<Math>(frequency, m_allPassQ, m_sampleRate);
+
+		return entry;
+	}
+
+	std::vector<Entry> m_entries;
+
+	double m_minFrequency = 0.0;
+	double m_maxFrequency = 0.0;
+	double m_step = 1.0;
+	double m_sampleRate = 48000.0;
+	double m_ladderFactor = 1.0;
+	double m_allPassQ = 1.0;
+};
@@ -0,0 +1,447 @@
+/*
+  ==============================================================================
+
+    Background tracker of the bass fundamental.
+
+    The audio thread pushes a mono mix of the input into a wait-free FIFO,
+    nothing more. A TimeSliceThread shared by every instance drains it,
+    low-passes and decimates it to about DECIMATED_RATE and runs YIN on the
+    last ANALYSIS_SIZE decimated samples every HOP_SECONDS. The difference
+    function comes from one FFT cross-correlation instead of a loop per lag.
+    Estimates pass a median of three against octave jumps, are smoothed in
+    octaves and published as one atomic float the audio thread reads.
+
+    Each analysis is timed, the thread waits long enough afterwards that the
+    tracker never takes more than CPU_BUDGET of a core.
+
+    Non-realtime renders bypass the FIFO and the thread. push() decimates on
+    the processing thread and analyses the moment a hop is complete, and the
+    processor splits its blocks there (getSamplesToHop), so a render does not
+    depend on the machine, the block size or how it is chunked.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+class FundamentalTracker : public juce::TimeSliceClient
+{
+public:
+	static constexpr double DECIMATED_RATE = 4000.0;
+	static constexpr double FIFO_SECONDS = 0.5;
+	static constexpr double HOP_SECONDS = 0.05;
+	static constexpr double SMOOTHING_SECONDS = 0.2;
+	static constexpr double CPU_BUDGET = 0.01;
+
+	// Cutoff of the two cascaded anti-aliasing low-passes, above the highest fundamental
+	static constexpr double ANTIALIASING_FREQUENCY = 800.0;
+
+	static const int FFT_ORDER = 11;
+	static const int ANALYSIS_SIZE = 1 << (FFT_ORDER - 1);
+	static const int INTEGRATION_SIZE = ANALYSIS_SIZE / 2;
+
+	// Cumulative mean normalized difference below which a lag counts as periodic
+	static constexpr float YIN_THRESHOLD = 0.15f;
+
+	// Below about -50 dBFS RMS there is no bass worth tracking
+	static constexpr float MIN_LEVEL = 0.003f;
+
+	//==============================================================================
+	// Message thread, while the tracker thread does not use this instance
+	void prepare(double sampleRate, float minFrequency, float maxFrequency)
+	{
+		m_decimation = juce::jmax(1, (int)(sampleRate / DECIMATED_RATE));
+		m_decimatedRate = sampleRate / m_decimation;
+		m_minFrequency = minFrequency;
+		m_maxFrequency = maxFrequency;
+
+		// The longest period must fit beside the integration window
+		m_maxLag = juce::jmin(ANALYSIS_SIZE - INTEGRATION_SIZE - 2, (int)std::ceil(m_decimatedRate / minFrequency));
+		m_minLag = juce::jmax(2, (int)std::floor(m_decimatedRate / maxFrequency));
+		m_hopSamples = juce::jmax(1, juce::roundToInt(HOP_SECONDS * m_decimatedRate));
+
+		m_fifo.setTotalSize(juce::nextPowerOfTwo((int)(FIFO_SECONDS * sampleRate)));
+		m_fifoData.assign((size_t)m_fifo.getTotalSize(), 0.0f);
+		m_scratch.assign(m_fifoData.size(), 0.0f);
+
+		for (auto& filter : m_antialiasing)
+			filter.setCoefficients(juce::IIRCoefficients::makeLowPass(sampleRate, ANTIALIASING_FREQUENCY));
+
+		m_history.assign((size_t)ANALYSIS_SIZE, 0.0f);
+		m_signal.assign((size_t)ANALYSIS_SIZE, 0.0f);
+		m_squares.assign((size_t)ANALYSIS_SIZE + 1, 0.0);
+		m_window.assign((size_t)(4 * ANALYSIS_SIZE), 0.0f);
+		m_correlation.assign((size_t)(4 * ANALYSIS_SIZE), 0.0f);
+		m_difference.assign((size_t)m_maxLag + 2, 1.0f);
+
+		m_discardPending.store(true);
+	}
+
+	//==============================================================================
+	// Audio thread
+	void setEnabled(bool shouldBeEnabled)
+	{
+		if (shouldBeEnabled != m_enabled.load(std::memory_order_relaxed))
+		{
+			m_discardPending.store(true);
+			m_enabled.store(shouldBeEnabled);
+		}
+	}
+
+	bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+	// Non-realtime renders analyse in push(), the tracker thread stays out
+	void setSynchronous(bool shouldBeSynchronous)
+	{
+		if (shouldBeSynchronous != m_synchronous.load(std::memory_order_relaxed))
+		{
+			m_discardPending.store(true);
+			m_synchronous.store(shouldBeSynchronous);
+		}
+	}
+
+	bool isSynchronous() const { return m_synchronous.load(std::memory_order_relaxed); }
+
+	// Synchronous only. Input samples up to and including the one that completes the next hop.
+	int getSamplesToHop()
+	{
+		const juce::ScopedLock lock(m_analysisLock);
+		discardIfPending();
+
+		return (m_hopSamples - m_newSamples) * m_decimation - m_decimationPhase;
+	}
+
+	// Wait-free mono mix into the FIFO, samples are dropped while it is full.
+	// Synchronous, the mix is decimated and analysed right here instead.
+	template <typename SampleType>
+	void push(const juce::AudioBuffer<SampleType>& buffer, int channels, int startSample, int samples)
+	{
+		if (channels <= 0 || m_fifoData.empty())
+		{
+			return;
+		}
+
+		if (m_synchronous.load(std::memory_order_relaxed))
+		{
+			const juce::ScopedLock lock(m_analysisLock);
+			discardIfPending();
+
+			for (int done = 0; done < samples;)
+			{
+				const int size = juce::jmin(samples - done, (int)m_scratch.size(), (m_hopSamples - m_newSamples) * m_decimation - m_decimationPhase);
+
+				mix(buffer, channels, startSample + done, size, m_scratch.data());
+				decimate(m_scratch.data(), size);
+				done += size;
+
+				if (m_newSamples >= m_hopSamples)
+					analyse();
+			}
+
+			return;
+		}
+
+		int start1, size1, start2, size2;
+		m_fifo.prepareToWrite(samples, start1, size1, start2, size2);
+
+		if (size1 > 0)
+			mix(buffer, channels, startSample, size1, m_fifoData.data() + start1);
+
+		if (size2 > 0)
+			mix(buffer, channels, startSample + size1, size2, m_fifoData.data() + start2);
+
+		m_fifo.finishedWrite(size1 + size2);
+	}
+
+	// Any thread. 0 until the first fundamental is found after enabling.
+	float getFrequency() const { return m_frequency.load(std::memory_order_relaxed); }
+
+	//==============================================================================
+	// Tracker thread
+	int useTimeSlice() override
+	{
+		if (m_synchronous.load())
+		{
+			return 50;
+		}
+
+		const juce::ScopedLock lock(m_analysisLock);
+		discardIfPending();
+
+		if (!m_enabled.load(std::memory_order_relaxed))
+		{
+			return 50;
+		}
+
+		drain();
+
+		if (m_newSamples < m_hopSamples)
+		{
+			return (int)(1000.0 * (m_hopSamples - m_newSamples) / m_decimatedRate) + 1;
+		}
+
+		const double start = juce::Time::getMillisecondCounterHiRes();
+		analyse();
+
+		// Keep the average load within the budget however slow the machine is
+		const double elapsed = juce::Time::getMillisecondCounterHiRes() - start;
+		return juce::jmax((int)(1000.0 * HOP_SECONDS), (int)(elapsed / CPU_BUDGET));
+	}
+
+private:
+	template <typename SampleType>
+	static void mix(const juce::AudioBuffer<SampleType>& buffer, int channels, int startSample, int samples, float* destination)
+	{
+		const float gain = 1.0f / channels;
+
+		for (int sample = 0; sample < samples; ++sample)
+			destination[sample] = 0.0f;
+
+		for (int channel = 0; channel < channels; ++channel)
+		{
+			const SampleType* source = buffer.getReadPointer(channel, startSample);
+
+			for (int sample = 0; sample < samples; ++sample)
+				destination[sample] += gain * (float)source[sample];
+		}
+	}
+
+	// The rest with m_analysisLock held
+	void discardIfPending()
+	{
+		if (m_discardPending.exchange(false))
+			discard();
+	}
+
+	void discard()
+	{
+		m_fifo.finishedRead(m_fifo.getNumReady());
+
+		for (auto& filter : m_antialiasing)
+			filter.reset();
+
+		std::fill(m_history.begin(), m_history.end(), 0.0f);
+		m_historyPosition = 0;
+		m_decimationPhase = 0;
+		m_newSamples = 0;
+		m_estimates = 0;
+		m_frequency.store(0.0f);
+	}
+
+	void drain()
+	{
+		int start1, size1, start2, size2;
+		m_fifo.prepareToRead(m_fifo.getNumReady(), start1, size1, start2, size2);
+
+		auto append = [&] (int start, int size)
+		{
+			if (size <= 0)
+				return;
+
+			std::copy(m_fifoData.begin() + start, m_fifoData.begin() + start + size, m_scratch.begin());
+			decimate(m_scratch.data(), size);
+		};
+
+		append(start1, size1);
+		append(start2, size2);
+
+		m_fifo.finishedRead(size1 + size2);
+	}
+
+	// Low-passes in place and appends every m_decimation-th sample to the history
+	void decimate(float* samples, int size)
+	{
+		for (auto& filter : m_antialiasing)
+			filter.processSamples(samples, size);
+
+		for (int i = 0; i < size; ++i)
+		{
+			if (++m_decimationPhase < m_decimation)
+				continue;
+
+			m_decimationPhase = 0;
+			m_history[(size_t)m_historyPosition] = samples[i];
+			m_historyPosition = (m_historyPosition + 1) % ANALYSIS_SIZE;
+			m_newSamples++;
+		}
+	}
+
+	void analyse()
+	{
+		m_newSamples = 0;
+
+		const float frequency = detect();
+
+		if (frequency > 0.0f)
+			publish(frequency);
+	}
+
+	// YIN on the history, returns 0 for silence and for signals without a clear period
+	float detect()
+	{
+		// Oldest sample first
+		for (int i = 0; i < ANALYSIS_SIZE; ++i)
+			m_signal[(size_t)i] = m_history[(size_t)((m_historyPosition + i) % ANALYSIS_SIZE)];
+
+		m_squares[0] = 0.0;
+
+		for (int i = 0; i < ANALYSIS_SIZE; ++i)
+			m_squares[(size_t)i + 1] = m_squares[(size_t)i] + (double)m_signal[(size_t)i] * m_signal[(size_t)i];
+
+		if (m_squares[ANALYSIS_SIZE] < (double)MIN_LEVEL * MIN_LEVEL * ANALYSIS_SIZE)
+		{
+			return 0.0f;
+		}
+
+		// Cross-correlation of the integration window with the whole signal, zero padded so lags do not wrap
+		std::fill(m_window.begin(), m_window.end(), 0.0f);
+		std::fill(m_correlation.begin(), m_correlation.end(), 0.0f);
+		std::copy(m_signal.begin(), m_signal.begin() + INTEGRATION_SIZE, m_window.begin());
+		std::copy(m_signal.begin(), m_signal.end(), m_correlation.begin());
+
+		m_fft.performRealOnlyForwardTransform(m_window.data(), true);
+		m_fft.performRealOnlyForwardTransform(m_correlation.data(), true);
+
+		for (int bin = 0; bin <= ANALYSIS_SIZE; ++bin)
+		{
+			const float re = m_window[(size_t)(2 * bin)];
+			const float im = m_window[(size_t)(2 * bin + 1)];
+			const float otherRe = m_correlation[(size_t)(2 * bin)];
+			const float otherIm = m_correlation[(size_t)(2 * bin + 1)];
+
+			// conj(window) * signal
+			m_correlation[(size_t)(2 * bin)] = re * otherRe + im * otherIm;
+			m_correlation[(size_t)(2 * bin + 1)] = re * otherIm - im * otherRe;
+		}
+
+		m_fft.performRealOnlyInverseTransform(m_correlation.data());
+
+		// Difference function d(lag) = E(window) + E(window shifted by lag) - 2 r(lag), cumulative mean normalized
+		const double windowEnergy = m_squares[INTEGRATION_SIZE];
+		double sum = 0.0;
+		m_difference[0] = 1.0f;
+
+		for (int lag = 1; lag <= m_maxLag + 1; ++lag)
+		{
+			const double shiftedEnergy = m_squares[(size_t)(lag + INTEGRATION_SIZE)] - m_squares[(size_t)lag];
+			const double difference = juce::jmax(0.0, windowEnergy + shiftedEnergy - 2.0 * m_correlation[(size_t)lag]);
+
+			sum += difference;
+			m_difference[(size_t)lag] = sum > 0.0 ? (float)(difference * lag / sum) : 1.0f;
+		}
+
+		// First dip below the threshold, followed down to its minimum
+		int lag = m_minLag;
+
+		while (lag <= m_maxLag && m_difference[(size_t)lag] >= YIN_THRESHOLD)
+			lag++;
+
+		if (lag > m_maxLag)
+		{
+			return 0.0f;
+		}
+
+		while (lag < m_maxLag && m_difference[(size_t)lag + 1] < m_difference[(size_t)lag])
+			lag++;
+
+		// Parabolic interpolation around the minimum
+		const float previous = m_difference[(size_t)lag - 1];
+		const float current = m_difference[(size_t)lag];
+		const float next = m_difference[(size_t)lag + 1];
+		const float curvature = previous - 2.0f * current + next;
+		const float offset = curvature > 0.0f ? juce::jlimit(-0.5f, 0.5f, 0.5f * (previous - next) / curvature) : 0.0f;
+
+		return (float)(m_decimatedRate / (lag + offset));
+	}
+
+	void publish(float frequency)
+	{
+		// Median of the last three estimates drops single octave errors
+		m_recent[m_estimates % 3] = frequency;
+		m_estimates++;
+
+		if (m_estimates < 3)
+		{
+			return;
+		}
+
+		const float a = m_recent[0];
+		const float b = m_recent[1];
+		const float c = m_recent[2];
+		const float median = juce::jmax(juce::jmin(a, b), juce::jmin(juce::jmax(a, b), c));
+		const float octaves = std::log2(juce::jlimit(m_minFrequency, m_maxFrequency, median));
+
+		// The first estimate after enabling is taken as it is
+		const float current = m_frequency.load(std::memory_order_relaxed);
+
+		if (current <= 0.0f)
+		{
+			m_octaves = octaves;
+		}
+		else
+		{
+			m_octaves += (float)(1.0 - std::exp(-HOP_SECONDS / SMOOTHING_SECONDS)) * (octaves - m_octaves);
+		}
+
+		m_frequency.store(std::exp2(m_octaves));
+	}
+
+	//==============================================================================
+	std::atomic<bool> m_enabled { false };
+	std::atomic<bool> m_discardPending { true };
+	std::atomic<bool> m_synchronous { false };
+	std::atomic<float> m_frequency { 0.0f };
+
+	juce::AbstractFifo m_fifo { 1 };
+	std::vector<float> m_fifoData;
+
+	// Tracker thread, or the processing thread while synchronous
+	juce::CriticalSection m_analysisLock;
+	double m_decimatedRate = DECIMATED_RATE;
+	int m_decimation = 1;
+	int m_decimationPhase = 0;
+	float m_minFrequency = 40.0f;
+	float m_maxFrequency = 400.0f;
+	int m_minLag = 2;
+	int m_maxLag = 2;
+	int m_hopSamples = 1;
+	int m_newSamples = 0;
+
+	juce::IIRFilter m_antialiasing[2];
+	std::vector<float> m_scratch;
+
+	// Last ANALYSIS_SIZE decimated samples, circular
+	std::vector<float> m_history;
+	int m_historyPosition = 0;
+
+	juce::dsp::FFT m_fft { FFT_ORDER };
+	std::vector<float> m_signal;
+	std::vector<double> m_squares;
+	std::vector<float> m_window;
+	std::vector<float> m_correlation;
+	std::vector<float> m_difference;
+
+	float m_recent[3] = {};
+	int m_estimates = 0;
+	float m_octaves = 0.0f;
+};
+
+//==============================================================================
+// One tracker thread for every instance in the process
+class FundamentalTrackerThread : public juce::TimeSliceThread
+{
+public:
+	FundamentalTrackerThread()
+		: juce::TimeSliceThread("Fundamental Tracker")
+	{
+		startThread();
+	}
+
+	~FundamentalTrackerThread() override
+	{
+		stopThread(1000);
+	}
+};
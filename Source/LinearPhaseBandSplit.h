@@ -0,0 +1,686 @@
+/*
+  ==============================================================================
+
+    Linear-phase band split by uniformly partitioned FFT convolution.
+
+    The FIR kernels have the magnitude response of the minimum phase
+    prefilters, LowPassFilter12dB for mode A and the all-pass band for the
+    other modes, with zero phase. A TimeSliceThread redesigns them when the
+    target frequency moves and hands them to the audio thread through an
+    atomic slot index, the audio thread then crossfades to the new kernel
+    over one partition. Every partition costs one forward FFT, one complex
+    multiply-add per kernel partition and one inverse FFT, so the work is
+    spread evenly over the blocks instead of arriving as one long FFT.
+    The dry signal is delayed by the same latency, so Mix sums in phase.
+    The convolution runs in float for either sample precision, the dry delay
+    keeps double input exact.
+
+    Memory is only held for the current oversampling index, and only while
+    enabled. The design thread allocates it: the audio thread hands the
+    buffers over when the index changes or the split is disabled, and takes
+    them back once they are allocated and a kernel is designed. Until then
+    band and dry are silent, as a freshly cleared delay would be.
+
+    Non-realtime renders allocate and design on the processing thread
+    instead, so the output does not depend on the render speed.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "FilterCoefficients.h"
+
+//==============================================================================
+class LinearPhaseBandSplit : public juce::TimeSliceClient
+{
+public:
+	enum Shape
+	{
+		SHAPE_LOW_PASS = 0,
+		SHAPE_BAND
+	};
+
+	// Long enough for the Q 7 all-pass band at 40 Hz to ring down by about 60 dB
+	static constexpr double KERNEL_SECONDS = 0.35;
+
+	// Partitions follow the block size within these limits. Above the maximum
+	// the JUCE fallback FFT would allocate its scratch space on the heap.
+	static const int MIN_PARTITION_SIZE = 64;
+	static const int MAX_PARTITION_SIZE = 8192;
+
+	// Smaller frequency changes keep the current kernel
+	static constexpr float FREQUENCY_TOLERANCE = 0.1f;
+
+	//==============================================================================
+	// Message thread, while the design thread does not use this instance.
+	// Sets up the partitioning of every oversampling index up to maxIndex and
+	// frees what the previous settings allocated.
+	void prepare(int channels, double sampleRate, int maxBlockSize, int maxIndex, float allPassQ)
+	{
+		m_sampleRate = sampleRate;
+		m_allPassQ = allPassQ;
+		m_configs.resize((size_t)maxIndex + 1);
+
+		const int basePartitionSize = juce::jlimit(MIN_PARTITION_SIZE, MAX_PARTITION_SIZE, juce::nextPowerOfTwo(maxBlockSize));
+
+		for (int index = 0; index <= maxIndex; ++index)
+		{
+			Config& config = m_configs[(size_t)index];
+			config.partitionSize = juce::jmin(MAX_PARTITION_SIZE, basePartitionSize << index);
+			config.partitions = juce::jmax(1, (int)std::ceil(KERNEL_SECONDS * sampleRate * (1 << index) / config.partitionSize));
+
+			// Odd symmetric kernel of 2 * center + 1 taps, the last tap of the partitions stays zero.
+			// The latency is a whole number of samples at the host rate.
+			const int step = 1 << index;
+			config.center = (config.partitions * config.partitionSize / 2 - 1) / step * step;
+			config.latency = config.partitionSize + config.center;
+		}
+
+		m_channels.clear();
+		m_channels.resize((size_t)channels);
+		release();
+
+		m_owner.store(OWNER_DESIGN);
+		m_crossfade = false;
+		m_ready = false;
+		m_index = -1;
+		m_requestedIndex.store(-1);
+	}
+
+	// Message thread before the design thread starts, or the processing thread of a
+	// non-realtime render. Allocates and designs whatever the design thread would.
+	void designNow()
+	{
+		const juce::ScopedLock lock(m_designLock);
+		update();
+	}
+
+	int getLatencySamples(int index) const
+	{
+		return juce::isPositiveAndBelow(index, (int)m_configs.size()) ? m_configs[(size_t)index].latency : 0;
+	}
+
+	// Taps after the kernel center, they ring on after the latency
+	int getTailSamples(int index) const
+	{
+		return juce::isPositiveAndBelow(index, (int)m_configs.size()) ? m_configs[(size_t)index].center : 0;
+	}
+
+	//==============================================================================
+	// Audio thread
+	// Memory is only held and kernels only designed while enabled
+	void setEnabled(bool shouldBeEnabled)
+	{
+		m_enabled.store(shouldBeEnabled);
+
+		if (!shouldBeEnabled)
+			handOver();
+	}
+
+	// Non-realtime renders call designNow() every block, the design thread stays out
+	void setSynchronous(bool shouldBeSynchronous) { m_synchronous.store(shouldBeSynchronous); }
+
+	void setTarget(int shape, float frequency)
+	{
+		m_requestedShape.store(shape, std::memory_order_relaxed);
+		m_requestedFrequency.store(frequency, std::memory_order_relaxed);
+	}
+
+	// Switches to the partitioning of an oversampling index, band and dry stay
+	// silent until memory and a kernel for that index arrive
+	void setIndex(int index)
+	{
+		jassert(juce::isPositiveAndBelow(index, (int)m_configs.size()));
+
+		m_index = index;
+		m_requestedIndex.store(index);
+
+		if (m_preparedIndex.load() != index)
+			handOver();
+
+		reset();
+	}
+
+	void reset()
+	{
+		if (m_owner.load() != OWNER_AUDIO)
+		{
+			return;
+		}
+
+		for (auto& channel : m_channels)
+		{
+			std::fill(channel.input.begin(), channel.input.end(), 0.0f);
+			std::fill(channel.output.begin(), channel.output.end(), 0.0f);
+			std::fill(channel.spectra.begin(), channel.spectra.end(), 0.0f);
+			std::fill(channel.delay.begin(), channel.delay.end(), 0.0);
+			channel.spectraPosition = 0;
+		}
+
+		m_position = 0;
+		m_delayPosition = 0;
+	}
+
+	// Call once per block, before processChannel. Takes a kernel published by the design thread.
+	void beginBlock()
+	{
+		// The design thread may have finished an index that was left again meanwhile
+		if (m_owner.load() == OWNER_AUDIO && m_preparedIndex.load() != m_index)
+			handOver();
+
+		m_ready = m_owner.load() == OWNER_AUDIO;
+
+		if (!m_ready)
+		{
+			return;
+		}
+
+		const int slot = m_pending.load();
+
+		if (slot < 0)
+		{
+			return;
+		}
+
+		if (m_slots[slot].index == m_index)
+		{
+			m_fadeFrom.store(m_active.load());
+			m_active.store(slot);
+			m_crossfade = true;
+		}
+
+		// Published last, the design thread waits for it before touching the slots
+		m_pending.store(-1);
+	}
+
+	// Writes the band and the equally delayed dry input of one channel
+	template <typename SampleType>
+	void processChannel(int channel, const SampleType* in, SampleType* band, SampleType* dry, int samples)
+	{
+		if (!m_ready)
+		{
+			std::fill(band, band + samples, (SampleType)0);
+			std::fill(dry, dry + samples, (SampleType)0);
+			return;
+		}
+
+		Channel& state = m_channels[(size_t)channel];
+		const Config& config = m_configs[(size_t)m_index];
+		const int partitionSize = config.partitionSize;
+		const int delayMask = m_delaySize - 1;
+
+		int position = m_position;
+		int partitions = 0;
+
+		for (int sample = 0; sample < samples; ++sample)
+		{
+			const int delayPosition = m_delayPosition + sample;
+			state.delay[(size_t)(delayPosition & delayMask)] = (double)in[sample];
+			dry[sample] = (SampleType)state.delay[(size_t)((delayPosition - config.latency) & delayMask)];
+
+			state.input[(size_t)(partitionSize + position)] = (float)in[sample];
+			band[sample] = (SampleType)state.output[(size_t)position];
+
+			if (++position == partitionSize)
+			{
+				// Crossfade only in the first partition after the swap
+				processPartition(state, config, m_crossfade && partitions == 0);
+				position = 0;
+				partitions++;
+			}
+		}
+	}
+
+	// Only the dry delay of one channel, for signals that skip the band. in and dry may be the same buffer.
+	template <typename SampleType>
+	void delayChannel(int channel, const SampleType* in, SampleType* dry, int samples)
+	{
+		if (!m_ready)
+		{
+			std::fill(dry, dry + samples, (SampleType)0);
+			return;
+		}
+
+		Channel& state = m_channels[(size_t)channel];
+		const int latency = m_configs[(size_t)m_index].latency;
+		const int delayMask = m_delaySize - 1;
+
+		for (int sample = 0; sample < samples; ++sample)
+		{
+			const int delayPosition = m_delayPosition + sample;
+			state.delay[(size_t)(delayPosition & delayMask)] = (double)in[sample];
+			dry[sample] = (SampleType)state.delay[(size_t)((delayPosition - latency) & delayMask)];
+		}
+	}
+
+	// Call once per block, after every channel went through processChannel or delayChannel
+	void endBlock(int samples)
+	{
+		if (!m_ready)
+		{
+			return;
+		}
+
+		const int partitionSize = m_configs[(size_t)m_index].partitionSize;
+
+		if (m_crossfade && m_position + samples >= partitionSize)
+		{
+			m_crossfade = false;
+			m_fadeFrom.store(-1);
+		}
+
+		m_position = (m_position + samples) % partitionSize;
+		m_delayPosition = (m_delayPosition + samples) & (m_delaySize - 1);
+	}
+
+	//==============================================================================
+	// Design thread
+	int useTimeSlice() override
+	{
+		if (m_synchronous.load())
+		{
+			return 20;
+		}
+
+		const juce::ScopedLock lock(m_designLock);
+		return update();
+	}
+
+private:
+	enum Owner
+	{
+		OWNER_DESIGN = 0,
+		OWNER_AUDIO
+	};
+	struct Config
+	{
+		int partitionSize = MIN_PARTITION_SIZE;
+		int partitions = 1;
+		int center = 0;
+		int latency = 0;
+	};
+
+	// Kernel partitions in the frequency domain, (partitionSize + 1) interleaved complex bins each
+	struct Slot
+	{
+		std::vector<float> spectra;
+		int index = -1;
+		int shape = -1;
+		float frequency = 0.0f;
+	};
+
+	struct Channel
+	{
+		// Previous and current partition of input
+		std::vector<float> input;
+		std::vector<float> output;
+
+		// Spectra of the last partitions of input, circular
+		std::vector<float> spectra;
+		int spectraPosition = 0;
+
+		std::vector<double> delay;
+	};
+
+	//==============================================================================
+	// Audio thread, gives buffers and slots to the design thread
+	void handOver()
+	{
+		if (m_owner.load() != OWNER_AUDIO)
+		{
+			return;
+		}
+
+		m_pending.store(-1);
+		m_fadeFrom.store(-1);
+		m_crossfade = false;
+		m_ready = false;
+		m_owner.store(OWNER_DESIGN);
+	}
+
+	// With m_designLock held. Returns the time until the next call in ms.
+	int update()
+	{
+		const int index = m_requestedIndex.load();
+		const int shape = m_requestedShape.load();
+		const float frequency = m_requestedFrequency.load();
+
+		if (m_owner.load() == OWNER_DESIGN)
+		{
+			if (!m_enabled.load() || !juce::isPositiveAndBelow(index, (int)m_configs.size()))
+			{
+				release();
+				return 20;
+			}
+
+			allocate(index);
+			design(m_slots[0], shape, frequency, index);
+			m_active.store(0);
+			m_pending.store(-1);
+			m_fadeFrom.store(-1);
+			m_owner.store(OWNER_AUDIO);
+
+			return 1;
+		}
+
+		// The audio thread still owns both slots
+		if (m_pending.load() != -1 || m_fadeFrom.load() != -1)
+		{
+			return 5;
+		}
+
+		// Waiting for the audio thread to hand the buffers over
+		if (!m_enabled.load() || index != m_preparedIndex.load())
+		{
+			return 5;
+		}
+
+		const int active = m_active.load();
+		const Slot& current = m_slots[active];
+
+		if (current.shape == shape && std::abs(current.frequency - frequency) < FREQUENCY_TOLERANCE)
+		{
+			return 10;
+		}
+
+		const int slot = 1 - active;
+		design(m_slots[slot], shape, frequency, index);
+		m_pending.store(slot);
+
+		return 1;
+	}
+
+	// Four times the kernel length keeps time aliasing of the sampled response small
+	static int getGridOrder(const Config& config)
+	{
+		return juce::roundToInt(std::log2(juce::nextPowerOfTwo(4 * config.partitions * config.partitionSize)));
+	}
+
+	// Sized exactly, a shorter vector gives the memory back
+	template <typename Type>
+	static void reallocate(std::vector<Type>& vector, size_t size)
+	{
+		std::vector<Type>(size, Type()).swap(vector);
+	}
+
+	static juce::dsp::FFT& getFFT(std::unique_ptr<juce::dsp::FFT>& fft, int order)
+	{
+		if (fft == nullptr || fft->getSize() != 1 << order)
+			fft = std::make_unique<juce::dsp::FFT>(order);
+
+		return *fft;
+	}
+
+	// Design side, while the design thread owns the buffers
+	void allocate(int index)
+	{
+		const Config& config = m_configs[(size_t)index];
+		const int partitionSize = config.partitionSize;
+		const size_t spectraSize = (size_t)(config.partitions * (partitionSize + 1) * 2);
+
+		m_delaySize = juce::nextPowerOfTwo(config.latency + 1);
+
+		for (auto& slot : m_slots)
+		{
+			reallocate(slot.spectra, spectraSize);
+			slot.index = -1;
+			slot.shape = -1;
+		}
+
+		for (auto& channel : m_channels)
+		{
+			reallocate(channel.input, (size_t)(2 * partitionSize));
+			reallocate(channel.output, (size_t)partitionSize);
+			reallocate(channel.spectra, spectraSize);
+			reallocate(channel.delay, (size_t)m_delaySize);
+			channel.spectraPosition = 0;
+		}
+
+		reallocate(m_fftBuffer, (size_t)(4 * partitionSize));
+		reallocate(m_accumulator, (size_t)(2 * (partitionSize + 1)));
+		reallocate(m_fadeBuffer, (size_t)partitionSize);
+		getFFT(m_fft, juce::roundToInt(std::log2(2 * partitionSize)));
+
+		// The design scratch space, kept until the index changes
+		const int gridOrder = getGridOrder(config);
+		reallocate(m_designGrid, (size_t)(2 << gridOrder));
+		reallocate(m_designTaps, (size_t)(config.partitions * partitionSize));
+		reallocate(m_designPartition, (size_t)(4 * partitionSize));
+		getFFT(m_gridFFT, gridOrder);
+
+		m_position = 0;
+		m_delayPosition = 0;
+		m_preparedIndex.store(index);
+	}
+
+	void release()
+	{
+		if (m_preparedIndex.load() < 0)
+		{
+			return;
+		}
+
+		for (auto& slot : m_slots)
+		{
+			reallocate(slot.spectra, 0);
+			slot.index = -1;
+			slot.shape = -1;
+		}
+
+		for (auto& channel : m_channels)
+			channel = {};
+
+		reallocate(m_fftBuffer, 0);
+		reallocate(m_accumulator, 0);
+		reallocate(m_fadeBuffer, 0);
+		reallocate(m_designGrid, 0);
+		reallocate(m_designTaps, 0);
+		reallocate(m_designPartition, 0);
+		m_fft.reset();
+		m_gridFFT.reset();
+		m_preparedIndex.store(-1);
+	}
+
+	//==============================================================================
+	void processPartition(Channel& state, const Config& config, bool crossfade)
+	{
+		const int partitionSize = config.partitionSize;
+		const int bins = partitionSize + 1;
+		const auto& fft = *m_fft;
+		float* buffer = m_fftBuffer.data();
+
+		// Spectrum of the newest 2 partitions of input
+		std::copy(state.input.begin(), state.input.begin() + 2 * partitionSize, buffer);
+		fft.performRealOnlyForwardTransform(buffer, true);
+		std::copy(buffer, buffer + 2 * bins, state.spectra.begin() + state.spectraPosition * bins * 2);
+
+		const Slot& slot = m_slots[m_active.load(std::memory_order_relaxed)];
+
+		if (slot.index != m_index)
+		{
+			std::fill(state.output.begin(), state.output.begin() + partitionSize, 0.0f);
+		}
+		else
+		{
+			convolve(state, slot, config, state.output.data());
+
+			if (crossfade && m_fadeFrom.load(std::memory_order_relaxed) >= 0)
+			{
+				const Slot& previous = m_slots[m_fadeFrom.load(std::memory_order_relaxed)];
+
+				if (previous.index == m_index)
+				{
+					convolve(state, previous, config, m_fadeBuffer.data());
+
+					for (int i = 0; i < partitionSize; ++i)
+					{
+						const float fade = (float)(i + 1) / partitionSize;
+						state.output[(size_t)i] = m_fadeBuffer[(size_t)i] + fade * (state.output[(size_t)i] - m_fadeBuffer[(size_t)i]);
+					}
+				}
+			}
+		}
+
+		std::copy(state.input.begin() + partitionSize, state.input.begin() + 2 * partitionSize, state.input.begin());
+		state.spectraPosition = (state.spectraPosition + 1) % config.partitions;
+	}
+
+	// Overlap-save: multiply-add every kernel partition with the input spectrum
+	// of the same age, the second half of the inverse FFT is valid output
+	void convolve(const Channel& state, const Slot& slot, const Config& config, float* output)
+	{
+		const int partitionSize = config.partitionSize;
+		const int bins = partitionSize + 1;
+		float* accumulator = m_accumulator.data();
+
+		std::fill(accumulator, accumulator + 2 * bins, 0.0f);
+
+		for (int partition = 0; partition < config.partitions; ++partition)
+		{
+			const int age = (state.spectraPosition - partition + config.partitions) % config.partitions;
+			const float* kernel = slot.spectra.data() + partition * bins * 2;
+			const float* input = state.spectra.data() + age * bins * 2;
+
+			for (int bin = 0; bin < 2 * bins; bin += 2)
+			{
+				accumulator[bin]     += kernel[bin] * input[bin]     - kernel[bin + 1] * input[bin + 1];
+				accumulator[bin + 1] += kernel[bin] * input[bin + 1] + kernel[bin + 1] * input[bin];
+			}
+		}
+
+		float* buffer = m_fftBuffer.data();
+		std::copy(accumulator, accumulator + 2 * bins, buffer);
+		m_fft->performRealOnlyInverseTransform(buffer);
+		std::copy(buffer + partitionSize, buffer + 2 * partitionSize, output);
+	}
+
+	//==============================================================================
+	// Magnitude of the minimum phase prefilter on a dense grid, zero phase,
+	// windowed to the kernel length and split into partition spectra
+	void design(Slot& slot, int shape, float frequency, int index)
+	{
+		using Complex = std::complex<double>;
+
+		const Config& config = m_configs[(size_t)index];
+		const double sampleRate = m_sampleRate * (1 << index);
+		const int gridOrder = getGridOrder(config);
+		const int gridSize = 1 << gridOrder;
+
+		std::fill(m_designGrid.begin(), m_designGrid.end(), 0.0f);
+
+		const LowPassCoefficients<double> lowPass = FilterDesign::lowPass((double)frequency, sampleRate);
+		const AllPassCoefficients<double> allPass = FilterDesign::allPass((double)frequency, (double)m_allPassQ, sampleRate);
+
+		for (int bin = 0; bin <= gridSize / 2; ++bin)
+		{
+			const Complex z1 = std::polar(1.0, -juce::MathConstants<double>::twoPi * bin / gridSize);
+			Complex response;
+
+			if (shape == SHAPE_LOW_PASS)
+			{
+				// LowPassFilter12dB, two one-poles a / (1 - b / z)
+				const Complex stage = lowPass.inCoef / (1.0 - lowPass.outLastCoef * z1);
+				response = stage * stage;
+			}
+			else
+			{
+				// 0.5 * (1 - A), A the second order all-pass
+				const Complex z2 = z1 * z1;
+				const Complex allPassResponse = (allPass.a2 + allPass.a1 * z1 + z2) / (1.0 + allPass.a1 * z1 + allPass.a2 * z2);
+				response = 0.5 * (1.0 - allPassResponse);
+			}
+
+			m_designGrid[(size_t)(2 * bin)] = (float)std::abs(response);
+		}
+
+		m_gridFFT->performRealOnlyInverseTransform(m_designGrid.data());
+
+		// Blackman window around the center tap
+		std::fill(m_designTaps.begin(), m_designTaps.end(), 0.0f);
+
+		for (int n = -config.center; n <= config.center; ++n)
+		{
+			const double phase = juce::MathConstants<double>::pi * n / (config.center + 1);
+			const double window = 0.42 + 0.5 * std::cos(phase) + 0.08 * std::cos(2.0 * phase);
+			m_designTaps[(size_t)(n + config.center)] = (float)(m_designGrid[(size_t)((n + gridSize) % gridSize)] * window);
+		}
+
+		// Partition spectra, each partition zero padded to the FFT size
+		const int partitionSize = config.partitionSize;
+		const int bins = partitionSize + 1;
+
+		for (int partition = 0; partition < config.partitions; ++partition)
+		{
+			std::fill(m_designPartition.begin(), m_designPartition.end(), 0.0f);
+			std::copy(m_designTaps.begin() + partition * partitionSize, m_designTaps.begin() + (partition + 1) * partitionSize, m_designPartition.begin());
+
+			m_fft->performRealOnlyForwardTransform(m_designPartition.data(), true);
+			std::copy(m_designPartition.begin(), m_designPartition.begin() + 2 * bins, slot.spectra.begin() + partition * bins * 2);
+		}
+
+		slot.index = index;
+		slot.shape = shape;
+		slot.frequency = frequency;
+	}
+
+	//==============================================================================
+	double m_sampleRate = 48000.0;
+	float m_allPassQ = 1.0f;
+	std::vector<Config> m_configs;
+
+	// Owned by whichever thread m_owner names, allocated for m_preparedIndex
+	std::atomic<int> m_owner { OWNER_DESIGN };
+	std::atomic<int> m_preparedIndex { -1 };
+	std::unique_ptr<juce::dsp::FFT> m_fft;
+
+	Slot m_slots[2];
+	std::atomic<int> m_active { 0 };
+	std::atomic<int> m_pending { -1 };
+	std::atomic<int> m_fadeFrom { -1 };
+
+	std::atomic<bool> m_enabled { false };
+	std::atomic<bool> m_synchronous { false };
+	std::atomic<int> m_requestedIndex { -1 };
+	std::atomic<int> m_requestedShape { SHAPE_LOW_PASS };
+	std::atomic<float> m_requestedFrequency { 80.0f };
+
+	// Audio thread
+	std::vector<Channel> m_channels;
+	std::vector<float> m_fftBuffer;
+	std::vector<float> m_accumulator;
+	std::vector<float> m_fadeBuffer;
+	int m_index = -1;
+	int m_position = 0;
+	int m_delayPosition = 0;
+	int m_delaySize = 1;
+	bool m_crossfade = false;
+	bool m_ready = false;
+
+	// Design thread, or the caller of designNow()
+	juce::CriticalSection m_designLock;
+	std::unique_ptr<juce::dsp::FFT> m_gridFFT;
+	std::vector<float> m_designGrid;
+	std::vector<float> m_designTaps;
+	std::vector<float> m_designPartition;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LinearPhaseBandSplit)
+};
+
+//==============================================================================
+// One design thread for every instance in the process
+class LinearPhaseDesignThread : public juce::TimeSliceThread
+{
+public:
+	LinearPhaseDesignThread()
+		: juce::TimeSliceThread("Linear Phase Design")
+	{
+		startThread();
+	}
+
+	~LinearPhaseDesignThread() override
+	{
+		stopThread(1000);
+	}
+};
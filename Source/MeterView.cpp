@@ -0,0 +1,68 @@
+/*
+  ==============================================================================
+
+    Editor readout of the output true peak and loudness.
+
+  ==============================================================================
+*/
+
+#include "MeterView.h"
+
+//==============================================================================
+MeterView::MeterView(OutputMeter& meter)
+	: m_meter(meter)
+{
+	// The audio thread meters only while the view exists
+	m_meter.attach();
+
+	setInterceptsMouseClicks(true, false);
+	startTimerHz(REFRESH_RATE_HZ);
+}
+
+MeterView::~MeterView()
+{
+	m_meter.detach();
+}
+
+void MeterView::timerCallback()
+{
+	const float truePeak = m_meter.getTruePeak();
+	const float momentary = m_meter.getMomentary();
+	const float shortTerm = m_meter.getShortTerm();
+	const float integrated = m_meter.getIntegrated();
+
+	if (truePeak != m_truePeak || momentary != m_momentary || shortTerm != m_shortTerm || integrated != m_integrated)
+	{
+		m_truePeak = truePeak;
+		m_momentary = momentary;
+		m_shortTerm = shortTerm;
+		m_integrated = integrated;
+		repaint();
+	}
+}
+
+void MeterView::mouseDown(const juce::MouseEvent&)
+{
+	m_meter.requestReset();
+}
+
+//==============================================================================
+void MeterView::paint(juce::Graphics& g)
+{
+	auto format = [] (float value)
+	{
+		return value > OutputMeter::FLOOR ? juce::String(value, 1) : juce::String("-inf");
+	};
+
+	g.fillAll(juce::Colours::black.withAlpha(0.6f));
+	g.setFont(11.0f);
+
+	auto area = getLocalBounds().reduced(4, 0);
+	auto peakArea = area.removeFromLeft(area.getWidth() / 3);
+
+	g.setColour(m_truePeak > TRUE_PEAK_CEILING ? juce::Colours::red : juce::Colours::white.withAlpha(0.8f));
+	g.drawText("TP " + format(m_truePeak) + " dBTP", peakArea, juce::Justification::centredLeft);
+
+	g.setColour(juce::Colours::white.withAlpha(0.8f));
+	g.drawText("M " + format(m_momentary) + "  S " + format(m_shortTerm) + "  I " + format(m_integrated) + " LUFS", area, juce::Justification::centredRight);
+}
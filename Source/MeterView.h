@@ -0,0 +1,42 @@
+/*
+  ==============================================================================
+
+    Editor readout of the output true peak and loudness.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "OutputMeter.h"
+
+//==============================================================================
+class MeterView : public juce::Component, private juce::Timer
+{
+public:
+	static const int REFRESH_RATE_HZ = 10;
+
+	// True peaks above this are drawn as overs
+	static constexpr float TRUE_PEAK_CEILING = -1.0f;
+
+	explicit MeterView(OutputMeter& meter);
+	~MeterView() override;
+
+	void paint(juce::Graphics&) override;
+
+	// A click starts the peak hold and the integrated loudness again
+	void mouseDown(const juce::MouseEvent&) override;
+
+private:
+	void timerCallback() override;
+
+	OutputMeter& m_meter;
+
+	float m_truePeak = OutputMeter::FLOOR;
+	float m_momentary = OutputMeter::FLOOR;
+	float m_shortTerm = OutputMeter::FLOOR;
+	float m_integrated = OutputMeter::FLOOR;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MeterView)
+};
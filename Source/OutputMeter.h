@@ -0,0 +1,427 @@
+/*
+  ==============================================================================
+
+    Output true-peak and loudness meter after ITU-R BS.1770.
+
+    True peak: every channel is upsampled 4x by a 48 tap polyphase FIR. Each
+    phase is a run of FloatVectorOperations multiply-adds over the whole
+    block, followed by one min/max search.
+
+    Loudness: every channel is K-weighted by the shelf and high-pass of
+    BS.1770 and its squares are summed into 100 ms bins. A ring of the last
+    30 bins gives momentary (4 bins) and short-term (30 bins) loudness without
+    rescanning samples. Each 400 ms block above the absolute gate goes into
+    a 0.1 LU histogram, so integrated loudness with the absolute and the
+    relative gate costs a fixed amount of memory however long it runs.
+    Every channel weighs 1, as for L, R and C.
+
+    All buffers are allocated in prepare. Readings are published as atomics.
+    The audio thread skips the meter entirely while nothing is attached.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+class OutputMeter
+{
+public:
+	static const int OVERSAMPLING = 4;
+	static const int PHASE_TAPS = 12;
+	static const int BLOCKS_PER_SECOND = 10;
+	static const int MOMENTARY_BLOCKS = 4;
+	static const int SHORT_TERM_BLOCKS = 30;
+
+	static constexpr float MIN_LOUDNESS = -70.0f;
+	static constexpr float MAX_LOUDNESS = 10.0f;
+	static constexpr float RELATIVE_GATE = -10.0f;
+	static constexpr float HISTOGRAM_STEP = 0.1f;
+	static const int HISTOGRAM_SIZE = (int)((MAX_LOUDNESS - MIN_LOUDNESS) / HISTOGRAM_STEP + 0.5f);
+
+	// Shown for silence and before the first block, below any real reading
+	static constexpr float FLOOR = -100.0f;
+
+	OutputMeter()
+	{
+		designTruePeakFilter();
+	}
+
+	//==============================================================================
+	// Message thread, while no audio is processed
+	void prepare(double sampleRate, int channels, int maxBlockSize)
+	{
+		m_maxBlockSize = juce::jmax(1, maxBlockSize);
+		m_binSize = juce::jmax(1, juce::roundToInt(sampleRate / BLOCKS_PER_SECOND));
+
+		m_channels.resize((size_t)juce::jmax(0, channels));
+
+		for (auto& channel : m_channels)
+		{
+			channel.shelf = makeShelf(sampleRate);
+			channel.highPass = makeHighPass(sampleRate);
+			channel.input.assign((size_t)(PHASE_TAPS - 1 + m_maxBlockSize), 0.0f);
+			channel.weighted.assign((size_t)m_maxBlockSize, 0.0f);
+		}
+
+		m_phase.assign((size_t)m_maxBlockSize, 0.0f);
+		m_resetPending.store(true);
+	}
+
+	//==============================================================================
+	// Any thread. Consumers attach while they read the meter, the audio thread
+	// only meters while at least one is attached.
+	void attach()
+	{
+		if (m_consumers.fetch_add(1) == 0)
+			m_resetPending.store(true);
+	}
+
+	void detach() { m_consumers.fetch_sub(1); }
+
+	bool isActive() const { return m_consumers.load(std::memory_order_relaxed) > 0; }
+
+	// Clears the peak hold and the integrated loudness on the next block
+	void requestReset() { m_resetPending.store(true); }
+
+	// dBTP, highest since the last reset
+	float getTruePeak() const { return m_truePeak.load(std::memory_order_relaxed); }
+
+	// LUFS
+	float getMomentary() const { return m_momentary.load(std::memory_order_relaxed); }
+	float getShortTerm() const { return m_shortTerm.load(std::memory_order_relaxed); }
+	float getIntegrated() const { return m_integrated.load(std::memory_order_relaxed); }
+
+	//==============================================================================
+	// Audio thread
+	template <typename SampleType>
+	void process(const juce::AudioBuffer<SampleType>& buffer, int channels)
+	{
+		if (m_resetPending.exchange(false))
+		{
+			reset();
+		}
+
+		channels = juce::jmin(channels, (int)m_channels.size());
+
+		if (channels <= 0)
+		{
+			return;
+		}
+
+		// Hosts may send more samples than announced
+		for (int start = 0; start < buffer.getNumSamples(); start += m_maxBlockSize)
+		{
+			const int samples = juce::jmin(m_maxBlockSize, buffer.getNumSamples() - start);
+			float peak = 0.0f;
+
+			for (int channel = 0; channel < channels; ++channel)
+				peak = juce::jmax(peak, processChannel(m_channels[(size_t)channel], buffer.getReadPointer(channel, start), samples));
+
+			m_peakHold = juce::jmax(m_peakHold, peak);
+			integrate(channels, samples);
+		}
+
+		m_truePeak.store(gainToDecibels(m_peakHold));
+	}
+
+private:
+	// Transposed direct form II, state in double for the low shelf and high-pass poles
+	struct Biquad
+	{
+		double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+		double s1 = 0.0, s2 = 0.0;
+
+		void process(float* samples, int count)
+		{
+			for (int i = 0; i < count; ++i)
+			{
+				const double in = samples[i];
+				const double out = b0 * in + s1;
+				s1 = b1 * in - a1 * out + s2;
+				s2 = b2 * in - a2 * out;
+				samples[i] = (float)out;
+			}
+		}
+
+		void reset() { s1 = s2 = 0.0; }
+	};
+
+	struct Channel
+	{
+		Biquad shelf;
+		Biquad highPass;
+
+		// PHASE_TAPS - 1 samples of the previous block, then the current one
+		std::vector<float> input;
+		std::vector<float> weighted;
+	};
+
+	// BS.1770 stage 1, the head shelf, for any sample rate
+	static Biquad makeShelf(double sampleRate)
+	{
+		const double k = std::tan(juce::MathConstants<double>::pi * 1681.974450955533 / sampleRate);
+		const double q = 0.7071752369554196;
+		const double vh = std::pow(10.0, 3.999843853973347 / 20.0);
+		const double vb = std::pow(vh, 0.4996667741545416);
+		const double a0 = 1.0 + k / q + k * k;
+
+		Biquad biquad;
+		biquad.b0 = (vh + vb * k / q + k * k) / a0;
+		biquad.b1 = 2.0 * (k * k - vh) / a0;
+		biquad.b2 = (vh - vb * k / q + k * k) / a0;
+		biquad.a1 = 2.0 * (k * k - 1.0) / a0;
+		biquad.a2 = (1.0 - k / q + k * k) / a0;
+		return biquad;
+	}
+
+	// BS.1770 stage 2, the RLB high-pass
+	static Biquad makeHighPass(double sampleRate)
+	{
+		const double k = std::tan(juce::MathConstants<double>::pi * 38.13547087602444 / sampleRate);
+		const double q = 0.5003270373238773;
+		const double a0 = 1.0 + k / q + k * k;
+
+		Biquad biquad;
+		biquad.b0 = 1.0;
+		biquad.b1 = -2.0;
+		biquad.b2 = 1.0;
+		biquad.a1 = 2.0 * (k * k - 1.0) / a0;
+		biquad.a2 = (1.0 - k / q + k * k) / a0;
+		return biquad;
+	}
+
+	// Blackman windowed sinc with the cutoff at the original Nyquist frequency.
+	// The 48 taps are centered between phases, so the four phases sit at
+	// 1/8, 3/8, 5/8 and 7/8 of a sample and the sample peak covers the rest.
+	void designTruePeakFilter()
+	{
+		const int taps = OVERSAMPLING * PHASE_TAPS;
+		const double center = 0.5 * (taps - 1);
+
+		for (int phase = 0; phase < OVERSAMPLING; ++phase)
+		{
+			double sum = 0.0;
+
+			for (int tap = 0; tap < PHASE_TAPS; ++tap)
+			{
+				const double n = OVERSAMPLING * tap + phase - center;
+				const double x = n / OVERSAMPLING;
+				const double sinc = std::abs(x) < 1.0e-9 ? 1.0 : std::sin(juce::MathConstants<double>::pi * x) / (juce::MathConstants<double>::pi * x);
+				const double window = 0.42 + 0.5 * std::cos(juce::MathConstants<double>::pi * n / (center + 1.0)) + 0.08 * std::cos(juce::MathConstants<double>::twoPi * n / (center + 1.0));
+
+				m_taps[phase][tap] = (float)(sinc * window);
+				sum += sinc * window;
+			}
+
+			// Unity gain at DC for every phase
+			for (int tap = 0; tap < PHASE_TAPS; ++tap)
+				m_taps[phase][tap] = (float)(m_taps[phase][tap] / sum);
+		}
+	}
+
+	void reset()
+	{
+		for (auto& channel : m_channels)
+		{
+			channel.shelf.reset();
+			channel.highPass.reset();
+			std::fill(channel.input.begin(), channel.input.end(), 0.0f);
+		}
+
+		std::fill(std::begin(m_bins), std::end(m_bins), 0.0);
+		std::fill(std::begin(m_histogramCounts), std::end(m_histogramCounts), 0);
+		std::fill(std::begin(m_histogramEnergies), std::end(m_histogramEnergies), 0.0);
+
+		m_binEnergy = 0.0;
+		m_binPosition = 0;
+		m_binIndex = 0;
+		m_completeBins = 0;
+		m_peakHold = 0.0f;
+
+		m_truePeak.store(FLOOR);
+		m_momentary.store(FLOOR);
+		m_shortTerm.store(FLOOR);
+		m_integrated.store(FLOOR);
+	}
+
+	// K-weights the channel into weighted and returns its true peak
+	template <typename SampleType>
+	float processChannel(Channel& channel, const SampleType* source, int samples)
+	{
+		float* input = channel.input.data() + PHASE_TAPS - 1;
+
+		for (int sample = 0; sample < samples; ++sample)
+			input[sample] = (float)source[sample];
+
+		auto range = juce::FloatVectorOperations::findMinAndMax(input, samples);
+		float peak = juce::jmax(-range.getStart(), range.getEnd());
+
+		float* phaseOutput = m_phase.data();
+
+		for (int phase = 0; phase < OVERSAMPLING; ++phase)
+		{
+			// Output n of a phase needs inputs n - PHASE_TAPS + 1 .. n
+			juce::FloatVectorOperations::copyWithMultiply(phaseOutput, input, m_taps[phase][0], samples);
+
+			for (int tap = 1; tap < PHASE_TAPS; ++tap)
+				juce::FloatVectorOperations::addWithMultiply(phaseOutput, input - tap, m_taps[phase][tap], samples);
+
+			range = juce::FloatVectorOperations::findMinAndMax(phaseOutput, samples);
+			peak = juce::jmax(peak, -range.getStart(), range.getEnd());
+		}
+
+		float* weighted = channel.weighted.data();
+		std::copy(input, input + samples, weighted);
+		channel.shelf.process(weighted, samples);
+		channel.highPass.process(weighted, samples);
+
+		// Keep the last PHASE_TAPS - 1 inputs for the next block
+		std::copy(input + samples - (PHASE_TAPS - 1), input + samples, channel.input.begin());
+
+		return peak;
+	}
+
+	// Sums the weighted channels into 100 ms bins and publishes the readings whenever one completes
+	void integrate(int channels, int samples)
+	{
+		int sample = 0;
+
+		while (sample < samples)
+		{
+			const int count = juce::jmin(samples - sample, m_binSize - m_binPosition);
+
+			for (int channel = 0; channel < channels; ++channel)
+			{
+				const float* weighted = m_channels[(size_t)channel].weighted.data() + sample;
+				float sum = 0.0f;
+
+				for (int i = 0; i < count; ++i)
+					sum += weighted[i] * weighted[i];
+
+				m_binEnergy += sum;
+			}
+
+			sample += count;
+			m_binPosition += count;
+
+			if (m_binPosition == m_binSize)
+			{
+				completeBin();
+			}
+		}
+	}
+
+	void completeBin()
+	{
+		m_bins[m_binIndex] = m_binEnergy;
+		m_binIndex = (m_binIndex + 1) % SHORT_TERM_BLOCKS;
+		m_binEnergy = 0.0;
+		m_binPosition = 0;
+		m_completeBins++;
+
+		const double momentary = sumBins(MOMENTARY_BLOCKS) / (MOMENTARY_BLOCKS * m_binSize);
+		const double shortTerm = sumBins(SHORT_TERM_BLOCKS) / (SHORT_TERM_BLOCKS * m_binSize);
+
+		m_momentary.store(energyToLoudness(momentary));
+		m_shortTerm.store(energyToLoudness(shortTerm));
+
+		// Gating blocks of 400 ms overlap by 75 %, one starts with every bin
+		if (m_completeBins < MOMENTARY_BLOCKS)
+		{
+			return;
+		}
+
+		const float loudness = energyToLoudness(momentary);
+
+		if (loudness > MIN_LOUDNESS)
+		{
+			const int index = juce::jlimit(0, HISTOGRAM_SIZE - 1, (int)((loudness - MIN_LOUDNESS) / HISTOGRAM_STEP));
+			m_histogramCounts[index]++;
+			m_histogramEnergies[index] += momentary;
+		}
+
+		m_integrated.store(computeIntegrated());
+	}
+
+	double sumBins(int count) const
+	{
+		double sum = 0.0;
+
+		for (int i = 1; i <= count; ++i)
+			sum += m_bins[(m_binIndex - i + SHORT_TERM_BLOCKS) % SHORT_TERM_BLOCKS];
+
+		return sum;
+	}
+
+	// Mean of the blocks above the absolute gate sets the relative gate, the mean above both is the reading
+	float computeIntegrated() const
+	{
+		juce::int64 count = 0;
+		double energy = 0.0;
+
+		for (int i = 0; i < HISTOGRAM_SIZE; ++i)
+		{
+			count += m_histogramCounts[i];
+			energy += m_histogramEnergies[i];
+		}
+
+		if (count == 0)
+		{
+			return FLOOR;
+		}
+
+		const float gate = energyToLoudness(energy / (double)count) + RELATIVE_GATE;
+		const int first = juce::jlimit(0, HISTOGRAM_SIZE, (int)std::ceil((gate - MIN_LOUDNESS) / HISTOGRAM_STEP));
+
+		count = 0;
+		energy = 0.0;
+
+		for (int i = first; i < HISTOGRAM_SIZE; ++i)
+		{
+			count += m_histogramCounts[i];
+			energy += m_histogramEnergies[i];
+		}
+
+		return count > 0 ? energyToLoudness(energy / (double)count) : FLOOR;
+	}
+
+	static float energyToLoudness(double energy)
+	{
+		return energy > 0.0 ? juce::jmax(FLOOR, (float)(-0.691 + 10.0 * std::log10(energy))) : FLOOR;
+	}
+
+	static float gainToDecibels(float gain)
+	{
+		return gain > 0.0f ? juce::jmax(FLOOR, 20.0f * std::log10(gain)) : FLOOR;
+	}
+
+	//==============================================================================
+	std::atomic<int> m_consumers { 0 };
+	std::atomic<bool> m_resetPending { true };
+
+	std::atomic<float> m_truePeak { FLOOR };
+	std::atomic<float> m_momentary { FLOOR };
+	std::atomic<float> m_shortTerm { FLOOR };
+	std::atomic<float> m_integrated { FLOOR };
+
+	// Audio thread
+	float m_taps[OVERSAMPLING][PHASE_TAPS] = {};
+	std::vector<Channel> m_channels;
+	std::vector<float> m_phase;
+	int m_maxBlockSize = 1;
+	float m_peakHold = 0.0f;
+
+	// Energy of the last SHORT_TERM_BLOCKS bins, circular
+	double m_bins[SHORT_TERM_BLOCKS] = {};
+	double m_binEnergy = 0.0;
+	int m_binSize = 4800;
+	int m_binPosition = 0;
+	int m_binIndex = 0;
+	juce::int64 m_completeBins = 0;
+
+	int m_histogramCounts[HISTOGRAM_SIZE] = {};
+	double m_histogramEnergies[HISTOGRAM_SIZE] = {};
+};
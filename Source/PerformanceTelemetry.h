@@ -0,0 +1,316 @@
+/*
+  ==============================================================================
+
+    Per block performance telemetry.
+
+    While enabled, processBlock fills one BlockRecord per call and pushes it
+    into a wait-free single producer / single consumer FIFO. A collector
+    thread drains the FIFO and keeps the histograms shown by the editor
+    overlay. The audio thread never allocates or locks.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "EnhancerKernel.h"
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+//==============================================================================
+struct BlockRecord
+{
+	juce::uint64 cycles = 0;
+	juce::int64 ticks = 0;
+	double sampleRate = 48000.0;
+	int blockSize = 0;
+	int mode = 0;
+	int oversamplingIndex = 0;
+	int instructionSet = 0;
+	int coefficientUpdates = 0;
+
+	// Silent block, skipped without processing
+	bool skipped = false;
+};
+
+//==============================================================================
+// Linear bins from 0, the last bin collects everything above
+class Histogram
+{
+public:
+	Histogram(int numBins, double binWidth)
+		: m_counts((size_t)numBins + 1, 0), m_binWidth(binWidth)
+	{
+	}
+
+	void add(double value)
+	{
+		const int bin = juce::jlimit(0, getNumBins(), (int)(value / m_binWidth));
+
+		++m_counts[(size_t)bin];
+		++m_total;
+		m_max = juce::jmax(m_max, value);
+	}
+
+	void clear()
+	{
+		std::fill(m_counts.begin(), m_counts.end(), 0);
+		m_total = 0;
+		m_max = 0.0;
+	}
+
+	// Upper edge of the bin that contains the given fraction of all values
+	double getPercentile(double fraction) const
+	{
+		const juce::int64 target = (juce::int64)std::ceil(fraction * m_total);
+		juce::int64 count = 0;
+
+		for (int bin = 0; bin < getNumBins(); ++bin)
+		{
+			count += m_counts[(size_t)bin];
+
+			if (count >= target && count > 0)
+				return (bin + 1) * m_binWidth;
+		}
+
+		return m_max;
+	}
+
+	int getNumBins() const { return (int)m_counts.size() - 1; }
+	juce::int64 getCount(int bin) const { return m_counts[(size_t)bin]; }
+	juce::int64 getTotal() const { return m_total; }
+	double getBinWidth() const { return m_binWidth; }
+	double getMax() const { return m_max; }
+
+private:
+	std::vector<juce::int64> m_counts;
+	double m_binWidth;
+	juce::int64 m_total = 0;
+	double m_max = 0.0;
+};
+
+//==============================================================================
+class PerformanceTelemetry : private juce::Thread
+{
+public:
+	static const int FIFO_SIZE = 4096;
+	static const int COLLECT_INTERVAL_MS = 20;
+
+	struct Statistics
+	{
+		// Callback time in percent of the block duration, and cycles per sample
+		Histogram load { 200, 1.0 };
+		Histogram cyclesPerSample { 200, 5.0 };
+
+		juce::int64 blocks = 0;
+		juce::int64 skippedBlocks = 0;
+		juce::int64 deadlineMisses = 0;
+		juce::int64 coefficientUpdates = 0;
+		juce::int64 droppedRecords = 0;
+		int minBlockSize = 0;
+		int maxBlockSize = 0;
+		int oversamplingIndex = 0;
+		int instructionSet = 0;
+
+		juce::int64 modeBlocks[N_DISTORTION_MODES] = {};
+		juce::int64 modeSamples[N_DISTORTION_MODES] = {};
+		double modeCycles[N_DISTORTION_MODES] = {};
+	};
+
+	PerformanceTelemetry()
+		: juce::Thread("Telemetry")
+	{
+	}
+
+	~PerformanceTelemetry() override
+	{
+		stopThread(1000);
+	}
+
+	//==============================================================================
+	// Message thread
+	void setEnabled(bool shouldBeEnabled)
+	{
+		if (shouldBeEnabled == m_enabled.load())
+		{
+			return;
+		}
+
+		if (shouldBeEnabled)
+		{
+			clear();
+			m_enabled.store(true);
+			startThread();
+		}
+		else
+		{
+			m_enabled.store(false);
+			stopThread(1000);
+		}
+	}
+
+	void clear()
+	{
+		const juce::ScopedLock lock(m_lock);
+		m_statistics = Statistics();
+	}
+
+	Statistics getStatistics() const
+	{
+		const juce::ScopedLock lock(m_lock);
+		return m_statistics;
+	}
+
+	bool dumpToFile(const juce::File& file) const;
+
+	//==============================================================================
+	// Audio thread
+	bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+	// Wait-free, records are dropped while the FIFO is full
+	void push(const BlockRecord& record)
+	{
+		int start1, size1, start2, size2;
+		m_fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+		if (size1 > 0)
+		{
+			m_records[(size_t)start1] = record;
+			m_fifo.finishedWrite(1);
+		}
+		else
+		{
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	static juce::uint64 readCycleCounter()
+	{
+	#if JUCE_INTEL
+		return __rdtsc();
+	#else
+		return (juce::uint64)juce::Time::getHighResolutionTicks();
+	#endif
+	}
+
+private:
+	void run() override
+	{
+		while (!threadShouldExit())
+		{
+			collect();
+			wait(COLLECT_INTERVAL_MS);
+		}
+
+		collect();
+	}
+
+	void collect()
+	{
+		int start1, size1, start2, size2;
+		m_fifo.prepareToRead(m_fifo.getNumReady(), start1, size1, start2, size2);
+
+		const juce::ScopedLock lock(m_lock);
+
+		for (int i = 0; i < size1; ++i)
+			add(m_records[(size_t)(start1 + i)]);
+
+		for (int i = 0; i < size2; ++i)
+			add(m_records[(size_t)(start2 + i)]);
+
+		m_fifo.finishedRead(size1 + size2);
+
+		m_statistics.droppedRecords = m_dropped.load(std::memory_order_relaxed);
+	}
+
+	void add(const BlockRecord& record)
+	{
+		if (record.blockSize <= 0)
+		{
+			return;
+		}
+
+		auto& statistics = m_statistics;
+		const double seconds = juce::Time::highResolutionTicksToSeconds(record.ticks);
+		const double deadline = record.blockSize / record.sampleRate;
+
+		statistics.load.add(100.0 * seconds / deadline);
+		statistics.cyclesPerSample.add((double)record.cycles / record.blockSize);
+
+		statistics.minBlockSize = statistics.blocks == 0 ? record.blockSize : juce::jmin(statistics.minBlockSize, record.blockSize);
+		statistics.maxBlockSize = juce::jmax(statistics.maxBlockSize, record.blockSize);
+		statistics.oversamplingIndex = record.oversamplingIndex;
+		statistics.instructionSet = record.instructionSet;
+		statistics.coefficientUpdates += record.coefficientUpdates;
+		statistics.blocks++;
+
+		if (record.skipped)
+			statistics.skippedBlocks++;
+
+		if (seconds > deadline)
+			statistics.deadlineMisses++;
+
+		if (juce::isPositiveAndBelow(record.mode, (int)N_DISTORTION_MODES))
+		{
+			statistics.modeBlocks[record.mode]++;
+			statistics.modeSamples[record.mode] += record.blockSize;
+			statistics.modeCycles[record.mode] += (double)record.cycles;
+		}
+	}
+
+	std::atomic<bool> m_enabled { false };
+	std::atomic<juce::int64> m_dropped { 0 };
+
+	juce::AbstractFifo m_fifo { FIFO_SIZE };
+	std::vector<BlockRecord> m_records = std::vector<BlockRecord>((size_t)FIFO_SIZE);
+
+	juce::CriticalSection m_lock;
+	Statistics m_statistics;
+};
+
+//==============================================================================
+inline bool PerformanceTelemetry::dumpToFile(const juce::File& file) const
+{
+	static const char* const modeNames[N_DISTORTION_MODES] = { "A", "B", "C", "D", "E" };
+	const Statistics statistics = getStatistics();
+
+	juce::String text;
+	text << "# BassEnhancer telemetry, " << juce::Time::getCurrentTime().toISO8601(true) << "\n"
+	     << "blocks," << statistics.blocks << "\n"
+	     << "skipped_blocks," << statistics.skippedBlocks << "\n"
+	     << "deadline_misses," << statistics.deadlineMisses << "\n"
+	     << "dropped_records," << statistics.droppedRecords << "\n"
+	     << "coefficient_updates," << statistics.coefficientUpdates << "\n"
+	     << "block_size_min," << statistics.minBlockSize << "\n"
+	     << "block_size_max," << statistics.maxBlockSize << "\n"
+	     << "instruction_set," << CpuDispatch::getName(statistics.instructionSet) << "\n"
+	     << "load_percent_p50," << statistics.load.getPercentile(0.5) << "\n"
+	     << "load_percent_p99," << statistics.load.getPercentile(0.99) << "\n"
+	     << "load_percent_max," << statistics.load.getMax() << "\n";
+
+	for (int mode = 0; mode < N_DISTORTION_MODES; ++mode)
+	{
+		const double cyclesPerSample = statistics.modeSamples[mode] > 0 ? statistics.modeCycles[mode] / statistics.modeSamples[mode] : 0.0;
+		text << "mode_" << modeNames[mode] << "_blocks," << statistics.modeBlocks[mode] << "\n"
+		     << "mode_" << modeNames[mode] << "_cycles_per_sample," << cyclesPerSample << "\n";
+	}
+
+	text << "\nload_percent,blocks\n";
+
+	for (int bin = 0; bin <= statistics.load.getNumBins(); ++bin)
+		text << bin * statistics.load.getBinWidth() << "," << statistics.load.getCount(bin) << "\n";
+
+	text << "\ncycles_per_sample,blocks\n";
+
+	for (int bin = 0; bin <= statistics.cyclesPerSample.getNumBins(); ++bin)
+		text << bin * statistics.cyclesPerSample.getBinWidth() << "," << statistics.cyclesPerSample.getCount(bin) << "\n";
+
+	return file.replaceWithText(text);
+}
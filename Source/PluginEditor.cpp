@@ -11,7 +11,7 @@
 
 //==============================================================================
 BassEnhancerAudioProcessorEditor::BassEnhancerAudioProcessorEditor (BassEnhancerAudioProcessor& p, juce::AudioProcessorValueTreeState& vts)
-    : AudioProcessorEditor (&p), audioProcessor (p), valueTreeState(vts)
+    : AudioProcessorEditor (&p), audioProcessor (p), valueTreeState(vts), spectrumView(p.getAnalyzer(), p.getTracker(), vts), meterView(p.getMeter()), telemetryOverlay(p.getTelemetry())
 {
 	juce::Colour light = juce::Colour::fromHSV(HUE * 0.01f, 0.5f, 0.6f, 1.0f);
 	juce::Colour medium = juce::Colour::fromHSV(HUE * 0.01f, 0.5f, 0.5f, 1.0f);
@@ -44,33 +44,122 @@ BassEnhancerAudioProcessorEditor::BassEnhancerAudioProcessorEditor (BassEnhancer
 	addAndMakeVisible(typeBButton);
 	addAndMakeVisible(typeCButton);
 	addAndMakeVisible(typeDButton);
+	addAndMakeVisible(typeEButton);
 
 	typeAButton.setRadioGroupId(TYPE_BUTTON_GROUP);
 	typeBButton.setRadioGroupId(TYPE_BUTTON_GROUP);
 	typeCButton.setRadioGroupId(TYPE_BUTTON_GROUP);
 	typeDButton.setRadioGroupId(TYPE_BUTTON_GROUP);
+	typeEButton.setRadioGroupId(TYPE_BUTTON_GROUP);
 
 	typeAButton.setClickingTogglesState(true);
 	typeBButton.setClickingTogglesState(true);
 	typeCButton.setClickingTogglesState(true);
 	typeDButton.setClickingTogglesState(true);
+	typeEButton.setClickingTogglesState(true);
 
 	buttonAAttachment.reset(new juce::AudioProcessorValueTreeState::ButtonAttachment(valueTreeState, "ButtonA", typeAButton));
 	buttonBAttachment.reset(new juce::AudioProcessorValueTreeState::ButtonAttachment(valueTreeState, "ButtonB", typeBButton));
 	buttonCAttachment.reset(new juce::AudioProcessorValueTreeState::ButtonAttachment(valueTreeState, "ButtonC", typeCButton));
 	buttonDAttachment.reset(new juce::AudioProcessorValueTreeState::ButtonAttachment(valueTreeState, "ButtonD", typeDButton));
+	buttonEAttachment.reset(new juce::AudioProcessorValueTreeState::ButtonAttachment(valueTreeState, "ButtonE", typeEButton));
 
 	typeAButton.setColour(juce::TextButton::buttonColourId, light);
 	typeBButton.setColour(juce::TextButton::buttonColourId, light);
 	typeCButton.setColour(juce::TextButton::buttonColourId, light);
 	typeDButton.setColour(juce::TextButton::buttonColourId, light);
+	typeEButton.setColour(juce::TextButton::buttonColourId, light);
 
 	typeAButton.setColour(juce::TextButton::buttonOnColourId, dark);
 	typeBButton.setColour(juce::TextButton::buttonOnColourId, dark);
 	typeCButton.setColour(juce::TextButton::buttonOnColourId, dark);
 	typeDButton.setColour(juce::TextButton::buttonOnColourId, dark);
+	typeEButton.setColour(juce::TextButton::buttonOnColourId, dark);
 
-	setSize((int)(SLIDER_WIDTH * 0.01f * SCALE * N_SLIDERS_COUNT), (int)((SLIDER_WIDTH + BOTTOM_MENU_HEIGHT) * 0.01f * SCALE));
+	// Harmonics
+	harmonicsLabel.setText("Harmonics 2 - 8", juce::dontSendNotification);
+	harmonicsLabel.setJustificationType(juce::Justification::centred);
+	addAndMakeVisible(harmonicsLabel);
+
+	for (int i = 0; i < HarmonicRange::N_HARMONICS; ++i)
+	{
+		auto& slider = m_harmonicSliders[i];
+		const int harmonic = HarmonicRange::FIRST_HARMONIC + i;
+
+		slider.setSliderStyle(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag);
+		slider.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 40, 14);
+		addAndMakeVisible(slider);
+		m_harmonicAttachments[i].reset(new SliderAttachment(valueTreeState, BassEnhancerAudioProcessor::getHarmonicParameterID(harmonic), slider));
+	}
+
+	// Oversampling
+	oversamplingLabel.setText("Realtime", juce::dontSendNotification);
+	offlineOversamplingLabel.setText("Offline", juce::dontSendNotification);
+	oversamplingLabel.setJustificationType(juce::Justification::centredRight);
+	offlineOversamplingLabel.setJustificationType(juce::Justification::centredRight);
+	addAndMakeVisible(oversamplingLabel);
+	addAndMakeVisible(offlineOversamplingLabel);
+
+	oversamplingComboBox.addItemList(BassEnhancerAudioProcessor::oversamplingNames, 1);
+	offlineOversamplingComboBox.addItemList(BassEnhancerAudioProcessor::oversamplingNames, 1);
+	addAndMakeVisible(oversamplingComboBox);
+	addAndMakeVisible(offlineOversamplingComboBox);
+
+	oversamplingAttachment.reset(new ComboBoxAttachment(valueTreeState, "Oversampling", oversamplingComboBox));
+	offlineOversamplingAttachment.reset(new ComboBoxAttachment(valueTreeState, "OversamplingOffline", offlineOversamplingComboBox));
+
+	// Antialiasing
+	antialiasingLabel.setText("AA", juce::dontSendNotification);
+	antialiasingLabel.setJustificationType(juce::Justification::centredRight);
+	addAndMakeVisible(antialiasingLabel);
+
+	antialiasingComboBox.addItemList(BassEnhancerAudioProcessor::antialiasingNames, 1);
+	addAndMakeVisible(antialiasingComboBox);
+
+	antialiasingAttachment.reset(new ComboBoxAttachment(valueTreeState, "Antialiasing", antialiasingComboBox));
+
+	// Linear phase
+	addAndMakeVisible(linearPhaseButton);
+	linearPhaseButton.setClickingTogglesState(true);
+	linearPhaseButton.setColour(juce::TextButton::buttonColourId, light);
+	linearPhaseButton.setColour(juce::TextButton::buttonOnColourId, dark);
+	linearPhaseAttachment.reset(new juce::AudioProcessorValueTreeState::ButtonAttachment(valueTreeState, "LinearPhase", linearPhaseButton));
+
+	// Double precision
+	addAndMakeVisible(doublePrecisionButton);
+	doublePrecisionButton.setClickingTogglesState(true);
+	doublePrecisionButton.setColour(juce::TextButton::buttonColourId, light);
+	doublePrecisionButton.setColour(juce::TextButton::buttonOnColourId, dark);
+	doublePrecisionAttachment.reset(new juce::AudioProcessorValueTreeState::ButtonAttachment(valueTreeState, "DoublePrecision", doublePrecisionButton));
+
+	// Mid/side
+	addAndMakeVisible(midSideButton);
+	midSideButton.setClickingTogglesState(true);
+	midSideButton.setColour(juce::TextButton::buttonColourId, light);
+	midSideButton.setColour(juce::TextButton::buttonOnColourId, dark);
+	midSideAttachment.reset(new juce::AudioProcessorValueTreeState::ButtonAttachment(valueTreeState, "MidSide", midSideButton));
+
+	// Frequency tracking
+	addAndMakeVisible(trackingButton);
+	trackingButton.setClickingTogglesState(true);
+	trackingButton.setColour(juce::TextButton::buttonColourId, light);
+	trackingButton.setColour(juce::TextButton::buttonOnColourId, dark);
+	trackingAttachment.reset(new juce::AudioProcessorValueTreeState::ButtonAttachment(valueTreeState, "Tracking", trackingButton));
+
+	// Spectrum
+	addAndMakeVisible(spectrumView);
+	addAndMakeVisible(meterView);
+
+	// Telemetry
+	addChildComponent(telemetryOverlay);
+	addAndMakeVisible(telemetryButton);
+
+	telemetryButton.setClickingTogglesState(true);
+	telemetryButton.setColour(juce::TextButton::buttonColourId, light);
+	telemetryButton.setColour(juce::TextButton::buttonOnColourId, dark);
+	telemetryButton.onClick = [this] { telemetryOverlay.setActive(telemetryButton.getToggleState()); };
+
+	setSize((int)(SLIDER_WIDTH * 0.01f * SCALE * N_SLIDERS_COUNT), (int)((SPECTRUM_HEIGHT + SLIDER_WIDTH + HARMONICS_HEIGHT + BOTTOM_MENU_HEIGHT) * 0.01f * SCALE));
 }
 
 BassEnhancerAudioProcessorEditor::~BassEnhancerAudioProcessorEditor()
@@ -84,6 +173,11 @@ void BassEnhancerAudioProcessorEditor::paint (juce::Graphics& g)
 
 void BassEnhancerAudioProcessorEditor::resized()
 {
+	// Spectrum
+	const int spectrumHeight = (int)(SPECTRUM_HEIGHT * 0.01f * SCALE);
+	spectrumView.setBounds(0, 0, getWidth(), spectrumHeight);
+	meterView.setBounds(getWidth() / 2, 0, getWidth() / 2, METER_HEIGHT);
+
 	// Sliders + Menus
 	int width = getWidth() / N_SLIDERS_COUNT;
 	int height = SLIDER_WIDTH * 0.01f * SCALE;
@@ -92,20 +186,54 @@ void BassEnhancerAudioProcessorEditor::resized()
 	for (int i = 0; i < N_SLIDERS_COUNT; ++i)
 	{
 		rectangles[i].setSize(width, height);
-		rectangles[i].setPosition(i * width, 0);
+		rectangles[i].setPosition(i * width, spectrumHeight);
 		m_sliders[i].setBounds(rectangles[i]);
 
 		rectangles[i].removeFromBottom((int)(LABEL_OFFSET * 0.01f * SCALE));
 		m_labels[i].setBounds(rectangles[i]);
 	}
 
+	// Harmonics
+	const int harmonicsY = spectrumHeight + height;
+	const int harmonicsHeight = (int)(HARMONICS_HEIGHT * 0.01f * SCALE);
+	const int harmonicWidth = getWidth() / (HarmonicRange::N_HARMONICS + 1);
+
+	harmonicsLabel.setBounds(0, harmonicsY, harmonicWidth, harmonicsHeight);
+
+	for (int i = 0; i < HarmonicRange::N_HARMONICS; ++i)
+		m_harmonicSliders[i].setBounds((i + 1) * harmonicWidth, harmonicsY, harmonicWidth, harmonicsHeight);
+
 	// Buttons
-	const int posY = height + (int)(BOTTOM_MENU_HEIGHT * 0.01f * SCALE * 0.25f);
+	const int posY = harmonicsY + harmonicsHeight + (int)(BOTTOM_MENU_HEIGHT * 0.01f * SCALE * 0.25f);
 	const int buttonHeight = (int)(BOTTOM_MENU_HEIGHT * 0.01f * SCALE * 0.5f);
 	const int center = (int)(getWidth() * 0.5f);
 
-	typeAButton.setBounds((int)(center - buttonHeight * 2.4f), posY, buttonHeight, buttonHeight);
-	typeBButton.setBounds((int)(center - buttonHeight * 1.2f), posY, buttonHeight, buttonHeight);
-	typeCButton.setBounds((int)(center + buttonHeight * 0.0f), posY, buttonHeight, buttonHeight);
-	typeDButton.setBounds((int)(center + buttonHeight * 1.2f), posY, buttonHeight, buttonHeight);
+	typeAButton.setBounds((int)(center - buttonHeight * 3.0f), posY, buttonHeight, buttonHeight);
+	typeBButton.setBounds((int)(center - buttonHeight * 1.8f), posY, buttonHeight, buttonHeight);
+	typeCButton.setBounds((int)(center - buttonHeight * 0.6f), posY, buttonHeight, buttonHeight);
+	typeDButton.setBounds((int)(center + buttonHeight * 0.6f), posY, buttonHeight, buttonHeight);
+	typeEButton.setBounds((int)(center + buttonHeight * 1.8f), posY, buttonHeight, buttonHeight);
+
+	// Oversampling
+	const int comboBoxWidth = buttonHeight * 3;
+
+	oversamplingLabel.setBounds(0, posY, comboBoxWidth, buttonHeight);
+	oversamplingComboBox.setBounds(comboBoxWidth, posY, comboBoxWidth, buttonHeight);
+
+	offlineOversamplingLabel.setBounds(getWidth() - 2 * comboBoxWidth, posY, comboBoxWidth, buttonHeight);
+	offlineOversamplingComboBox.setBounds(getWidth() - comboBoxWidth, posY, comboBoxWidth, buttonHeight);
+
+	// Antialiasing, between the realtime oversampling and the buttons
+	antialiasingLabel.setBounds(2 * comboBoxWidth, posY, comboBoxWidth / 2, buttonHeight);
+	antialiasingComboBox.setBounds(2 * comboBoxWidth + comboBoxWidth / 2, posY, comboBoxWidth, buttonHeight);
+
+	// Linear phase, top left of the sliders
+	linearPhaseButton.setBounds(0, spectrumHeight, comboBoxWidth, buttonHeight);
+	doublePrecisionButton.setBounds(0, spectrumHeight + buttonHeight, comboBoxWidth, buttonHeight);
+	midSideButton.setBounds(0, spectrumHeight + 2 * buttonHeight, comboBoxWidth, buttonHeight);
+	trackingButton.setBounds(0, spectrumHeight + 3 * buttonHeight, comboBoxWidth, buttonHeight);
+
+	// Telemetry
+	telemetryOverlay.setBounds(0, spectrumHeight, getWidth(), height);
+	telemetryButton.setBounds(getWidth() - comboBoxWidth / 2, spectrumHeight, comboBoxWidth / 2, buttonHeight);
 }
\ No newline at end of file
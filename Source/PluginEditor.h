@@ -10,6 +10,9 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "TelemetryOverlay.h"
+#include "SpectrumView.h"
+#include "MeterView.h"
 
 //==============================================================================
 class BassEnhancerAudioProcessorEditor : public juce::AudioProcessorEditor
@@ -24,6 +27,9 @@ public:
 	static const int LABEL_OFFSET = 25;
 	static const int SLIDER_WIDTH = 200;
 	static const int BOTTOM_MENU_HEIGHT = 50;
+	static const int HARMONICS_HEIGHT = 60;
+	static const int SPECTRUM_HEIGHT = 150;
+	static const int METER_HEIGHT = 16;
 	static const int HUE = 70;
 
 	static const int TYPE_BUTTON_GROUP = 1;
@@ -52,11 +58,57 @@ private:
 	juce::TextButton typeBButton{ "B" };
 	juce::TextButton typeCButton{ "C" };
 	juce::TextButton typeDButton{ "D" };
+	juce::TextButton typeEButton{ "E" };
 
 	std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> buttonAAttachment;
 	std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> buttonBAttachment;
 	std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> buttonCAttachment;
 	std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> buttonDAttachment;
+	std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> buttonEAttachment;
+
+	// Mode E harmonic weights
+	juce::Label harmonicsLabel;
+	juce::Slider m_harmonicSliders[HarmonicRange::N_HARMONICS] = {};
+	std::unique_ptr<SliderAttachment> m_harmonicAttachments[HarmonicRange::N_HARMONICS] = {};
+
+	juce::Label oversamplingLabel;
+	juce::Label offlineOversamplingLabel;
+
+	juce::ComboBox oversamplingComboBox;
+	juce::ComboBox offlineOversamplingComboBox;
+
+	std::unique_ptr<ComboBoxAttachment> oversamplingAttachment;
+	std::unique_ptr<ComboBoxAttachment> offlineOversamplingAttachment;
+
+	juce::Label antialiasingLabel;
+	juce::ComboBox antialiasingComboBox;
+	std::unique_ptr<ComboBoxAttachment> antialiasingAttachment;
+
+	// Input / output spectrum above the sliders
+	SpectrumView spectrumView;
+
+	// Output true peak and loudness over the top of the spectrum
+	MeterView meterView;
+
+	// Linear-phase band split
+	juce::TextButton linearPhaseButton{ "Linear" };
+	std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> linearPhaseAttachment;
+
+	// Double precision state behind float I/O
+	juce::TextButton doublePrecisionButton{ "64-bit" };
+	std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> doublePrecisionAttachment;
+
+	// Enhances mid only, side passes dry
+	juce::TextButton midSideButton{ "M/S" };
+	std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> midSideAttachment;
+
+	// Frequency follows the detected bass fundamental
+	juce::TextButton trackingButton{ "Track" };
+	std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> trackingAttachment;
+
+	// Performance overlay over the sliders
+	juce::TextButton telemetryButton{ "Perf" };
+	TelemetryOverlay telemetryOverlay;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BassEnhancerAudioProcessorEditor)
 };
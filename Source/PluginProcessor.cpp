@@ -9,48 +9,9 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
-//==============================================================================
-SecondOrderAllPass::SecondOrderAllPass()
-{
-}
-
-void SecondOrderAllPass::init(int sampleRate)
-{
-	m_sampleRate = sampleRate;
-}
-
-void SecondOrderAllPass::setCoef(float frequency, float Q)
-{
-	if (m_sampleRate == 0)
-	{
-		return;
-	}
-
-	float bandWidth = frequency / Q;
-	float t = std::tanf(3.141593f * bandWidth / m_sampleRate);
-	float c = (t - 1.0f) / (t + 1.0f);
-	float d = -1.0f * std::cosf(2.0f * 3.141593f * frequency / m_sampleRate);
-	
-	m_a1 = d * (1.0f - c);
-	m_a2 = -c;
-	m_b0 = m_a2;
-	m_b1 = m_a1;
-}
-
-float SecondOrderAllPass::process(float in)
-{
-	float y = m_b0 * in + m_b1 * m_x1 + m_b2 * m_x2 - m_a1 * m_y1 - m_a2 * m_y2;
-
-	m_y2 = m_y1;
-	m_y1 = y;
-	m_x2 = m_x1;
-	m_x1 = in;
-
-	return y;
-}
-//==============================================================================
-
 const std::string BassEnhancerAudioProcessor::paramsNames[] = { "Frequency", "Gain", "Mix", "Volume" };
+const juce::StringArray BassEnhancerAudioProcessor::oversamplingNames = { "1x", "2x", "4x", "8x" };
+const juce::StringArray BassEnhancerAudioProcessor::antialiasingNames = { "Off", "ADAA 1", "ADAA 2" };
 
 //==============================================================================
 BassEnhancerAudioProcessor::BassEnhancerAudioProcessor()
@@ -74,10 +35,102 @@ BassEnhancerAudioProcessor::BassEnhancerAudioProcessor()
 	buttonBParameter = static_cast<juce::AudioParameterBool*>(apvts.getParameter("ButtonB"));
 	buttonCParameter = static_cast<juce::AudioParameterBool*>(apvts.getParameter("ButtonC"));
 	buttonDParameter = static_cast<juce::AudioParameterBool*>(apvts.getParameter("ButtonD"));
+	buttonEParameter = static_cast<juce::AudioParameterBool*>(apvts.getParameter("ButtonE"));
+
+	for (int i = 0; i < HarmonicRange::N_HARMONICS; ++i)
+		harmonicParameters[i] = apvts.getRawParameterValue(getHarmonicParameterID(HarmonicRange::FIRST_HARMONIC + i));
+
+	oversamplingParameter        = static_cast<juce::AudioParameterChoice*>(apvts.getParameter("Oversampling"));
+	offlineOversamplingParameter = static_cast<juce::AudioParameterChoice*>(apvts.getParameter("OversamplingOffline"));
+	antialiasingParameter        = static_cast<juce::AudioParameterChoice*>(apvts.getParameter("Antialiasing"));
+	linearPhaseParameter         = static_cast<juce::AudioParameterBool*>(apvts.getParameter("LinearPhase"));
+	doublePrecisionParameter     = static_cast<juce::AudioParameterBool*>(apvts.getParameter("DoublePrecision"));
+	midSideParameter             = static_cast<juce::AudioParameterBool*>(apvts.getParameter("MidSide"));
+	trackingParameter            = static_cast<juce::AudioParameterBool*>(apvts.getParameter("Tracking"));
+	bypassParameter              = static_cast<juce::AudioParameterBool*>(apvts.getParameter("Bypass"));
+
+	for (int i = 0; i < PresetBank::N_PARAMETERS; ++i)
+	{
+		m_presetParameters[i] = apvts.getParameter(PresetBank::PARAMETER_IDS[i]);
+		m_presetRawValues[i] = apvts.getRawParameterValue(PresetBank::PARAMETER_IDS[i]);
+		jassert(m_presetParameters[i] != nullptr && m_presetRawValues[i] != nullptr);
+	}
+
+	apvts.addParameterListener("ButtonA", this);
+	apvts.addParameterListener("ButtonB", this);
+	apvts.addParameterListener("ButtonC", this);
+	apvts.addParameterListener("ButtonD", this);
+	apvts.addParameterListener("ButtonE", this);
+
+	m_distortionMode.store(getDistortionMode());
 }
 
 BassEnhancerAudioProcessor::~BassEnhancerAudioProcessor()
 {
+	m_designThread->removeTimeSliceClient(&m_bandSplit);
+	m_trackerThread->removeTimeSliceClient(&m_tracker);
+
+	apvts.removeParameterListener("ButtonA", this);
+	apvts.removeParameterListener("ButtonB", this);
+	apvts.removeParameterListener("ButtonC", this);
+	apvts.removeParameterListener("ButtonD", this);
+	apvts.removeParameterListener("ButtonE", this);
+}
+
+void BassEnhancerAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
+{
+	m_distortionMode.store(getDistortionMode());
+}
+
+void BassEnhancerAudioProcessor::handleAsyncUpdate()
+{
+	// setLatencySamples calls into the host, which may lock or allocate
+	setLatencySamples(m_latencySamples.load());
+
+	// The APVTS, the editor and the host pick up the new program's values
+	if (m_programChanged.exchange(false))
+	{
+		for (auto* parameter : m_presetParameters)
+			parameter->sendValueChangedMessageToListeners(parameter->getValue());
+
+		updateHostDisplay(ChangeDetails().withProgramChanged(true).withParameterInfoChanged(true));
+	}
+}
+
+int BassEnhancerAudioProcessor::getDistortionMode() const
+{
+	if (buttonAParameter->get())
+	{
+		return DISTORTION_MODE_A;
+	}
+	else if (buttonBParameter->get())
+	{
+		return DISTORTION_MODE_B;
+	}
+	else if (buttonCParameter->get())
+	{
+		return DISTORTION_MODE_C;
+	}
+	else if (buttonEParameter->get())
+	{
+		return DISTORTION_MODE_E;
+	}
+
+	return DISTORTION_MODE_D;
+}
+
+float BassEnhancerAudioProcessor::getTargetFrequency() const
+{
+	// Until the tracker has found a fundamental the knob still counts
+	if (trackingParameter->get())
+	{
+		const float tracked = m_tracker.getFrequency();
+
+		if (tracked > 0.0f)
+			return tracked;
+	}
+
+	return frequencyParameter->load();
 }
 
 //==============================================================================
@@ -115,52 +168,320 @@ bool BassEnhancerAudioProcessor::isMidiEffect() const
 
 double BassEnhancerAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+	return m_tailSeconds.load();
 }
 
 int BassEnhancerAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+	return m_presetBank->size();
 }
 
 int BassEnhancerAudioProcessor::getCurrentProgram()
 {
-    return 0;
+	return m_currentProgram.load();
 }
 
 void BassEnhancerAudioProcessor::setCurrentProgram (int index)
 {
+	if (!juce::isPositiveAndBelow(index, m_presetBank->size()))
+	{
+		return;
+	}
+
+	// The bank is immutable, any thread may switch without locking it. The
+	// values the audio thread reads take effect here, setValue() alone would
+	// leave the APVTS raw values and the mode to the message thread.
+	// Listeners and host hear of the switch from there.
+	const auto& preset = m_presetBank->getPreset(index);
+
+	for (int i = 0; i < PresetBank::N_PARAMETERS; ++i)
+	{
+		auto* parameter = m_presetParameters[i];
+		parameter->setValue(parameter->convertTo0to1(preset.values[i]));
+		m_presetRawValues[i]->store(parameter->convertFrom0to1(parameter->getValue()));
+	}
+
+	m_distortionMode.store(getDistortionMode());
+	m_currentProgram.store(index);
+	m_programChanged.store(true);
+	triggerAsyncUpdate();
 }
 
 const juce::String BassEnhancerAudioProcessor::getProgramName (int index)
 {
-    return {};
+	return juce::isPositiveAndBelow(index, m_presetBank->size()) ? m_presetBank->getPreset(index).name : juce::String();
 }
 
 void BassEnhancerAudioProcessor::changeProgramName (int index, const juce::String& newName)
 {
+	// Factory presets are shared between instances and keep their names
 }
 
 //==============================================================================
+template <>
+BassEnhancerAudioProcessor::PrecisionState<float>& BassEnhancerAudioProcessor::getState<float>()
+{
+	return m_floatState;
+}
+
+template <>
+BassEnhancerAudioProcessor::PrecisionState<double>& BassEnhancerAudioProcessor::getState<double>()
+{
+	return m_doubleState;
+}
+
+template <typename SampleType>
+void BassEnhancerAudioProcessor::prepareState(PrecisionState<SampleType>& state, int channels, int maxOversampledBlockSize)
+{
+	const int lanes = (int)SIMDVector<SampleType>::SIMDNumElements;
+	const int numGroups = (channels + lanes - 1) / lanes;
+
+	state.filters.resize((size_t)numGroups);
+	state.timeFilters.resize(channels <= 2 ? 1 : 0);
+
+	for (auto& filters : state.filters)
+		filters.ladder.setResonance(LADDER_FILTER_RESONANCE);
+
+	for (auto& filters : state.timeFilters)
+		filters.ladder.setResonance(LADDER_FILTER_RESONANCE);
+
+	for (int i = 1; i < N_OVERSAMPLING_FACTORS; ++i)
+	{
+		state.oversampling[i] = std::make_unique<juce::dsp::Oversampling<SampleType>>((size_t)channels, (size_t)i, juce::dsp::Oversampling<SampleType>::filterHalfBandPolyphaseIIR, true, true);
+		state.oversampling[i]->initProcessing((size_t)m_maxBlockSize);
+	}
+
+	// Unused lanes stay silent
+	state.interleaved.assign((size_t)(maxOversampledBlockSize * numGroups), SIMDVector<SampleType>::expand(0));
+	state.dryInterleaved.assign(state.interleaved.size(), SIMDVector<SampleType>::expand(0));
+	state.bandBuffer.setSize(channels, maxOversampledBlockSize);
+	state.dryBuffer.setSize(channels, maxOversampledBlockSize);
+	state.primeBuffer.setSize(channels, m_maxBlockSize);
+}
+
 void BassEnhancerAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {	
-	m_lowPassFilter[0].init((int)(sampleRate));
-	m_lowPassFilter[1].init((int)(sampleRate));
+	m_sampleRate = sampleRate;
+	m_maxBlockSize = juce::jmax(1, samplesPerBlock);
 
-	m_ladderFilter[0].init((int)(sampleRate));
-	m_ladderFilter[1].init((int)(sampleRate));
+	// Allocate every factor up front, switching between them must not allocate
+	const int channels = juce::jmax(1, getTotalNumOutputChannels());
+	const int maxOversampledBlockSize = m_maxBlockSize << (N_OVERSAMPLING_FACTORS - 1);
 
-	m_ladderFilter[0].setResonance(2.0f);
-	m_ladderFilter[1].setResonance(2.0f);
+	// Hosts pick the precision before prepareToPlay. Float hosts get both
+	// states, so DoublePrecision can switch without allocating.
+	if (isUsingDoublePrecision())
+	{
+		prepareState(m_doubleState, channels, maxOversampledBlockSize);
+		m_floatState = {};
+		m_doubleBuffer.setSize(0, 0);
+		m_doubleBufferChannels = 0;
+	}
+	else
+	{
+		prepareState(m_floatState, channels, maxOversampledBlockSize);
+		prepareState(m_doubleState, channels, maxOversampledBlockSize);
+		m_doubleBuffer.setSize(channels, m_maxBlockSize);
+		m_doubleBufferChannels = channels;
+	}
+
+	m_doublePrecision = isUsingDoublePrecision() || doublePrecisionParameter->get();
+	m_midSide = midSideParameter->get();
+
+	// Kernels are picked again for the new state and instruction set
+	m_instructionSet.store(CpuDispatch::choose(m_instructionSetOverride.load()));
+	m_kernelMode = -1;
+
+	// Coefficients for the whole Frequency range at every oversampled rate
+	const auto& frequencyRange = apvts.getParameter(paramsNames[0])->getNormalisableRange();
+
+	for (int i = 0; i < N_OVERSAMPLING_FACTORS; ++i)
+		m_coefficientTables[i].build(frequencyRange.start, frequencyRange.end, 1.0, sampleRate * (1 << i), LADDER_FILTER_FREQUENCY_FACTOR, LADDER_FILTER_RESONANCE, ALL_PASS_Q);
+
+	// The design thread must not touch the band split while it reallocates
+	m_designThread->removeTimeSliceClient(&m_bandSplit);
+	m_bandSplit.prepare(channels, sampleRate, m_maxBlockSize, N_OVERSAMPLING_FACTORS - 1, ALL_PASS_Q);
+	m_linearPhase = linearPhaseParameter->get();
+	m_bandSplit.setEnabled(m_linearPhase);
+
+	m_oversamplingIndex = -1;
+	updateOversampling();
+
+	// The host asks for the latency right after prepareToPlay
+	cancelPendingUpdate();
+	setLatencySamples(m_latencySamples.load());
+
+	// Room for the largest latency of any setting, the priming history and a block
+	int maxLatency = 0;
+
+	for (int i = 0; i < N_OVERSAMPLING_FACTORS; ++i)
+		maxLatency = juce::jmax(maxLatency, computeLatency(i, true));
+
+	const int primeSamples = juce::roundToInt(BYPASS_PRIME_SECONDS * sampleRate);
+	m_bypassDelay.setSize(channels, juce::nextPowerOfTwo(maxLatency + primeSamples + m_maxBlockSize + 1));
+	m_bypassDelay.clear();
+	m_bypassDry.setSize(channels, m_maxBlockSize);
+	m_bypassGains.assign((size_t)m_maxBlockSize, 0.0f);
+	m_bypassPosition = 0;
+
+	m_bypass = bypassParameter->get();
+	m_suspended = m_bypass;
+	m_priming = false;
+	m_primeLag = 0;
+	m_bypassFade.reset(sampleRate, BYPASS_FADE_SECONDS);
+	m_bypassFade.setCurrentAndTargetValue(m_bypass ? 1.0f : 0.0f);
 
-	m_secondOrderAllPass[0].init((int)(sampleRate));
-	m_secondOrderAllPass[1].init((int)(sampleRate));
+	if (m_linearPhase)
+	{
+		m_bandSplit.setTarget(getDistortionMode() == DISTORTION_MODE_A ? LinearPhaseBandSplit::SHAPE_LOW_PASS : LinearPhaseBandSplit::SHAPE_BAND, getTargetFrequency());
+		m_bandSplit.designNow();
+	}
+
+	m_designThread->addTimeSliceClient(&m_bandSplit);
+
+	// Tracks within the Frequency range, at the host rate
+	m_trackerThread->removeTimeSliceClient(&m_tracker);
+	m_tracker.prepare(sampleRate, frequencyRange.start, frequencyRange.end);
+	m_tracker.setEnabled(trackingParameter->get());
+	m_trackerThread->addTimeSliceClient(&m_tracker);
+
+	m_silentSamples = 0;
+	m_isSilent = false;
+	m_harmonicsDirty = true;
+
+	m_analyzer.prepare(sampleRate);
+	m_meter.prepare(sampleRate, channels, m_maxBlockSize);
+
+	reset();
 }
 
 void BassEnhancerAudioProcessor::releaseResources()
 {
-	
+	m_designThread->removeTimeSliceClient(&m_bandSplit);
+	m_trackerThread->removeTimeSliceClient(&m_tracker);
+
+	forEachState([] (auto& state)
+	{
+		for (auto& oversampling : state.oversampling)
+			oversampling.reset();
+	});
+}
+
+void BassEnhancerAudioProcessor::reset()
+{
+	// Clear filter states, keep sample rate and coefficients
+	forEachState([] (auto& state)
+	{
+		for (auto& filters : state.filters)
+			filters.reset();
+
+		for (auto& filters : state.timeFilters)
+			filters.reset();
+
+		for (auto& oversampling : state.oversampling)
+			if (oversampling != nullptr)
+				oversampling->reset();
+	});
+
+	m_bandSplit.reset();
+}
+
+void BassEnhancerAudioProcessor::updateOversampling()
+{
+	const int index = isNonRealtime() ? offlineOversamplingParameter->getIndex() : oversamplingParameter->getIndex();
+
+	if (index == m_oversamplingIndex)
+	{
+		return;
+	}
+
+	m_oversamplingIndex = index;
+
+	// Filters run at the oversampled rate
+	const int sampleRate = (int)(m_sampleRate * (1 << index));
+
+	forEachState([&] (auto& state)
+	{
+		for (auto& filters : state.filters)
+			filters.init(sampleRate);
+
+		for (auto& filters : state.timeFilters)
+			filters.init(sampleRate);
+
+		if (state.oversampling[index] != nullptr)
+		{
+			state.oversampling[index]->reset();
+		}
+	});
+
+	m_bandSplit.setIndex(index);
+
+	// Smoothers tick at the oversampled rate, jump straight to the current values
+	m_frequencySmoothed.reset(sampleRate, SMOOTHING_TIME_SECONDS);
+	m_gainSmoothed.reset(sampleRate, SMOOTHING_TIME_SECONDS);
+	m_mixSmoothed.reset(sampleRate, SMOOTHING_TIME_SECONDS);
+	m_volumeSmoothed.reset(sampleRate, SMOOTHING_TIME_SECONDS);
+
+	setSmoothersToParameters();
+	updateLatency();
+
+	m_tailSeconds.store(computeTailSeconds(m_coefficientTables[index].lookup(getTargetFrequency()).decay));
+}
+
+void BassEnhancerAudioProcessor::setSmoothersToParameters()
+{
+	m_frequencySmoothed.setCurrentAndTargetValue(getTargetFrequency());
+	m_gainSmoothed.setCurrentAndTargetValue(juce::Decibels::decibelsToGain(gainParameter->load() * 24.0f));
+	m_mixSmoothed.setCurrentAndTargetValue(mixParameter->load());
+	m_volumeSmoothed.setCurrentAndTargetValue(juce::Decibels::decibelsToGain(volumeParameter->load()));
+
+	m_coefficientsDirty = true;
+}
+
+void BassEnhancerAudioProcessor::updateLatency()
+{
+	m_latencySamples.store(computeLatency(m_oversamplingIndex, m_linearPhase));
+	triggerAsyncUpdate();
+}
+
+int BassEnhancerAudioProcessor::computeLatency(int index, bool linearPhase)
+{
+	// Float and double oversampling use the same filters, whichever is prepared reports it
+	double latency = 0.0;
+
+	forEachState([&] (auto& state)
+	{
+		if (state.oversampling[index] != nullptr)
+			latency = (double)state.oversampling[index]->getLatencyInSamples();
+	});
+
+	// The band split runs at the oversampled rate, its latency divides evenly down to the host rate
+	if (linearPhase)
+	{
+		latency += (double)m_bandSplit.getLatencySamples(index) / (1 << index);
+	}
+
+	return juce::roundToInt(latency);
+}
+
+double BassEnhancerAudioProcessor::computeTailSeconds(double decay) const
+{
+	// Time for the slowest pole to decay below SILENCE_THRESHOLD, plus the oversampling delay
+	const double sampleRate = m_sampleRate * (1 << m_oversamplingIndex);
+	double seconds = MAX_TAIL_SECONDS;
+
+	if (decay < 1.0)
+	{
+		seconds = juce::jmin(MAX_TAIL_SECONDS, std::log((double)SILENCE_THRESHOLD) / std::log(decay) / sampleRate);
+	}
+
+	// The linear-phase kernel rings on for its taps after the center
+	if (m_linearPhase)
+	{
+		seconds += m_bandSplit.getTailSamples(m_oversamplingIndex) / sampleRate;
+	}
+
+	return seconds + m_latencySamples.load() / m_sampleRate;
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -170,12 +491,9 @@ bool BassEnhancerAudioProcessor::isBusesLayoutSupported (const BusesLayout& layo
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Any layout works, channels are processed in groups of SIMD lanes
+    // (mono, stereo, 5.1, 7.1.4, ambisonics, discrete...)
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -189,128 +507,702 @@ bool BassEnhancerAudioProcessor::isBusesLayoutSupported (const BusesLayout& layo
 }
 #endif
 
+template <typename SampleType>
+static SampleType getPeak(const juce::AudioBuffer<SampleType>& buffer, int channels, int startSample, int samples)
+{
+	SampleType peak = 0;
+
+	for (int channel = 0; channel < channels; ++channel)
+		peak = juce::jmax(peak, buffer.getMagnitude(channel, startSample, samples));
+
+	return peak;
+}
+
 void BassEnhancerAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
-	// Get params
-	const auto frequency = frequencyParameter->load();
-	const auto gainNormalized = gainParameter->load();
-	const auto mix = mixParameter->load();
-	const auto volume = juce::Decibels::decibelsToGain(volumeParameter->load());
+	updateRestartSettings();
 
-	// Buttons
-	const auto buttonA = buttonAParameter->get();
-	const auto buttonB = buttonBParameter->get();
-	const auto buttonC = buttonCParameter->get();
-	const auto buttonD = buttonDParameter->get();
+	if (m_doublePrecision)
+	{
+		processInDoublePrecision(buffer);
+	}
+	else
+	{
+		processBuffer(buffer);
+	}
+}
 
-	// Mics constants
-	const float gain = juce::Decibels::decibelsToGain(gainNormalized * 24.0f);
-	const float mixInverse = 1.0f - mix;
-	const int channels = getTotalNumOutputChannels();
-	const int samples = buffer.getNumSamples();		
+void BassEnhancerAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+	updateRestartSettings();
+	processBuffer(buffer);
+}
 
-	for (int channel = 0; channel < channels; ++channel)
+// Mid and side do not share filter memory with left and right, nor do the
+// float and double states. Such a change fades out like bypass in
+// processBuffer() and is taken on once the DSP is suspended, before a state
+// is picked, so the priming already runs in the new settings.
+bool BassEnhancerAudioProcessor::isRestartPending() const
+{
+	const bool precisionChanged = !isUsingDoublePrecision() && doublePrecisionParameter->get() != m_doublePrecision;
+	return midSideParameter->get() != m_midSide || precisionChanged;
+}
+
+void BassEnhancerAudioProcessor::updateRestartSettings()
+{
+	if (!m_suspended || !isRestartPending())
 	{
-		// Channel pointer
-		auto* channelBuffer = buffer.getWritePointer(channel);
+		return;
+	}
 
-		// Filters
-		auto& lowPassFilter = m_lowPassFilter[channel];
-		auto& ladderFilter = m_ladderFilter[channel];
-		auto& secondOrderAllPass = m_secondOrderAllPass[channel];
+	m_midSide = midSideParameter->get();
 
-		// Set filter frequency
-		lowPassFilter.setCoef(frequency);
-	
-		// Arbitrary factor to make LP resonance peak at input frequency
-		const float LADDER_FILTER_FREQUENCY_FACTOR = 1.23f;
-		ladderFilter.setCoef(frequency * LADDER_FILTER_FREQUENCY_FACTOR);
-		
-		secondOrderAllPass.setCoef(frequency, 7.0f);
+	if (!isUsingDoublePrecision())
+		m_doublePrecision = doublePrecisionParameter->get();
 
-		if (buttonA)
-		{
-			for (int sample = 0; sample < samples; ++sample)
-			{
-				// Get input
-				const float in = channelBuffer[sample];
+	if (m_priming)
+		beginPriming();
+}
+
+void BassEnhancerAudioProcessor::processBlockBypassed (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+	m_hostBypass = true;
+	processBlock(buffer, midiMessages);
+	m_hostBypass = false;
+}
 
-				// Prefilter
-				const float inPreFilter = lowPassFilter.process(in) * gain;
+void BassEnhancerAudioProcessor::processBlockBypassed (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+	m_hostBypass = true;
+	processBlock(buffer, midiMessages);
+	m_hostBypass = false;
+}
 
-				// Distort
-				const float inDistort = fmaxf(-1.0f, fminf(1.0f, inPreFilter / (1.0f + fabsf(inPreFilter))));
+void BassEnhancerAudioProcessor::processInDoublePrecision(juce::AudioBuffer<float>& buffer)
+{
+	const int channels = juce::jmin(buffer.getNumChannels(), m_doubleBufferChannels);
+	const int samples = buffer.getNumSamples();
 
-				// Post filter
-				const float inPostFilter = ladderFilter.process(inDistort);
+	// Some hosts send more samples than announced in prepareToPlay
+	for (int start = 0; start < samples; start += m_maxBlockSize)
+	{
+		const int blockSamples = juce::jmin(m_maxBlockSize, samples - start);
+		m_doubleBuffer.setSize(channels, blockSamples, false, false, true);
 
-				// Apply volume, mix and send to output
-				channelBuffer[sample] = volume * (mix * inPostFilter + mixInverse * in);
-			}
+		for (int channel = 0; channel < channels; ++channel)
+		{
+			const float* source = buffer.getReadPointer(channel, start);
+			double* destination = m_doubleBuffer.getWritePointer(channel);
+
+			for (int sample = 0; sample < blockSamples; ++sample)
+				destination[sample] = source[sample];
 		}
-		else if (buttonB)
+
+		processBuffer(m_doubleBuffer);
+
+		for (int channel = 0; channel < channels; ++channel)
 		{
-			for (int sample = 0; sample < samples; ++sample)
-			{
-				// Get input
-				const float in = channelBuffer[sample];
+			const double* source = m_doubleBuffer.getReadPointer(channel);
+			float* destination = buffer.getWritePointer(channel, start);
+
+			for (int sample = 0; sample < blockSamples; ++sample)
+				destination[sample] = (float)source[sample];
+		}
+	}
+}
+
+template <typename SampleType>
+void BassEnhancerAudioProcessor::processBuffer(juce::AudioBuffer<SampleType>& buffer)
+{
+	// Flush denormals to zero in the feedback paths
+	juce::ScopedNoDenormals noDenormals;
+
+	const int channels = juce::jmin(getTotalNumOutputChannels(), buffer.getNumChannels());
+	const bool analyzing = m_analyzer.isActive();
 
-				// Prefilter
-				const float inPreFilter = 0.5f * (in - secondOrderAllPass.process(in)) * gain;
+	if (analyzing)
+		m_analyzer.pushInput(buffer, channels);
 
-				// Distort
-				const float inDistort = fmaxf(-1.0f, fminf(1.0f, inPreFilter / (1.0f + fabsf(inPreFilter))));
+	// Routing and precision changes fade out first, see isRestartPending()
+	const bool bypass = m_hostBypass || bypassParameter->get() || isRestartPending();
+
+	if (bypass != m_bypass)
+	{
+		m_bypass = bypass;
+		m_priming = !bypass && m_suspended;
+
+		// Bypass again while priming leaves it suspended
+		if (m_priming)
+			beginPriming();
+		else
+			m_bypassFade.setTargetValue(bypass ? 1.0f : 0.0f);
+	}
 
-				// Post filter
-				const float inPostFilter = ladderFilter.process(inDistort);
+	const int samples = buffer.getNumSamples();
+
+	if (m_suspended)
+	{
+		// Only the latency is kept
+		for (int channel = 0; channel < channels; ++channel)
+			delayBypass(buffer.getReadPointer(channel), buffer.getWritePointer(channel), channel, samples);
+
+		advanceBypass(samples);
+
+		if (m_priming)
+			primeFromBypass<SampleType>(samples);
+	}
+	else if (m_bypassFade.isSmoothing())
+	{
+		processCrossfade(buffer, channels);
+	}
+	else
+	{
+		// The delay keeps the input history for the next crossfade
+		for (int channel = 0; channel < channels; ++channel)
+			delayBypass(buffer.getReadPointer(channel), (SampleType*)nullptr, channel, samples);
+
+		advanceBypass(samples);
+		processUnbypassed(buffer, 0, samples);
+	}
+
+	if (analyzing)
+		m_analyzer.pushOutput(buffer, channels);
+
+	if (m_meter.isActive())
+		m_meter.process(buffer, channels);
+}
 
-				// Apply volume, mix and send to output
-				channelBuffer[sample] = volume * (mix * inPostFilter + mixInverse * in);
-			}
+template <typename SampleType>
+void BassEnhancerAudioProcessor::processUnbypassed(juce::AudioBuffer<SampleType>& buffer, int startSample, int samples)
+{
+	if (m_telemetry.isEnabled())
+	{
+		processInstrumented(buffer, startSample, samples);
+	}
+	else
+	{
+		processEnhancer(buffer, startSample, samples);
+	}
+}
+
+// Processed and delayed dry are faded per sample, in blocks the dry buffer can hold
+template <typename SampleType>
+void BassEnhancerAudioProcessor::processCrossfade(juce::AudioBuffer<SampleType>& buffer, int channels)
+{
+	const int samples = buffer.getNumSamples();
+
+	for (int start = 0; start < samples; start += m_maxBlockSize)
+	{
+		const int blockSamples = juce::jmin(m_maxBlockSize, samples - start);
+
+		for (int channel = 0; channel < channels; ++channel)
+			delayBypass(buffer.getReadPointer(channel, start), m_bypassDry.getWritePointer(channel), channel, blockSamples);
+
+		advanceBypass(blockSamples);
+
+		processUnbypassed(buffer, start, blockSamples);
+
+		for (int sample = 0; sample < blockSamples; ++sample)
+			m_bypassGains[(size_t)sample] = m_bypassFade.getNextValue();
+
+		for (int channel = 0; channel < channels; ++channel)
+		{
+			SampleType* processed = buffer.getWritePointer(channel, start);
+			const double* dry = m_bypassDry.getReadPointer(channel);
+
+			for (int sample = 0; sample < blockSamples; ++sample)
+				processed[sample] += (SampleType)m_bypassGains[(size_t)sample] * ((SampleType)dry[sample] - processed[sample]);
 		}
-		else if (buttonC)
+	}
+
+	// Faded out completely, the DSP stops until bypass ends
+	if (m_bypass && !m_bypassFade.isSmoothing())
+	{
+		m_suspended = true;
+	}
+}
+
+// Writes the input into the bypass delay and, unless out is null, reads it back
+// delayed by the latency. in and out may be the same buffer.
+template <typename SampleType, typename OutputType>
+void BassEnhancerAudioProcessor::delayBypass(const SampleType* in, OutputType* out, int channel, int samples)
+{
+	double* delay = m_bypassDelay.getWritePointer(channel);
+	const int mask = m_bypassDelay.getNumSamples() - 1;
+	const int latency = m_latencySamples.load();
+
+	for (int sample = 0; sample < samples; ++sample)
+	{
+		const int position = m_bypassPosition + sample;
+		delay[position & mask] = (double)in[sample];
+
+		if (out != nullptr)
+			out[sample] = (OutputType)delay[(position - latency) & mask];
+	}
+}
+
+void BassEnhancerAudioProcessor::advanceBypass(int samples)
+{
+	m_bypassPosition = (m_bypassPosition + samples) & (m_bypassDelay.getNumSamples() - 1);
+}
+
+// Filters, oversampling and band split start from silence, then run over the
+// recent input, so the first processed block continues that input without a burst.
+// The history covers the latency and the tail, at most BYPASS_PRIME_SECONDS.
+void BassEnhancerAudioProcessor::beginPriming()
+{
+	reset();
+	setSmoothersToParameters();
+	m_silentSamples = 0;
+	m_isSilent = false;
+
+	const int tailSamples = juce::roundToInt(m_tailSeconds.load() * m_sampleRate);
+	m_primeLag = juce::jmin(m_latencySamples.load() + tailSamples, juce::roundToInt(BYPASS_PRIME_SECONDS * m_sampleRate));
+}
+
+// Runs the DSP over at most one block more than the host just sent, so the
+// history is worked off over a few callbacks. Caught up, the fade starts.
+template <typename SampleType>
+void BassEnhancerAudioProcessor::primeFromBypass(int newSamples)
+{
+	auto& prime = getState<SampleType>().primeBuffer;
+	const int channels = juce::jmin(prime.getNumChannels(), m_bypassDelay.getNumChannels());
+	const int mask = m_bypassDelay.getNumSamples() - 1;
+
+	m_primeLag = juce::jmin(m_primeLag + newSamples, mask);
+	int remaining = juce::jmin(m_primeLag, newSamples + m_maxBlockSize);
+
+	while (remaining > 0)
+	{
+		const int samples = juce::jmin(remaining, prime.getNumSamples());
+
+		for (int channel = 0; channel < channels; ++channel)
 		{
+			const double* delay = m_bypassDelay.getReadPointer(channel);
+			SampleType* destination = prime.getWritePointer(channel);
+
 			for (int sample = 0; sample < samples; ++sample)
-			{
-				// Get input
-				const float in = channelBuffer[sample];
+				destination[sample] = (SampleType)delay[(m_bypassPosition - m_primeLag + sample) & mask];
+		}
+
+		processEnhancer(prime, 0, samples);
+		m_primeLag -= samples;
+		remaining -= samples;
+	}
+
+	if (m_primeLag == 0)
+	{
+		m_priming = false;
+		m_suspended = false;
+		m_bypassFade.setTargetValue(0.0f);
+	}
+}
+
+template <typename SampleType>
+void BassEnhancerAudioProcessor::processInstrumented(juce::AudioBuffer<SampleType>& buffer, int startSample, int samples)
+{
+	const juce::uint64 startCycles = PerformanceTelemetry::readCycleCounter();
+	const juce::int64 startTicks = juce::Time::getHighResolutionTicks();
+
+	m_coefficientUpdates = 0;
+	const bool processed = processEnhancer(buffer, startSample, samples);
+
+	BlockRecord record;
+	record.cycles = PerformanceTelemetry::readCycleCounter() - startCycles;
+	record.ticks = juce::Time::getHighResolutionTicks() - startTicks;
+	record.sampleRate = m_sampleRate;
+	record.blockSize = samples;
+	record.mode = m_kernelMode;
+	record.oversamplingIndex = m_oversamplingIndex;
+	record.instructionSet = m_instructionSet.load();
+	record.coefficientUpdates = m_coefficientUpdates;
+	record.skipped = !processed;
+
+	m_telemetry.push(record);
+}
+
+// Returns false when the block was skipped as silent
+template <typename SampleType>
+bool BassEnhancerAudioProcessor::processEnhancer(juce::AudioBuffer<SampleType>& buffer, int startSample, int samples)
+{
+	m_tracker.setEnabled(trackingParameter->get());
+	m_tracker.setSynchronous(isNonRealtime());
 
-				// Prefilter
-				const float inPreFilter = 0.5f * (in - secondOrderAllPass.process(in)) * gain;
+	if (!m_tracker.isEnabled() || !m_tracker.isSynchronous())
+	{
+		return processSegment(buffer, startSample, samples);
+	}
+
+	// Offline the tracker analyses inline and the block is split where its hops end,
+	// so the Frequency it steers moves on the same samples whatever the block size
+	bool processed = false;
+
+	for (int segmentStart = 0; segmentStart < samples;)
+	{
+		const int segment = juce::jmin(samples - segmentStart, m_tracker.getSamplesToHop());
+		processed = processSegment(buffer, startSample + segmentStart, segment) || processed;
+		segmentStart += segment;
+	}
+
+	return processed;
+}
+
+template <typename SampleType>
+bool BassEnhancerAudioProcessor::processSegment(juce::AudioBuffer<SampleType>& buffer, int startSample, int samples)
+{
+	auto& state = getState<SampleType>();
+
+	updateOversampling();
+
+	// Switching to the linear-phase band split changes the latency
+	const bool linearPhase = linearPhaseParameter->get();
+
+	if (linearPhase != m_linearPhase)
+	{
+		m_linearPhase = linearPhase;
+		m_bandSplit.setEnabled(linearPhase);
+		m_bandSplit.reset();
+		updateLatency();
+		m_tailSeconds.store(computeTailSeconds(m_coefficientTables[m_oversamplingIndex].lookup(m_frequencySmoothed.getCurrentValue()).decay));
+	}
+
+	// Mode, antialiasing and crossover changes swap the kernel instantiation
+	const int distortionMode = m_distortionMode.load();
+	const int antialiasing = antialiasingParameter->getIndex();
+
+	if (distortionMode != m_kernelMode || antialiasing != m_kernelAntialiasing || m_linearPhase != m_kernelLinearPhase)
+	{
+		m_kernelMode = distortionMode;
+		m_kernelAntialiasing = antialiasing;
+		m_kernelLinearPhase = m_linearPhase;
+		m_floatState.kernel = getEnhancerKernel<float>(distortionMode, antialiasing, m_linearPhase, m_instructionSet.load());
+		m_doubleState.kernel = getEnhancerKernel<double>(distortionMode, antialiasing, m_linearPhase, m_instructionSet.load());
+		m_floatState.timeKernel = getEnhancerTimeKernel<float>(distortionMode, antialiasing, m_linearPhase, m_instructionSet.load());
+		m_doubleState.timeKernel = getEnhancerTimeKernel<double>(distortionMode, antialiasing, m_linearPhase, m_instructionSet.load());
+	}
+
+	// The design thread picks the latest target up whenever it is free. Offline
+	// it is designed right here, so the render does not depend on its speed.
+	if (m_linearPhase)
+	{
+		m_bandSplit.setTarget(distortionMode == DISTORTION_MODE_A ? LinearPhaseBandSplit::SHAPE_LOW_PASS : LinearPhaseBandSplit::SHAPE_BAND, m_frequencySmoothed.getCurrentValue());
+	}
+
+	m_bandSplit.setSynchronous(isNonRealtime());
 
-				// Distort
-				const float inDistort = (fabsf(inPreFilter) > 0.25f) ? ((inPreFilter >= 0.0f) ? 1.0f : -1.0f) : 0.0f;
+	if (isNonRealtime())
+	{
+		m_bandSplit.designNow();
+	}
+
+	updateHarmonics();
+
+	// Get params
+	m_frequencySmoothed.setTargetValue(getTargetFrequency());
+	m_gainSmoothed.setTargetValue(juce::Decibels::decibelsToGain(gainParameter->load() * 24.0f));
+	m_mixSmoothed.setTargetValue(mixParameter->load());
+	m_volumeSmoothed.setTargetValue(juce::Decibels::decibelsToGain(volumeParameter->load()));
 
-				// Post filter
-				const float inPostFilter = ladderFilter.process(inDistort);
+	// The tracker analyses the input on its own thread, offline the hop this segment
+	// completes is analysed here and steers the next one
+	const int channels = juce::jmin(getTotalNumOutputChannels(), buffer.getNumChannels(), (int)state.filters.size() * (int)SIMDVector<SampleType>::SIMDNumElements);
 
-				// Apply volume, mix and send to output
-				channelBuffer[sample] = volume * (mix * inPostFilter + mixInverse * in);
-			}
+	if (m_tracker.isEnabled())
+		m_tracker.push(buffer, channels, startSample, samples);
+
+	// Mics constants
+	auto* oversampling = state.oversampling[m_oversamplingIndex].get();
+
+	// Once input and tail are silent, skip processing until input returns
+	const bool inputSilent = m_skipSilence.load() && getPeak(buffer, channels, startSample, samples) < SILENCE_THRESHOLD;
+
+	if (!inputSilent)
+	{
+		m_silentSamples = 0;
+		m_isSilent = false;
+	}
+	else
+	{
+		m_silentSamples += samples;
+
+		if (m_isSilent)
+		{
+			for (int channel = 0; channel < channels; ++channel)
+				buffer.clear(channel, startSample, samples);
+
+			// Nothing is ringing, parameters can jump to their targets
+			m_frequencySmoothed.setCurrentAndTargetValue(m_frequencySmoothed.getTargetValue());
+			m_gainSmoothed.setCurrentAndTargetValue(m_gainSmoothed.getTargetValue());
+			m_mixSmoothed.setCurrentAndTargetValue(m_mixSmoothed.getTargetValue());
+			m_volumeSmoothed.setCurrentAndTargetValue(m_volumeSmoothed.getTargetValue());
+			m_coefficientsDirty = true;
+			return false;
+		}
+	}
+
+	juce::dsp::AudioBlock<SampleType> block(buffer.getArrayOfWritePointers(), (size_t)channels, (size_t)startSample, (size_t)samples);
+
+	// Some hosts send more samples than announced in prepareToPlay
+	for (int subBlockStart = 0; subBlockStart < samples; subBlockStart += m_maxBlockSize)
+	{
+		auto subBlock = block.getSubBlock((size_t)subBlockStart, (size_t)juce::jmin(m_maxBlockSize, samples - subBlockStart));
+
+		if (oversampling != nullptr)
+		{
+			auto oversampledBlock = oversampling->processSamplesUp(subBlock);
+			processSubBlock(oversampledBlock);
+			oversampling->processSamplesDown(subBlock);
 		}
 		else
 		{
-			for (int sample = 0; sample < samples; ++sample)
-			{
-				// Get input
-				const float in = channelBuffer[sample];
+			processSubBlock(subBlock);
+		}
+	}
 
-				// Prefilter
-				const float inPreFilter = 0.5f * (in - secondOrderAllPass.process(in)) * gain;
+	// The tail has rung out, clear the states to exact zeros and stop processing
+	if (inputSilent && m_silentSamples >= (juce::int64)(m_tailSeconds.load() * m_sampleRate) && getPeak(buffer, channels, startSample, samples) < SILENCE_THRESHOLD)
+	{
+		m_isSilent = true;
+		reset();
+	}
 
-				// Distort
-				const float inDistort = ((inPreFilter >= 0.0f) ? 1.0f : -1.0f) * powf(fminf(fabsf(inPreFilter), 1.0f), 2.0f);
+	return true;
+}
+
+template <typename SampleType>
+static void interleaveChannel(const SampleType* source, int channel, int lanes, int samples, SIMDVector<SampleType>* destination)
+{
+	SampleType* interleaved = reinterpret_cast<SampleType*>(destination);
 
-				// Post filter
-				const float inPostFilter = ladderFilter.process(inDistort);
+	for (int sample = 0; sample < samples; ++sample)
+		interleaved[sample * lanes + channel] = source[sample];
+}
 
-				// Apply volume, mix and send to output
-				channelBuffer[sample] = volume * (mix * inPostFilter + mixInverse * in);
-			}
+template <typename SampleType>
+void BassEnhancerAudioProcessor::processSubBlock(juce::dsp::AudioBlock<SampleType>& block)
+{
+	auto& state = getState<SampleType>();
+	const int lanes = (int)(state.filters.size() * SIMDVector<SampleType>::SIMDNumElements);
+	const int channels = (int)block.getNumChannels();
+	const int samples = (int)block.getNumSamples();
+	const SampleType* interleaved = reinterpret_cast<const SampleType*>(state.interleaved.data());
+
+	// A single channel would leave all but one lane idle
+	if (channels == 1 && !state.timeFilters.empty())
+	{
+		processTimeVectorized(block.getChannelPointer(0), (SampleType*)nullptr, samples);
+		return;
+	}
+
+	if (channels == 2 && m_midSide && !state.timeFilters.empty())
+	{
+		processMidSide(block);
+		return;
+	}
+
+	if (m_linearPhase)
+	{
+		// Split the band off ahead of the kernel, the dry input is delayed to match
+		m_bandSplit.beginBlock();
+
+		for (int channel = 0; channel < channels; ++channel)
+			m_bandSplit.processChannel(channel, block.getChannelPointer((size_t)channel), state.bandBuffer.getWritePointer(channel), state.dryBuffer.getWritePointer(channel), samples);
+
+		m_bandSplit.endBlock(samples);
+
+		for (int channel = 0; channel < channels; ++channel)
+		{
+			interleaveChannel(state.bandBuffer.getReadPointer(channel), channel, lanes, samples, state.interleaved.data());
+			interleaveChannel(state.dryBuffer.getReadPointer(channel), channel, lanes, samples, state.dryInterleaved.data());
 		}
+
+		processLanes(state.interleaved.data(), state.dryInterleaved.data(), samples);
+	}
+	else
+	{
+		// Interleave channels into SIMD lanes
+		for (int channel = 0; channel < channels; ++channel)
+			interleaveChannel(block.getChannelPointer((size_t)channel), channel, lanes, samples, state.interleaved.data());
+
+		processLanes(state.interleaved.data(), state.interleaved.data(), samples);
+	}
+
+	// Deinterleave back to channels
+	for (int channel = 0; channel < channels; ++channel)
+	{
+		auto* channelBuffer = block.getChannelPointer((size_t)channel);
+
+		for (int sample = 0; sample < samples; ++sample)
+			channelBuffer[sample] = interleaved[sample * lanes + channel];
 	}
 }
 
+template <typename SampleType>
+void BassEnhancerAudioProcessor::processLanes(SIMDVector<SampleType>* lanes, const SIMDVector<SampleType>* dryLanes, int samples)
+{
+	using SIMDType = SIMDVector<SampleType>;
+	auto& state = getState<SampleType>();
+
+	for (int subBlockStart = 0; subBlockStart < samples; subBlockStart += SMOOTHING_SUB_BLOCK)
+	{
+		const int subBlockSamples = juce::jmin(SMOOTHING_SUB_BLOCK, samples - subBlockStart);
+
+		updateCoefficients(subBlockSamples);
+
+		// Smoothed per sample gains
+		for (int sample = 0; sample < subBlockSamples; ++sample)
+		{
+			SampleType gain, wet, dry;
+			getNextGains(gain, wet, dry);
+
+			state.gains.gain[sample] = SIMDType::expand(gain);
+			state.gains.wet[sample] = SIMDType::expand(wet);
+			state.gains.dry[sample] = SIMDType::expand(dry);
+		}
+
+		const int numGroups = (int)state.filters.size();
+		state.kernel(state.filters.data(), numGroups, state.gains, lanes + subBlockStart * numGroups, dryLanes + subBlockStart * numGroups, subBlockSamples);
+	}
+}
+
+template <typename SampleType>
+void BassEnhancerAudioProcessor::processMidSide(juce::dsp::AudioBlock<SampleType>& block)
+{
+	const int samples = (int)block.getNumSamples();
+	SampleType* left = block.getChannelPointer(0);
+	SampleType* right = block.getChannelPointer(1);
+
+	// Encode in place, left holds mid and right side
+	for (int sample = 0; sample < samples; ++sample)
+	{
+		const SampleType mid = (SampleType)0.5 * (left[sample] + right[sample]);
+		const SampleType side = (SampleType)0.5 * (left[sample] - right[sample]);
+
+		left[sample] = mid;
+		right[sample] = side;
+	}
+
+	processTimeVectorized(left, right, samples);
+
+	for (int sample = 0; sample < samples; ++sample)
+	{
+		const SampleType mid = left[sample];
+		const SampleType side = right[sample];
+
+		left[sample] = mid + side;
+		right[sample] = mid - side;
+	}
+}
+
+// With a side channel, side only gets the dry gain, so Mix 0 still returns the input
+template <typename SampleType>
+void BassEnhancerAudioProcessor::processTimeVectorized(SampleType* channel, SampleType* side, int samples)
+{
+	auto& state = getState<SampleType>();
+	const SampleType* in = channel;
+	const SampleType* dry = channel;
+
+	if (m_linearPhase)
+	{
+		m_bandSplit.beginBlock();
+		m_bandSplit.processChannel(0, channel, state.bandBuffer.getWritePointer(0), state.dryBuffer.getWritePointer(0), samples);
+
+		// Side stays in line with the delayed dry mid
+		if (side != nullptr)
+			m_bandSplit.delayChannel(1, side, side, samples);
+
+		m_bandSplit.endBlock(samples);
+
+		in = state.bandBuffer.getReadPointer(0);
+		dry = state.dryBuffer.getReadPointer(0);
+	}
+
+	for (int subBlockStart = 0; subBlockStart < samples; subBlockStart += SMOOTHING_SUB_BLOCK)
+	{
+		const int subBlockSamples = juce::jmin(SMOOTHING_SUB_BLOCK, samples - subBlockStart);
+
+		updateCoefficients(subBlockSamples);
+
+		for (int sample = 0; sample < subBlockSamples; ++sample)
+			getNextGains(state.timeGains.gain[sample], state.timeGains.wet[sample], state.timeGains.dry[sample]);
+
+		state.timeKernel(state.timeFilters.front(), state.timeGains, in + subBlockStart, dry + subBlockStart, channel + subBlockStart, subBlockSamples);
+
+		if (side != nullptr)
+			for (int sample = 0; sample < subBlockSamples; ++sample)
+				side[subBlockStart + sample] *= state.timeGains.dry[sample];
+	}
+}
+
+template <typename SampleType>
+void BassEnhancerAudioProcessor::getNextGains(SampleType& gain, SampleType& wet, SampleType& dry)
+{
+	const SampleType volume = m_volumeSmoothed.getNextValue();
+	const SampleType mix = m_mixSmoothed.getNextValue();
+
+	gain = m_gainSmoothed.getNextValue();
+	wet = volume * mix;
+	dry = volume * (1 - mix);
+}
+
+void BassEnhancerAudioProcessor::updateCoefficients(int samples)
+{
+	// Holding Frequency still costs nothing, automating it costs one coefficient update per sub-block
+	if (!m_frequencySmoothed.isSmoothing() && !m_coefficientsDirty)
+	{
+		return;
+	}
+
+	m_coefficientsDirty = false;
+	m_coefficientUpdates++;
+
+	const float frequency = m_frequencySmoothed.skip(samples);
+	const auto coefficients = m_coefficientTables[m_oversamplingIndex].lookup(frequency);
+
+	// Set filter frequency
+	forEachState([&] (auto& state)
+	{
+		for (auto& filters : state.filters)
+			filters.setCoef(coefficients);
+
+		for (auto& filters : state.timeFilters)
+			filters.setCoef(coefficients);
+	});
+
+	m_tailSeconds.store(computeTailSeconds(coefficients.decay));
+}
+
+void BassEnhancerAudioProcessor::updateHarmonics()
+{
+	// Rebuilding the polynomial only when a weight moves keeps mode E at one Horner evaluation per sample
+	for (int i = 0; i < HarmonicRange::N_HARMONICS; ++i)
+	{
+		const float weight = harmonicParameters[i]->load();
+
+		if (weight != m_harmonicWeights[i])
+		{
+			m_harmonicWeights[i] = weight;
+			m_harmonicsDirty = true;
+		}
+	}
+
+	if (!m_harmonicsDirty)
+	{
+		return;
+	}
+
+	m_harmonicsDirty = false;
+
+	forEachState([this] (auto& state)
+	{
+		for (auto& filters : state.filters)
+			filters.harmonics.setWeights(m_harmonicWeights);
+
+		for (auto& filters : state.timeFilters)
+			filters.harmonics.setWeights(m_harmonicWeights);
+	});
+}
+
 //==============================================================================
 bool BassEnhancerAudioProcessor::hasEditor() const
 {
@@ -324,14 +1216,39 @@ juce::AudioProcessorEditor* BassEnhancerAudioProcessor::createEditor()
 
 //==============================================================================
 void BassEnhancerAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
-{	
-	auto state = apvts.copyState();
-	std::unique_ptr<juce::XmlElement> xml(state.createXml());
-	copyXmlToBinary(*xml, destData);
+{
+	CompactState::write(getParameters(), m_currentProgram.load(), destData);
 }
 
 void BassEnhancerAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+	int program = 0;
+	std::vector<CompactState::Entry> entries;
+
+	if (CompactState::read(data, sizeInBytes, program, entries))
+	{
+		// Parameters missing from the state go back to their defaults, as with XML states
+		for (auto* parameter : getParameters())
+		{
+			auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter);
+
+			if (ranged == nullptr)
+				continue;
+
+			float value = ranged->getDefaultValue();
+
+			for (const auto& entry : entries)
+				if (entry.id == ranged->getParameterID())
+					value = ranged->convertTo0to1(entry.value);
+
+			ranged->setValueNotifyingHost(value);
+		}
+
+		m_currentProgram.store(juce::jlimit(0, m_presetBank->size() - 1, program));
+		return;
+	}
+
+	// Sessions saved before the compact format
 	std::unique_ptr<juce::XmlElement> xmlState(getXmlFromBinary(data, sizeInBytes));
 
 	if (xmlState.get() != nullptr)
@@ -354,6 +1271,22 @@ juce::AudioProcessorValueTreeState::ParameterLayout BassEnhancerAudioProcessor::
 	layout.add(std::make_unique<juce::AudioParameterBool>("ButtonB", "ButtonB", false));
 	layout.add(std::make_unique<juce::AudioParameterBool>("ButtonC", "ButtonC", false));
 	layout.add(std::make_unique<juce::AudioParameterBool>("ButtonD", "ButtonC", false));
+	layout.add(std::make_unique<juce::AudioParameterBool>("ButtonE", "ButtonE", false));
+
+	layout.add(std::make_unique<juce::AudioParameterChoice>("Oversampling", "Oversampling", oversamplingNames, 0));
+	layout.add(std::make_unique<juce::AudioParameterChoice>("OversamplingOffline", "Oversampling Offline", oversamplingNames, 0));
+	layout.add(std::make_unique<juce::AudioParameterChoice>("Antialiasing", "Antialiasing", antialiasingNames, 0));
+	layout.add(std::make_unique<juce::AudioParameterBool>("LinearPhase", "Linear Phase", false));
+	layout.add(std::make_unique<juce::AudioParameterBool>("DoublePrecision", "Double Precision", false));
+	layout.add(std::make_unique<juce::AudioParameterBool>("MidSide", "Mid/Side", false));
+	layout.add(std::make_unique<juce::AudioParameterBool>("Tracking", "Frequency Tracking", false));
+	layout.add(std::make_unique<juce::AudioParameterBool>("Bypass", "Bypass", false));
+
+	for (int harmonic = HarmonicRange::FIRST_HARMONIC; harmonic <= HarmonicRange::LAST_HARMONIC; ++harmonic)
+	{
+		const float defaultWeight = harmonic <= 3 ? 0.5f : 0.0f;
+		layout.add(std::make_unique<juce::AudioParameterFloat>(getHarmonicParameterID(harmonic), "Harmonic " + juce::String(harmonic), NormalisableRange<float>(-1.0f, 1.0f, 0.01f, 1.0f), defaultWeight));
+	}
 
 	return layout;
 }
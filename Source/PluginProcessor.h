@@ -9,46 +9,110 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "FilterCoefficients.h"
+#include "SIMDFilters.h"
+#include "EnhancerKernel.h"
+#include "PerformanceTelemetry.h"
+#include "SpectrumAnalyzer.h"
+#include "LinearPhaseBandSplit.h"
+#include "PresetBank.h"
+#include "FundamentalTracker.h"
+#include "OutputMeter.h"
 
 //==============================================================================
+// Scalar reference filters, templated on the sample type so coefficients and
+// state can be kept in double
+template <typename SampleType>
 class SecondOrderAllPass
 {
 public:
 	SecondOrderAllPass();
 
 	void init(int sampleRate);
-	void setCoef(float frequency, float Q);
-	float process(float in);
+	void setCoef(SampleType frequency, SampleType Q);
+	template <typename CoefficientType>
+	void setCoef(const AllPassCoefficients<CoefficientType>& coefficients);
+	SampleType process(SampleType in);
 
 protected:
-	float m_sampleRate;
-	float m_a0 = 1.0f;
-	float m_a1 = 0.0f;
-	float m_a2 = 0.0f;
-	float m_b0 = 0.0f;
-	float m_b1 = 0.0f;
-	float m_b2 = 1.0f;
-
-	float m_x1 = 0.0f;
-	float m_x2 = 0.0f;
-	float m_y1 = 0.0f;
-	float m_y2 = 0.0f;
+	SampleType m_sampleRate;
+	SampleType m_a0 = 1;
+	SampleType m_a1 = 0;
+	SampleType m_a2 = 0;
+	SampleType m_b0 = 0;
+	SampleType m_b1 = 0;
+	SampleType m_b2 = 1;
+
+	SampleType m_x1 = 0;
+	SampleType m_x2 = 0;
+	SampleType m_y1 = 0;
+	SampleType m_y2 = 0;
 };
 
+template <typename SampleType>
+SecondOrderAllPass<SampleType>::SecondOrderAllPass()
+{
+}
+
+template <typename SampleType>
+void SecondOrderAllPass<SampleType>::init(int sampleRate)
+{
+	m_sampleRate = (SampleType)sampleRate;
+}
+
+template <typename SampleType>
+void SecondOrderAllPass<SampleType>::setCoef(SampleType frequency, SampleType Q)
+{
+	if (m_sampleRate == 0)
+	{
+		return;
+	}
+
+	setCoef(FilterDesign::allPass(frequency, Q, m_sampleRate));
+}
+
+template <typename SampleType>
+template <typename CoefficientType>
+void SecondOrderAllPass<SampleType>::setCoef(const AllPassCoefficients<CoefficientType>& coefficients)
+{
+	m_a1 = (SampleType)coefficients.a1;
+	m_a2 = (SampleType)coefficients.a2;
+	m_b0 = m_a2;
+	m_b1 = m_a1;
+}
+
+template <typename SampleType>
+SampleType SecondOrderAllPass<SampleType>::process(SampleType in)
+{
+	SampleType y = m_b0 * in + m_b1 * m_x1 + m_b2 * m_x2 - m_a1 * m_y1 - m_a2 * m_y2;
+
+	m_y2 = m_y1;
+	m_y1 = y;
+	m_x2 = m_x1;
+	m_x1 = in;
+
+	return y;
+}
+
 //==============================================================================
+template <typename SampleType>
 class LowPassFilter
 {
 public:
 	LowPassFilter() {};
 
 	void init(int sampleRate) { m_SampleRate = sampleRate; }
-	void setCoef(float frequency)
+	void setCoef(SampleType frequency)
+	{
+		setCoef(FilterDesign::lowPass(frequency, (SampleType)m_SampleRate));
+	}
+	template <typename CoefficientType>
+	void setCoef(const LowPassCoefficients<CoefficientType>& coefficients)
 	{
-		float warp = tan((frequency * 3.141593f) / m_SampleRate);
-		m_OutLastCoef = (1 - warp) / (1 + warp);
-		m_InCoef = warp / (1 + warp);
+		m_InCoef = (SampleType)coefficients.inCoef;
+		m_OutLastCoef = (SampleType)coefficients.outLastCoef;
 	}
-	float process(float in)
+	SampleType process(SampleType in)
 	{ 
 		m_OutLast = m_InCoef * (in + m_InLast) + m_OutLastCoef * m_OutLast;
 		m_InLast = in;
@@ -56,15 +120,16 @@ public:
 	}
 
 protected:
-	int   m_SampleRate = 48000;
-	float m_InCoef = 1.0f;
-	float m_OutLastCoef = 0.0f;
+	int        m_SampleRate = 48000;
+	SampleType m_InCoef = 1;
+	SampleType m_OutLastCoef = 0;
 
-	float m_OutLast = 0.0f;
-	float m_InLast = 0.0f;
+	SampleType m_OutLast = 0;
+	SampleType m_InLast = 0;
 };
 
 //==============================================================================
+template <typename SampleType>
 class LadderFilter
 {
 public:
@@ -76,20 +141,26 @@ public:
 		m_lowPassFilter[2].init(sampleRate);
 		m_lowPassFilter[3].init(sampleRate);
 	}
-	void setCoef(float frequency)
+	void setCoef(SampleType frequency)
 	{
-		m_lowPassFilter[0].setCoef(frequency);
-		m_lowPassFilter[1].setCoef(frequency);
-		m_lowPassFilter[2].setCoef(frequency);
-		m_lowPassFilter[3].setCoef(frequency);
+		// All four stages share the same cutoff, so compute it once
+		setCoef(FilterDesign::lowPass(frequency, (SampleType)m_SampleRate));
 	}
-	void setResonance(float resonance)
+	template <typename CoefficientType>
+	void setCoef(const LowPassCoefficients<CoefficientType>& coefficients)
+	{
+		m_lowPassFilter[0].setCoef(coefficients);
+		m_lowPassFilter[1].setCoef(coefficients);
+		m_lowPassFilter[2].setCoef(coefficients);
+		m_lowPassFilter[3].setCoef(coefficients);
+	}
+	void setResonance(SampleType resonance)
 	{
 		m_resonance = resonance;
 	}
-	float process(float in)
+	SampleType process(SampleType in)
 	{
-		float lowPass = in - m_resonance * m_OutLast;
+		SampleType lowPass = in - m_resonance * m_OutLast;
 
 		lowPass = m_lowPassFilter[0].process(lowPass);
 		lowPass = m_lowPassFilter[1].process(lowPass);
@@ -101,30 +172,33 @@ public:
 	}
 
 protected:
-	LowPassFilter m_lowPassFilter[4] = {};
-	int   m_SampleRate = 48000;
+	LowPassFilter<SampleType> m_lowPassFilter[4] = {};
+	int        m_SampleRate = 48000;
 
-	float m_OutLast = 0.0f;
-	float m_resonance = 0.0f;
+	SampleType m_OutLast = 0;
+	SampleType m_resonance = 0;
 };
 
 //==============================================================================
 
-class LowPassFilter12dB : public LowPassFilter
+template <typename SampleType>
+class LowPassFilter12dB : public LowPassFilter<SampleType>
 {
 public:
-	float process(float in)
+	SampleType process(SampleType in)
 	{
-		m_OutLast  = m_InCoef * in + m_OutLastCoef * m_OutLast;
-		return m_OutLast2 = m_InCoef * m_OutLast + m_OutLastCoef * m_OutLast2;
+		this->m_OutLast  = this->m_InCoef * in + this->m_OutLastCoef * this->m_OutLast;
+		return m_OutLast2 = this->m_InCoef * this->m_OutLast + this->m_OutLastCoef * m_OutLast2;
 	}
 
 protected:
-	float m_OutLast2 = 0.0f;
+	SampleType m_OutLast2 = 0;
 };
 
 //==============================================================================
-class BassEnhancerAudioProcessor  : public juce::AudioProcessor
+class BassEnhancerAudioProcessor  : public juce::AudioProcessor,
+                                    private juce::AudioProcessorValueTreeState::Listener,
+                                    private juce::AsyncUpdater
                             #if JucePlugin_Enable_ARA
                              , public juce::AudioProcessorARAExtension
                             #endif
@@ -135,16 +209,63 @@ public:
     ~BassEnhancerAudioProcessor() override;
 
 	static const std::string paramsNames[];
+	static const juce::StringArray oversamplingNames;
+	static const juce::StringArray antialiasingNames;
+
+	static juce::String getHarmonicParameterID(int harmonic) { return "Harmonic" + juce::String(harmonic); }
+
+	static const int N_OVERSAMPLING_FACTORS = 4;
+	static const int SMOOTHING_SUB_BLOCK = EnhancerGains<float>::MAX_SAMPLES;
+
+	// Arbitrary factor to make LP resonance peak at input frequency
+	static constexpr float LADDER_FILTER_FREQUENCY_FACTOR = 1.23f;
+	static constexpr float LADDER_FILTER_RESONANCE = 2.0f;
+	static constexpr float ALL_PASS_Q = 7.0f;
+	static constexpr double SMOOTHING_TIME_SECONDS = 0.05;
+
+	// Crossfade between processed and delayed dry on entering and leaving bypass,
+	// and the most input history the DSP runs over before it resumes
+	static constexpr double BYPASS_FADE_SECONDS = 0.02;
+	static constexpr double BYPASS_PRIME_SECONDS = 0.1;
+
+	// -120 dBFS, below it input and tail count as silence
+	static constexpr float SILENCE_THRESHOLD = 1.0e-6f;
+	static constexpr double MAX_TAIL_SECONDS = 10.0;
 
     //==============================================================================
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void reset() override;
 
    #ifndef JucePlugin_PreferredChannelConfigurations
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+
+	// Hosts that bypass without the parameter get the same latency-compensated crossfade
+	void processBlockBypassed (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+	void processBlockBypassed (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+
+	juce::AudioProcessorParameter* getBypassParameter() const override { return bypassParameter; }
+
+	// Hosts with a 64-bit mix engine get filters, kernels and oversampling in
+	// double. With the DoublePrecision parameter float I/O runs through them too.
+	bool supportsDoublePrecisionProcessing() const override { return true; }
+
+	// When enabled (default) processing stops once input and tail are silent
+	void setSkipSilence(bool shouldSkip) { m_skipSilence.store(shouldSkip); }
+
+	// Forces the kernels of one InstructionSet from the next prepareToPlay on,
+	// -1 (default) picks the best one the CPU supports
+	void setInstructionSetOverride(int instructionSet) { m_instructionSetOverride.store(instructionSet); }
+	int getInstructionSet() const { return m_instructionSet.load(); }
+
+	PerformanceTelemetry& getTelemetry() { return m_telemetry; }
+	SpectrumAnalyzer& getAnalyzer() { return m_analyzer; }
+	const FundamentalTracker& getTracker() const { return m_tracker; }
+	OutputMeter& getMeter() { return m_meter; }
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -185,10 +306,181 @@ private:
 	juce::AudioParameterBool* buttonBParameter = nullptr;
 	juce::AudioParameterBool* buttonCParameter = nullptr;
 	juce::AudioParameterBool* buttonDParameter = nullptr;
+	juce::AudioParameterBool* buttonEParameter = nullptr;
+
+	// Mode E weights of harmonics 2..8
+	std::atomic<float>* harmonicParameters[HarmonicRange::N_HARMONICS] = {};
+	float m_harmonicWeights[HarmonicRange::N_HARMONICS] = {};
+	bool m_harmonicsDirty = true;
+
+	juce::AudioParameterChoice* oversamplingParameter = nullptr;
+	juce::AudioParameterChoice* offlineOversamplingParameter = nullptr;
+	juce::AudioParameterChoice* antialiasingParameter = nullptr;
+	juce::AudioParameterBool* linearPhaseParameter = nullptr;
+	juce::AudioParameterBool* doublePrecisionParameter = nullptr;
+	juce::AudioParameterBool* midSideParameter = nullptr;
+	juce::AudioParameterBool* trackingParameter = nullptr;
+	juce::AudioParameterBool* bypassParameter = nullptr;
+
+	// Everything that runs at the host's sample precision. prepareToPlay
+	// allocates the precision the host asked for and frees the other one.
+	template <typename SampleType>
+	struct PrecisionState
+	{
+		// Each SIMD lane carries one channel, one filter group per SIMDNumElements channels
+		std::vector<EnhancerFilters<SampleType>> filters;
+		EnhancerGains<SampleType> gains;
+		EnhancerKernelFunction<SampleType> kernel = nullptr;
+
+		std::vector<SIMDVector<SampleType>> interleaved;
+		std::vector<SIMDVector<SampleType>> dryInterleaved;
+
+		// Mono and the mid of a stereo pair fill the lanes with successive samples
+		// instead, empty unless prepared for one or two channels
+		std::vector<EnhancerTimeFilters<SampleType>> timeFilters;
+		EnhancerTimeGains<SampleType> timeGains;
+		EnhancerTimeKernelFunction<SampleType> timeKernel = nullptr;
+
+		// Band and delayed dry input from the linear-phase band split
+		juce::AudioBuffer<SampleType> bandBuffer;
+		juce::AudioBuffer<SampleType> dryBuffer;
+
+		// Recent input the DSP runs over when it resumes from bypass, a block at a time
+		juce::AudioBuffer<SampleType> primeBuffer;
+
+		// Index 0 is 1x and needs no oversampler
+		std::unique_ptr<juce::dsp::Oversampling<SampleType>> oversampling[N_OVERSAMPLING_FACTORS];
+	};
+
+	PrecisionState<float> m_floatState;
+	PrecisionState<double> m_doubleState;
+
+	// Float I/O converted for the double state, one block at a time. Resized
+	// within the prepared channels and samples, which never reallocates.
+	juce::AudioBuffer<double> m_doubleBuffer;
+	int m_doubleBufferChannels = 0;
+	bool m_doublePrecision = false;
+
+	// Written by parameter listeners, the kernel is only swapped when it changes
+	std::atomic<int> m_distortionMode { DISTORTION_MODE_A };
+	int m_kernelMode = -1;
+	int m_kernelAntialiasing = -1;
+	bool m_kernelLinearPhase = false;
+
+	// Chosen in prepareToPlay, see CpuDispatch.h
+	std::atomic<int> m_instructionSet { INSTRUCTION_SET_BASELINE };
+	std::atomic<int> m_instructionSetOverride { -1 };
+
+	// Factory presets, shared by every instance and resolved to this
+	// instance's parameters once, so switching needs no lookups
+	juce::SharedResourcePointer<PresetBank> m_presetBank;
+	juce::RangedAudioParameter* m_presetParameters[PresetBank::N_PARAMETERS] = {};
+	std::atomic<float>* m_presetRawValues[PresetBank::N_PARAMETERS] = {};
+	std::atomic<int> m_currentProgram { 0 };
+	std::atomic<bool> m_programChanged { false };
+
+	// Linear-phase prefilter, run per channel ahead of the kernel
+	LinearPhaseBandSplit m_bandSplit;
+	juce::SharedResourcePointer<LinearPhaseDesignThread> m_designThread;
+	bool m_linearPhase = false;
+
+	// Stereo only, the chain runs once on mid and side takes the dry path
+	bool m_midSide = false;
+
+	// With Tracking the detected fundamental replaces the Frequency parameter
+	FundamentalTracker m_tracker;
+	juce::SharedResourcePointer<FundamentalTrackerThread> m_trackerThread;
+
+	// One table per oversampling factor, built in prepareToPlay
+	FilterCoefficientTable m_coefficientTables[N_OVERSAMPLING_FACTORS];
+
+	int m_oversamplingIndex = -1;
+	int m_maxBlockSize = 0;
+	double m_sampleRate = 48000.0;
+
+	juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> m_frequencySmoothed;
+	juce::SmoothedValue<float> m_gainSmoothed;
+	juce::SmoothedValue<float> m_mixSmoothed;
+	juce::SmoothedValue<float> m_volumeSmoothed;
+	bool m_coefficientsDirty = true;
+
+	// While fully bypassed (suspended) only the delay runs. It is always written,
+	// so it holds the history to prime the DSP with and the dry for the crossfades.
+	juce::AudioBuffer<double> m_bypassDelay;
+	juce::AudioBuffer<double> m_bypassDry;
+	std::vector<float> m_bypassGains;
+	int m_bypassPosition = 0;
+	juce::SmoothedValue<float> m_bypassFade;
+	bool m_bypass = false;
+	bool m_suspended = false;
+	bool m_hostBypass = false;
+
+	// Resuming, the DSP catches up with the input in the delay before the fade.
+	// m_primeLag is how far behind the newest input it still is.
+	bool m_priming = false;
+	int m_primeLag = 0;
+
+	// Tail of the current settings, written on the audio thread
+	std::atomic<double> m_tailSeconds { 0.0 };
+
+	// Latency of the current settings. The audio thread writes it, the host
+	// hears of it from the message thread.
+	std::atomic<int> m_latencySamples { 0 };
+
+	std::atomic<bool> m_skipSilence { true };
+	juce::int64 m_silentSamples = 0;
+	bool m_isSilent = false;
+
+	PerformanceTelemetry m_telemetry;
+	int m_coefficientUpdates = 0;
+
+	// Fed only while an editor shows the spectrum
+	SpectrumAnalyzer m_analyzer;
+
+	// Output true peak and loudness, runs only while a consumer is attached
+	OutputMeter m_meter;
+
+	void parameterChanged(const juce::String& parameterID, float newValue) override;
+	void handleAsyncUpdate() override;
+	int getDistortionMode() const;
+	float getTargetFrequency() const;
+
+	template <typename SampleType> PrecisionState<SampleType>& getState();
+	template <typename SampleType> void prepareState(PrecisionState<SampleType>& state, int channels, int maxOversampledBlockSize);
+
+	// Visits the float and the double state, the one not prepared is empty
+	template <typename Function>
+	void forEachState(Function&& function)
+	{
+		function(m_floatState);
+		function(m_doubleState);
+	}
 
-	LowPassFilter12dB  m_lowPassFilter[2] = {};
-	LadderFilter       m_ladderFilter[2] = {};
-	SecondOrderAllPass m_secondOrderAllPass[2] = {};
+	template <typename SampleType> void processBuffer(juce::AudioBuffer<SampleType>& buffer);
+	template <typename SampleType> void processUnbypassed(juce::AudioBuffer<SampleType>& buffer, int startSample, int samples);
+	template <typename SampleType> void processCrossfade(juce::AudioBuffer<SampleType>& buffer, int channels);
+	bool isRestartPending() const;
+	void updateRestartSettings();
+	void beginPriming();
+	template <typename SampleType> void primeFromBypass(int newSamples);
+	template <typename SampleType, typename OutputType> void delayBypass(const SampleType* in, OutputType* out, int channel, int samples);
+	void advanceBypass(int samples);
+	void processInDoublePrecision(juce::AudioBuffer<float>& buffer);
+	template <typename SampleType> void processInstrumented(juce::AudioBuffer<SampleType>& buffer, int startSample, int samples);
+	template <typename SampleType> bool processEnhancer(juce::AudioBuffer<SampleType>& buffer, int startSample, int samples);
+	template <typename SampleType> bool processSegment(juce::AudioBuffer<SampleType>& buffer, int startSample, int samples);
+	void updateOversampling();
+	void updateLatency();
+	int computeLatency(int index, bool linearPhase);
+	void setSmoothersToParameters();
+	void updateCoefficients(int samples);
+	void updateHarmonics();
+	double computeTailSeconds(double decay) const;
+	template <typename SampleType> void processSubBlock(juce::dsp::AudioBlock<SampleType>& block);
+	template <typename SampleType> void processLanes(SIMDVector<SampleType>* lanes, const SIMDVector<SampleType>* dryLanes, int samples);
+	template <typename SampleType> void processMidSide(juce::dsp::AudioBlock<SampleType>& block);
+	template <typename SampleType> void processTimeVectorized(SampleType* channel, SampleType* side, int samples);
+	template <typename SampleType> void getNextGains(SampleType& gain, SampleType& wet, SampleType& dry);
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BassEnhancerAudioProcessor)
 };
@@ -0,0 +1,172 @@
+/*
+  ==============================================================================
+
+    Compact binary plugin state and the factory preset bank.
+
+    The state is a flat list of parameter ID / plain value pairs behind a
+    magic number and a version, so loading it builds no ValueTree and parses
+    no XML. Blobs saved before the format existed hold XML wrapped by
+    copyXmlToBinary, read() rejects them and the caller falls back to XML.
+
+    The preset bank is built once per process and shared by every instance
+    through a SharedResourcePointer. It never changes after construction,
+    so program switches read it without locks and write one value per
+    preset parameter.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "EnhancerKernel.h"
+
+//==============================================================================
+namespace CompactState
+{
+	// "BENH" in the first four bytes
+	static constexpr juce::uint32 MAGIC = 0x484e4542;
+
+	// Later versions append fields after the entries, older readers ignore them
+	static constexpr int VERSION = 1;
+
+	struct Entry
+	{
+		juce::String id;
+		float value = 0.0f;
+	};
+
+	// Message thread. Values are stored in parameter units, so range changes keep their meaning.
+	inline void write(const juce::Array<juce::AudioProcessorParameter*>& parameters, int program, juce::MemoryBlock& destData)
+	{
+		juce::Array<juce::RangedAudioParameter*> ranged;
+
+		for (auto* parameter : parameters)
+			if (auto* rangedParameter = dynamic_cast<juce::RangedAudioParameter*>(parameter))
+				ranged.add(rangedParameter);
+
+		juce::MemoryOutputStream stream(destData, false);
+		stream.writeInt((int)MAGIC);
+		stream.writeShort((short)VERSION);
+		stream.writeShort((short)program);
+		stream.writeShort((short)ranged.size());
+
+		for (auto* parameter : ranged)
+		{
+			const juce::String id = parameter->getParameterID();
+			const size_t idBytes = juce::jmin<size_t>(255, id.getNumBytesAsUTF8());
+
+			stream.writeByte((char)idBytes);
+			stream.write(id.toRawUTF8(), idBytes);
+			stream.writeFloat(parameter->convertFrom0to1(parameter->getValue()));
+		}
+	}
+
+	// Returns false for anything but a complete compact state, including the old XML blobs
+	inline bool read(const void* data, int sizeInBytes, int& program, std::vector<Entry>& entries)
+	{
+		juce::MemoryInputStream stream(data, (size_t)juce::jmax(0, sizeInBytes), false);
+
+		if (stream.getNumBytesRemaining() < 10 || (juce::uint32)stream.readInt() != MAGIC)
+			return false;
+
+		if (stream.readShort() < 1)
+			return false;
+
+		program = (int)(juce::uint16)stream.readShort();
+		const int count = (int)(juce::uint16)stream.readShort();
+
+		entries.clear();
+		entries.reserve((size_t)count);
+
+		for (int i = 0; i < count; ++i)
+		{
+			if (stream.getNumBytesRemaining() < 1)
+				return false;
+
+			const int idBytes = (int)(juce::uint8)stream.readByte();
+
+			if (stream.getNumBytesRemaining() < idBytes + (juce::int64)sizeof(float))
+				return false;
+
+			char id[256];
+			stream.read(id, idBytes);
+
+			Entry entry;
+			entry.id = juce::String::fromUTF8(id, idBytes);
+			entry.value = stream.readFloat();
+			entries.push_back(entry);
+		}
+
+		return true;
+	}
+}
+
+//==============================================================================
+// Presets set the sound, quality settings (oversampling, linear phase, precision) and mid/side stay as they are
+class PresetBank
+{
+public:
+	static_assert(HarmonicRange::FIRST_HARMONIC == 2 && HarmonicRange::LAST_HARMONIC == 8, "Update the harmonic IDs below");
+
+	static constexpr const char* PARAMETER_IDS[] =
+	{
+		"Frequency", "Gain", "Mix", "Volume",
+		"ButtonA", "ButtonB", "ButtonC", "ButtonD", "ButtonE",
+		"Antialiasing",
+		"Harmonic2", "Harmonic3", "Harmonic4", "Harmonic5", "Harmonic6", "Harmonic7", "Harmonic8"
+	};
+
+	static const int N_PARAMETERS = (int)(sizeof(PARAMETER_IDS) / sizeof(PARAMETER_IDS[0]));
+
+	struct Preset
+	{
+		juce::String name;
+
+		// Plain values, in PARAMETER_IDS order
+		float values[N_PARAMETERS] = {};
+	};
+
+	PresetBank()
+	{
+		addPreset("Default",        DISTORTION_MODE_A,  80.0f, 0.5f, 1.0f,  0.0f, ANTIALIASING_OFF,   { 0.5f, 0.5f });
+		addPreset("Subtle Warmth",  DISTORTION_MODE_B,  60.0f, 0.3f, 0.3f,  0.0f, ANTIALIASING_OFF,   { 0.5f, 0.5f });
+		addPreset("Deep Sub",       DISTORTION_MODE_A,  45.0f, 0.6f, 0.5f, -1.0f, ANTIALIASING_OFF,   { 0.5f, 0.5f });
+		addPreset("Punchy Kick",    DISTORTION_MODE_C,  70.0f, 0.8f, 0.6f, -2.0f, ANTIALIASING_ADAA1, { 0.5f, 0.5f });
+		addPreset("Bass Growl",     DISTORTION_MODE_D, 120.0f, 0.9f, 0.7f, -3.0f, ANTIALIASING_ADAA1, { 0.5f, 0.5f });
+		addPreset("Small Speakers", DISTORTION_MODE_E, 100.0f, 0.7f, 0.6f, -1.5f, ANTIALIASING_OFF,   { 0.6f, 0.8f, 0.3f, 0.2f });
+		addPreset("Odd Harmonics",  DISTORTION_MODE_E,  80.0f, 0.6f, 0.5f, -1.0f, ANTIALIASING_OFF,   { 0.0f, 0.8f, 0.0f, 0.4f, 0.0f, 0.2f });
+	}
+
+	int size() const { return (int)m_presets.size(); }
+	const Preset& getPreset(int index) const { return m_presets[(size_t)index]; }
+
+private:
+	void addPreset(const juce::String& name, int mode, float frequency, float gain, float mix, float volume, int antialiasing, std::initializer_list<float> harmonics)
+	{
+		Preset preset;
+		preset.name = name;
+
+		float* values = preset.values;
+		*values++ = frequency;
+		*values++ = gain;
+		*values++ = mix;
+		*values++ = volume;
+
+		for (int button = 0; button < N_DISTORTION_MODES; ++button)
+			*values++ = button == mode ? 1.0f : 0.0f;
+
+		*values++ = (float)antialiasing;
+
+		// Harmonics that are not listed are off
+		for (int i = 0; i < HarmonicRange::N_HARMONICS; ++i)
+			*values++ = i < (int)harmonics.size() ? harmonics.begin()[i] : 0.0f;
+
+		jassert(values == preset.values + N_PARAMETERS);
+		m_presets.push_back(preset);
+	}
+
+	std::vector<Preset> m_presets;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PresetBank)
+};
@@ -0,0 +1,363 @@
+/*
+  ==============================================================================
+
+    SIMD versions of the filters from PluginProcessor.h.
+
+    Every filter keeps one state value per SIMD lane, so each lane can carry
+    one audio channel and a single recursion step serves all of them.
+    Filters are templated on the sample type, double registers carry half
+    as many channels.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "FilterCoefficients.h"
+
+using SIMDFloat = juce::dsp::SIMDRegister<float>;
+using SIMDDouble = juce::dsp::SIMDRegister<double>;
+
+template <typename SampleType>
+using SIMDVector = juce::dsp::SIMDRegister<SampleType>;
+
+//==============================================================================
+namespace SIMDHelpers
+{
+	inline SIMDFloat divide(SIMDFloat a, SIMDFloat b)
+	{
+	#if JUCE_USE_SSE_INTRINSICS
+		return SIMDFloat::fromNative(_mm_div_ps(a.value, b.value));
+	#elif JUCE_USE_ARM_NEON && JUCE_64BIT
+		return SIMDFloat::fromNative(vdivq_f32(a.value, b.value));
+	#else
+		for (size_t i = 0; i < SIMDFloat::SIMDNumElements; ++i)
+			a.set(i, a.get(i) / b.get(i));
+
+		return a;
+	#endif
+	}
+
+	// JUCE only maps double registers to SSE, NEON uses its scalar fallback for them
+	inline SIMDDouble divide(SIMDDouble a, SIMDDouble b)
+	{
+	#if JUCE_USE_SSE_INTRINSICS
+		return SIMDDouble::fromNative(_mm_div_pd(a.value, b.value));
+	#else
+		for (size_t i = 0; i < SIMDDouble::SIMDNumElements; ++i)
+			a.set(i, a.get(i) / b.get(i));
+
+		return a;
+	#endif
+	}
+
+	// Lane-wise (mask ? a : b)
+	template <typename SIMDType>
+	inline SIMDType select(typename SIMDType::vMaskType mask, SIMDType a, SIMDType b)
+	{
+		return (a & mask) | (b & ~mask);
+	}
+
+	// Lane-wise (in >= 0) ? 1 : -1
+	template <typename SIMDType>
+	inline SIMDType sign(SIMDType in)
+	{
+		return select(SIMDType::greaterThanOrEqual(in, SIMDType::expand(0)), SIMDType::expand(1), SIMDType::expand(-1));
+	}
+
+	// Splits positive normal floats into mantissa in [1, 2) and exponent
+	inline SIMDFloat splitExponent(SIMDFloat in, SIMDFloat& exponent)
+	{
+	#if JUCE_USE_SSE_INTRINSICS
+		const __m128i bits = _mm_castps_si128(in.value);
+		exponent = SIMDFloat::fromNative(_mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127))));
+		return SIMDFloat::fromNative(_mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(0x3f800000))));
+	#elif JUCE_USE_ARM_NEON
+		const int32x4_t bits = vreinterpretq_s32_f32(in.value);
+		exponent = SIMDFloat::fromNative(vcvtq_f32_s32(vsubq_s32(vshrq_n_s32(bits, 23), vdupq_n_s32(127))));
+		return SIMDFloat::fromNative(vreinterpretq_f32_s32(vorrq_s32(vandq_s32(bits, vdupq_n_s32(0x007fffff)), vdupq_n_s32(0x3f800000))));
+	#else
+		for (size_t i = 0; i < SIMDFloat::SIMDNumElements; ++i)
+		{
+			int e = 0;
+			const float mantissa = std::frexp(in.get(i), &e);
+			in.set(i, 2.0f * mantissa);
+			exponent.set(i, (float)(e - 1));
+		}
+
+		return in;
+	#endif
+	}
+
+	// Natural log of positive normal floats, within a few ulp of std::log.
+	// The mantissa is folded into [sqrt(0.5), sqrt(2)) and ln(m) = 2 atanh((m - 1) / (m + 1))
+	// is expanded up to s^9, |s| < 0.172.
+	inline SIMDFloat log(SIMDFloat in)
+	{
+		const SIMDFloat one = SIMDFloat::expand(1.0f);
+
+		SIMDFloat exponent = SIMDFloat::expand(0.0f);
+		SIMDFloat mantissa = splitExponent(in, exponent);
+
+		const auto fold = SIMDFloat::greaterThan(mantissa, SIMDFloat::expand(1.41421356f));
+		mantissa = select(fold, mantissa * SIMDFloat::expand(0.5f), mantissa);
+		exponent = exponent + (one & fold);
+
+		const SIMDFloat s = divide(mantissa - one, mantissa + one);
+		const SIMDFloat s2 = s * s;
+		const SIMDFloat series = SIMDFloat::expand(2.0f / 3.0f) + s2 * (SIMDFloat::expand(2.0f / 5.0f) + s2 * (SIMDFloat::expand(2.0f / 7.0f) + s2 * SIMDFloat::expand(2.0f / 9.0f)));
+
+		return exponent * SIMDFloat::expand(0.693147181f) + s * (SIMDFloat::expand(2.0f) + s2 * series);
+	}
+
+	// Double precision would need a longer series, with two lanes std::log costs about the same
+	inline SIMDDouble log(SIMDDouble in)
+	{
+		for (size_t i = 0; i < SIMDDouble::SIMDNumElements; ++i)
+			in.set(i, std::log(in.get(i)));
+
+		return in;
+	}
+
+	// fromRawArray / copyToRawArray need aligned memory, these take any address
+	template <typename SampleType>
+	inline SIMDVector<SampleType> load(const SampleType* source)
+	{
+		SIMDVector<SampleType> out;
+		std::memcpy(&out.value, source, sizeof(out.value));
+		return out;
+	}
+
+	template <typename SampleType>
+	inline void store(SampleType* destination, SIMDVector<SampleType> in)
+	{
+		std::memcpy(destination, &in.value, sizeof(in.value));
+	}
+
+	// For lanes holding successive samples: shifts current up by count lanes,
+	// 0 <= count <= SIMDNumElements, and fills the bottom with the last count
+	// lanes of previous. count is a constant where it matters, the switch folds away.
+	template <typename SIMDType>
+	inline SIMDType shiftInGeneric(SIMDType current, SIMDType previous, int count)
+	{
+		const int lanes = (int)SIMDType::SIMDNumElements;
+		SIMDType out = current;
+
+		for (int i = 0; i < lanes; ++i)
+			out.set((size_t)i, i >= count ? current.get((size_t)(i - count)) : previous.get((size_t)(lanes + i - count)));
+
+		return out;
+	}
+
+	inline SIMDFloat shiftIn(SIMDFloat current, SIMDFloat previous, int count)
+	{
+	#if JUCE_USE_SSE_INTRINSICS
+		switch (count)
+		{
+			case 0: return current;
+			case 1: return SIMDFloat::fromNative(_mm_shuffle_ps(_mm_shuffle_ps(previous.value, current.value, _MM_SHUFFLE(0, 0, 3, 3)), current.value, _MM_SHUFFLE(2, 1, 2, 0)));
+			case 2: return SIMDFloat::fromNative(_mm_shuffle_ps(previous.value, current.value, _MM_SHUFFLE(1, 0, 3, 2)));
+			case 3: return SIMDFloat::fromNative(_mm_shuffle_ps(previous.value, _mm_shuffle_ps(previous.value, current.value, _MM_SHUFFLE(0, 0, 3, 3)), _MM_SHUFFLE(2, 0, 2, 1)));
+			default: return previous;
+		}
+	#elif JUCE_USE_ARM_NEON
+		switch (count)
+		{
+			case 0: return current;
+			case 1: return SIMDFloat::fromNative(vextq_f32(previous.value, current.value, 3));
+			case 2: return SIMDFloat::fromNative(vextq_f32(previous.value, current.value, 2));
+			case 3: return SIMDFloat::fromNative(vextq_f32(previous.value, current.value, 1));
+			default: return previous;
+		}
+	#else
+		return shiftInGeneric(current, previous, count);
+	#endif
+	}
+
+	inline SIMDDouble shiftIn(SIMDDouble current, SIMDDouble previous, int count)
+	{
+	#if JUCE_USE_SSE_INTRINSICS
+		switch (count)
+		{
+			case 0: return current;
+			case 1: return SIMDDouble::fromNative(_mm_shuffle_pd(previous.value, current.value, 1));
+			default: return previous;
+		}
+	#else
+		return shiftInGeneric(current, previous, count);
+	#endif
+	}
+}
+
+//==============================================================================
+template <typename SampleType>
+class SecondOrderAllPassSIMD
+{
+public:
+	using SIMDType = SIMDVector<SampleType>;
+
+	void init(int sampleRate) { m_sampleRate = (SampleType)sampleRate; }
+	void setCoef(SampleType frequency, SampleType Q)
+	{
+		if (m_sampleRate == SampleType(0))
+		{
+			return;
+		}
+
+		setCoef(FilterDesign::allPass(frequency, Q, m_sampleRate));
+	}
+	template <typename CoefficientType>
+	void setCoef(const AllPassCoefficients<CoefficientType>& coefficients)
+	{
+		m_a1 = SIMDType::expand((SampleType)coefficients.a1);
+		m_a2 = SIMDType::expand((SampleType)coefficients.a2);
+	}
+	void reset()
+	{
+		m_x1 = m_x2 = m_y1 = m_y2 = SIMDType::expand(0);
+	}
+	SIMDType process(SIMDType in)
+	{
+		// All-pass: b0 = a2, b1 = a1, b2 = 1
+		const SIMDType y = m_a2 * in + m_a1 * m_x1 + m_x2 - m_a1 * m_y1 - m_a2 * m_y2;
+
+		m_y2 = m_y1;
+		m_y1 = y;
+		m_x2 = m_x1;
+		m_x1 = in;
+
+		return y;
+	}
+
+protected:
+	SampleType m_sampleRate = SampleType(0);
+	SIMDType m_a1 = SIMDType::expand(0);
+	SIMDType m_a2 = SIMDType::expand(0);
+
+	SIMDType m_x1 = SIMDType::expand(0);
+	SIMDType m_x2 = SIMDType::expand(0);
+	SIMDType m_y1 = SIMDType::expand(0);
+	SIMDType m_y2 = SIMDType::expand(0);
+};
+
+//==============================================================================
+template <typename SampleType>
+class LowPassFilterSIMD
+{
+public:
+	using SIMDType = SIMDVector<SampleType>;
+
+	void init(int sampleRate) { m_SampleRate = sampleRate; }
+	void setCoef(SampleType frequency)
+	{
+		setCoef(FilterDesign::lowPass(frequency, (SampleType)m_SampleRate));
+	}
+	template <typename CoefficientType>
+	void setCoef(const LowPassCoefficients<CoefficientType>& coefficients)
+	{
+		m_InCoef = SIMDType::expand((SampleType)coefficients.inCoef);
+		m_OutLastCoef = SIMDType::expand((SampleType)coefficients.outLastCoef);
+	}
+	void reset()
+	{
+		m_OutLast = m_InLast = SIMDType::expand(0);
+	}
+	SIMDType process(SIMDType in)
+	{
+		m_OutLast = m_InCoef * (in + m_InLast) + m_OutLastCoef * m_OutLast;
+		m_InLast = in;
+		return m_OutLast;
+	}
+
+protected:
+	int      m_SampleRate = 48000;
+	SIMDType m_InCoef = SIMDType::expand(1);
+	SIMDType m_OutLastCoef = SIMDType::expand(0);
+
+	SIMDType m_OutLast = SIMDType::expand(0);
+	SIMDType m_InLast = SIMDType::expand(0);
+};
+
+//==============================================================================
+template <typename SampleType>
+class LadderFilterSIMD
+{
+public:
+	using SIMDType = SIMDVector<SampleType>;
+
+	void init(int sampleRate)
+	{
+		m_SampleRate = sampleRate;
+		m_lowPassFilter[0].init(sampleRate);
+		m_lowPassFilter[1].init(sampleRate);
+		m_lowPassFilter[2].init(sampleRate);
+		m_lowPassFilter[3].init(sampleRate);
+	}
+	void setCoef(SampleType frequency)
+	{
+		// All four stages share the same cutoff, so compute it once
+		setCoef(FilterDesign::lowPass(frequency, (SampleType)m_SampleRate));
+	}
+	template <typename CoefficientType>
+	void setCoef(const LowPassCoefficients<CoefficientType>& coefficients)
+	{
+		m_lowPassFilter[0].setCoef(coefficients);
+		m_lowPassFilter[1].setCoef(coefficients);
+		m_lowPassFilter[2].setCoef(coefficients);
+		m_lowPassFilter[3].setCoef(coefficients);
+	}
+	void setResonance(SampleType resonance)
+	{
+		m_resonance = SIMDType::expand(resonance);
+	}
+	void reset()
+	{
+		m_lowPassFilter[0].reset();
+		m_lowPassFilter[1].reset();
+		m_lowPassFilter[2].reset();
+		m_lowPassFilter[3].reset();
+		m_OutLast = SIMDType::expand(0);
+	}
+	SIMDType process(SIMDType in)
+	{
+		SIMDType lowPass = in - m_resonance * m_OutLast;
+
+		lowPass = m_lowPassFilter[0].process(lowPass);
+		lowPass = m_lowPassFilter[1].process(lowPass);
+		lowPass = m_lowPassFilter[2].process(lowPass);
+		lowPass = m_lowPassFilter[3].process(lowPass);
+
+		m_OutLast = lowPass;
+		return lowPass;
+	}
+
+protected:
+	LowPassFilterSIMD<SampleType> m_lowPassFilter[4] = {};
+	int       m_SampleRate = 48000;
+
+	SIMDType m_OutLast = SIMDType::expand(0);
+	SIMDType m_resonance = SIMDType::expand(0);
+};
+
+//==============================================================================
+template <typename SampleType>
+class LowPassFilter12dBSIMD : public LowPassFilterSIMD<SampleType>
+{
+public:
+	using SIMDType = SIMDVector<SampleType>;
+
+	void reset()
+	{
+		LowPassFilterSIMD<SampleType>::reset();
+		m_OutLast2 = SIMDType::expand(0);
+	}
+	SIMDType process(SIMDType in)
+	{
+		this->m_OutLast  = this->m_InCoef * in + this->m_OutLastCoef * this->m_OutLast;
+		return m_OutLast2 = this->m_InCoef * this->m_OutLast + this->m_OutLastCoef * m_OutLast2;
+	}
+
+protected:
+	SIMDType m_OutLast2 = SIMDType::expand(0);
+};
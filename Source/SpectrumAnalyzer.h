@@ -0,0 +1,399 @@
+/*
+  ==============================================================================
+
+    Input / output spectrum analyzer.
+
+    The audio thread pushes a mono mix of the input and the output into two
+    wait-free FIFOs. A TimeSliceThread shared by all open editors drains
+    them, runs the FFTs and renders the spectra into an image, at most
+    MAX_FRAME_RATE times per second. The editor only blits that image.
+    Everything the analysis needs is allocated up front or when the view
+    is resized, never per frame and never on the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+class SpectrumAnalyzer : public juce::TimeSliceClient
+{
+public:
+	static const int FFT_ORDER = 12;
+	static const int FFT_SIZE = 1 << FFT_ORDER;
+	static const int FIFO_SIZE = FFT_SIZE * 4;
+	static const int MAX_FRAME_RATE = 30;
+	static const int N_HARMONICS = 8;
+
+	static constexpr float MIN_FREQUENCY = 20.0f;
+	static constexpr float MAX_FREQUENCY = 20000.0f;
+	static constexpr float MIN_DECIBELS = -96.0f;
+	static constexpr float MAX_DECIBELS = 6.0f;
+
+	// Output this much above input counts as generated by the enhancer
+	static constexpr float HARMONIC_THRESHOLD_DECIBELS = 3.0f;
+
+	// Weight of the previous frame in the displayed magnitudes
+	static constexpr float SMOOTHING = 0.7f;
+
+	SpectrumAnalyzer()
+	{
+	}
+
+	//==============================================================================
+	// Audio thread
+	void prepare(double sampleRate) { m_sampleRate.store(sampleRate); }
+	bool isActive() const { return m_active.load(std::memory_order_relaxed); }
+
+	template <typename SampleType>
+	void pushInput(const juce::AudioBuffer<SampleType>& buffer, int channels) { push(m_input, buffer, channels); }
+	template <typename SampleType>
+	void pushOutput(const juce::AudioBuffer<SampleType>& buffer, int channels) { push(m_output, buffer, channels); }
+
+	//==============================================================================
+	// Message thread
+	void setActive(bool shouldBeActive)
+	{
+		m_discardPending.store(true);
+		m_active.store(shouldBeActive);
+	}
+
+	void setFundamental(float frequency) { m_fundamental.store(frequency); }
+
+	void setImageSize(int width, int height)
+	{
+		m_requestedWidth.store(juce::jmax(1, width));
+		m_requestedHeight.store(juce::jmax(1, height));
+	}
+
+	int getFrameCount() const { return m_frameCount.load(); }
+
+	void drawFrame(juce::Graphics& g, juce::Rectangle<float> area)
+	{
+		const juce::SpinLock::ScopedLockType lock(m_imageLock);
+
+		if (m_images[m_frontImage].isValid())
+			g.drawImage(m_images[m_frontImage], area);
+	}
+
+	//==============================================================================
+	// Analysis thread
+	int useTimeSlice() override
+	{
+		if (m_discardPending.exchange(false))
+		{
+			discard(m_input);
+			discard(m_output);
+		}
+
+		drain(m_input);
+		drain(m_output);
+
+		const double now = juce::Time::getMillisecondCounterHiRes();
+
+		if (now - m_lastFrameTime < 1000.0 / MAX_FRAME_RATE)
+		{
+			return (int)(1000.0 / MAX_FRAME_RATE - (now - m_lastFrameTime)) + 1;
+		}
+
+		m_lastFrameTime = now;
+
+		analyse(m_input);
+		analyse(m_output);
+		render();
+
+		return 1000 / MAX_FRAME_RATE;
+	}
+
+private:
+	struct Channel
+	{
+		juce::AbstractFifo fifo { FIFO_SIZE };
+		std::vector<float> fifoData = std::vector<float>((size_t)FIFO_SIZE, 0.0f);
+
+		// Last FFT_SIZE samples, circular
+		std::vector<float> history = std::vector<float>((size_t)FFT_SIZE, 0.0f);
+		int historyPosition = 0;
+
+		std::vector<float> fftData = std::vector<float>((size_t)FFT_SIZE * 2, 0.0f);
+		std::vector<float> decibels = std::vector<float>((size_t)FFT_SIZE / 2, MIN_DECIBELS);
+
+		// Smoothed level per image column
+		std::vector<float> columns;
+		juce::Path path;
+	};
+
+	// Wait-free mono mix into the FIFO, samples are dropped while it is full
+	template <typename SampleType>
+	static void push(Channel& channel, const juce::AudioBuffer<SampleType>& buffer, int channels)
+	{
+		if (channels <= 0)
+		{
+			return;
+		}
+
+		int start1, size1, start2, size2;
+		channel.fifo.prepareToWrite(buffer.getNumSamples(), start1, size1, start2, size2);
+
+		const float gain = 1.0f / channels;
+
+		auto mix = [&] (int start, int size, int offset)
+		{
+			if (size <= 0)
+				return;
+
+			float* destination = channel.fifoData.data() + start;
+
+			if constexpr (std::is_same<SampleType, float>::value)
+			{
+				juce::FloatVectorOperations::copyWithMultiply(destination, buffer.getReadPointer(0, offset), gain, size);
+
+				for (int i = 1; i < channels; ++i)
+					juce::FloatVectorOperations::addWithMultiply(destination, buffer.getReadPointer(i, offset), gain, size);
+			}
+			else
+			{
+				// The display runs in float
+				juce::FloatVectorOperations::clear(destination, size);
+
+				for (int i = 0; i < channels; ++i)
+				{
+					const SampleType* source = buffer.getReadPointer(i, offset);
+
+					for (int sample = 0; sample < size; ++sample)
+						destination[sample] += gain * (float)source[sample];
+				}
+			}
+		};
+
+		mix(start1, size1, 0);
+		mix(start2, size2, size1);
+
+		channel.fifo.finishedWrite(size1 + size2);
+	}
+
+	static void discard(Channel& channel)
+	{
+		channel.fifo.finishedRead(channel.fifo.getNumReady());
+		std::fill(channel.history.begin(), channel.history.end(), 0.0f);
+		std::fill(channel.decibels.begin(), channel.decibels.end(), MIN_DECIBELS);
+	}
+
+	static void drain(Channel& channel)
+	{
+		int start1, size1, start2, size2;
+		channel.fifo.prepareToRead(channel.fifo.getNumReady(), start1, size1, start2, size2);
+
+		auto append = [&] (int start, int size)
+		{
+			for (int i = 0; i < size; ++i)
+			{
+				channel.history[(size_t)channel.historyPosition] = channel.fifoData[(size_t)(start + i)];
+				channel.historyPosition = (channel.historyPosition + 1) % FFT_SIZE;
+			}
+		};
+
+		append(start1, size1);
+		append(start2, size2);
+
+		channel.fifo.finishedRead(size1 + size2);
+	}
+
+	void analyse(Channel& channel)
+	{
+		// Unwrap the history, oldest sample first
+		const int tail = FFT_SIZE - channel.historyPosition;
+		std::copy(channel.history.begin() + channel.historyPosition, channel.history.end(), channel.fftData.begin());
+		std::copy(channel.history.begin(), channel.history.begin() + channel.historyPosition, channel.fftData.begin() + tail);
+
+		m_window.multiplyWithWindowingTable(channel.fftData.data(), (size_t)FFT_SIZE);
+		m_fft.performFrequencyOnlyForwardTransform(channel.fftData.data());
+
+		// Hann window, coherent gain 0.5
+		const float scale = 4.0f / FFT_SIZE;
+
+		for (int bin = 0; bin < FFT_SIZE / 2; ++bin)
+		{
+			const float level = juce::Decibels::gainToDecibels(channel.fftData[(size_t)bin] * scale, MIN_DECIBELS);
+			float& smoothed = channel.decibels[(size_t)bin];
+
+			smoothed = SMOOTHING * smoothed + (1.0f - SMOOTHING) * level;
+		}
+	}
+
+	//==============================================================================
+	float frequencyToX(float frequency, int width) const
+	{
+		return width * std::log(frequency / MIN_FREQUENCY) / std::log(MAX_FREQUENCY / MIN_FREQUENCY);
+	}
+
+	float decibelsToY(float decibels, int height) const
+	{
+		return juce::jmap(juce::jlimit(MIN_DECIBELS, MAX_DECIBELS, decibels), MIN_DECIBELS, MAX_DECIBELS, (float)height, 0.0f);
+	}
+
+	// Images, paths and the column to bin map only change with the view size
+	void updateSize()
+	{
+		const int width = m_requestedWidth.load();
+		const int height = m_requestedHeight.load();
+		const double sampleRate = m_sampleRate.load();
+
+		if (width == m_width && height == m_height && sampleRate == m_columnSampleRate)
+		{
+			return;
+		}
+
+		{
+			const juce::SpinLock::ScopedLockType lock(m_imageLock);
+			m_images[0] = juce::Image(juce::Image::ARGB, width, height, true, juce::SoftwareImageType());
+			m_images[1] = juce::Image(juce::Image::ARGB, width, height, true, juce::SoftwareImageType());
+		}
+
+		m_width = width;
+		m_height = height;
+		m_columnSampleRate = sampleRate;
+
+		// Bins covered by every column, at least one
+		m_columnBins.resize((size_t)width + 1);
+
+		for (int x = 0; x <= width; ++x)
+		{
+			const float frequency = MIN_FREQUENCY * std::pow(MAX_FREQUENCY / MIN_FREQUENCY, (float)x / width);
+			m_columnBins[(size_t)x] = juce::jlimit(0, FFT_SIZE / 2 - 1, (int)(frequency * FFT_SIZE / sampleRate));
+		}
+
+		for (auto* channel : { &m_input, &m_output })
+		{
+			channel->columns.resize((size_t)width);
+			channel->path.preallocateSpace(width * 3 + 16);
+		}
+	}
+
+	void buildColumns(Channel& channel)
+	{
+		for (int x = 0; x < m_width; ++x)
+		{
+			const int first = m_columnBins[(size_t)x];
+			const int last = juce::jmax(first, m_columnBins[(size_t)x + 1] - 1);
+			float level = MIN_DECIBELS;
+
+			for (int bin = first; bin <= last; ++bin)
+				level = juce::jmax(level, channel.decibels[(size_t)bin]);
+
+			channel.columns[(size_t)x] = level;
+		}
+
+		channel.path.clear();
+		channel.path.startNewSubPath(0.0f, (float)m_height);
+
+		for (int x = 0; x < m_width; ++x)
+			channel.path.lineTo((float)x, decibelsToY(channel.columns[(size_t)x], m_height));
+
+		channel.path.lineTo((float)m_width, (float)m_height);
+		channel.path.closeSubPath();
+	}
+
+	void render()
+	{
+		updateSize();
+
+		buildColumns(m_input);
+		buildColumns(m_output);
+
+		const int backImage = 1 - m_frontImage;
+		juce::Image& image = m_images[backImage];
+		image.clear(image.getBounds());
+
+		{
+			juce::Graphics g(image);
+
+			// Input filled, output outlined
+			g.setColour(juce::Colours::white.withAlpha(0.25f));
+			g.fillPath(m_input.path);
+
+			// Generated harmonics, wherever the output rises above the input
+			g.setColour(juce::Colours::orange.withAlpha(0.8f));
+
+			for (int x = 0; x < m_width; ++x)
+			{
+				const float input = m_input.columns[(size_t)x];
+				const float output = m_output.columns[(size_t)x];
+
+				if (output > input + HARMONIC_THRESHOLD_DECIBELS)
+					g.drawVerticalLine(x, decibelsToY(output, m_height), decibelsToY(input, m_height));
+			}
+
+			g.setColour(juce::Colours::white);
+			g.strokePath(m_output.path, juce::PathStrokeType(1.0f));
+
+			// Fundamental and its harmonics
+			const float fundamental = m_fundamental.load();
+
+			for (int harmonic = 1; harmonic <= N_HARMONICS; ++harmonic)
+			{
+				const float frequency = fundamental * harmonic;
+
+				if (frequency < MIN_FREQUENCY || frequency > MAX_FREQUENCY)
+					continue;
+
+				g.setColour(juce::Colours::yellow.withAlpha(harmonic == 1 ? 0.8f : 0.3f));
+				g.drawVerticalLine((int)frequencyToX(frequency, m_width), 0.0f, (float)m_height);
+			}
+		}
+
+		{
+			const juce::SpinLock::ScopedLockType lock(m_imageLock);
+			m_frontImage = backImage;
+		}
+
+		m_frameCount++;
+	}
+
+	//==============================================================================
+	std::atomic<bool> m_active { false };
+	std::atomic<bool> m_discardPending { true };
+	std::atomic<double> m_sampleRate { 48000.0 };
+	std::atomic<float> m_fundamental { 0.0f };
+	std::atomic<int> m_requestedWidth { 1 };
+	std::atomic<int> m_requestedHeight { 1 };
+	std::atomic<int> m_frameCount { 0 };
+
+	Channel m_input;
+	Channel m_output;
+
+	juce::dsp::FFT m_fft { FFT_ORDER };
+	juce::dsp::WindowingFunction<float> m_window { (size_t)FFT_SIZE, juce::dsp::WindowingFunction<float>::hann, false };
+
+	int m_width = 0;
+	int m_height = 0;
+	double m_columnSampleRate = 0.0;
+	std::vector<int> m_columnBins;
+	double m_lastFrameTime = 0.0;
+
+	// Double buffered, the editor draws the front image while the back one is rendered
+	juce::Image m_images[2];
+	int m_frontImage = 0;
+	juce::SpinLock m_imageLock;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrumAnalyzer)
+};
+
+//==============================================================================
+// One analysis thread for every open editor in the process
+class SpectrumAnalyzerThread : public juce::TimeSliceThread
+{
+public:
+	SpectrumAnalyzerThread()
+		: juce::TimeSliceThread("Spectrum Analyzer")
+	{
+		startThread();
+	}
+
+	~SpectrumAnalyzerThread() override
+	{
+		stopThread(1000);
+	}
+};
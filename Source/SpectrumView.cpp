@@ -0,0 +1,101 @@
+/*
+  ==============================================================================
+
+    Editor view of the input / output spectrum.
+
+  ==============================================================================
+*/
+
+#include "SpectrumView.h"
+
+//==============================================================================
+SpectrumView::SpectrumView(SpectrumAnalyzer& analyzer, const FundamentalTracker& tracker, juce::AudioProcessorValueTreeState& vts)
+	: m_analyzer(analyzer), m_tracker(tracker)
+{
+	m_frequencyParameter = vts.getRawParameterValue("Frequency");
+	m_trackingParameter = vts.getRawParameterValue("Tracking");
+
+	m_analyzer.setActive(true);
+	m_thread->addTimeSliceClient(&m_analyzer);
+
+	setOpaque(true);
+	startTimerHz(SpectrumAnalyzer::MAX_FRAME_RATE);
+}
+
+SpectrumView::~SpectrumView()
+{
+	// Waits for a running slice to finish
+	m_thread->removeTimeSliceClient(&m_analyzer);
+	m_analyzer.setActive(false);
+}
+
+void SpectrumView::timerCallback()
+{
+	// Markers follow the tracked fundamental while there is one
+	const float tracked = m_trackingParameter != nullptr && m_trackingParameter->load() > 0.5f ? m_tracker.getFrequency() : 0.0f;
+
+	if (tracked > 0.0f)
+		m_analyzer.setFundamental(tracked);
+	else if (m_frequencyParameter != nullptr)
+		m_analyzer.setFundamental(m_frequencyParameter->load());
+
+	// Repaint only when the analysis thread has a new frame
+	const int frame = m_analyzer.getFrameCount();
+
+	if (frame != m_lastFrame)
+	{
+		m_lastFrame = frame;
+		repaint();
+	}
+}
+
+//==============================================================================
+void SpectrumView::paint(juce::Graphics& g)
+{
+	g.drawImageAt(m_background, 0, 0);
+	m_analyzer.drawFrame(g, getLocalBounds().toFloat());
+}
+
+void SpectrumView::resized()
+{
+	m_analyzer.setImageSize(getWidth(), getHeight());
+	renderBackground();
+}
+
+void SpectrumView::renderBackground()
+{
+	const int width = juce::jmax(1, getWidth());
+	const int height = juce::jmax(1, getHeight());
+
+	m_background = juce::Image(juce::Image::RGB, width, height, true);
+	juce::Graphics g(m_background);
+
+	g.fillAll(juce::Colours::black);
+	g.setFont(11.0f);
+
+	const float logRange = std::log(SpectrumAnalyzer::MAX_FREQUENCY / SpectrumAnalyzer::MIN_FREQUENCY);
+	const float frequencies[] = { 50.0f, 100.0f, 200.0f, 500.0f, 1000.0f, 2000.0f, 5000.0f, 10000.0f };
+
+	for (float frequency : frequencies)
+	{
+		const int x = (int)(width * std::log(frequency / SpectrumAnalyzer::MIN_FREQUENCY) / logRange);
+
+		g.setColour(juce::Colours::white.withAlpha(0.15f));
+		g.drawVerticalLine(x, 0.0f, (float)height);
+
+		g.setColour(juce::Colours::white.withAlpha(0.5f));
+		g.drawText(frequency < 1000.0f ? juce::String((int)frequency) : juce::String((int)(frequency / 1000.0f)) + "k",
+		           x + 2, height - 14, 40, 14, juce::Justification::centredLeft);
+	}
+
+	for (float decibels = 0.0f; decibels > SpectrumAnalyzer::MIN_DECIBELS; decibels -= 24.0f)
+	{
+		const int y = (int)juce::jmap(decibels, SpectrumAnalyzer::MIN_DECIBELS, SpectrumAnalyzer::MAX_DECIBELS, (float)height, 0.0f);
+
+		g.setColour(juce::Colours::white.withAlpha(0.15f));
+		g.drawHorizontalLine(y, 0.0f, (float)width);
+
+		g.setColour(juce::Colours::white.withAlpha(0.5f));
+		g.drawText(juce::String((int)decibels) + " dB", 2, y, 50, 14, juce::Justification::centredLeft);
+	}
+}
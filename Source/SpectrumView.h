@@ -0,0 +1,41 @@
+/*
+  ==============================================================================
+
+    Editor view of the input / output spectrum.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SpectrumAnalyzer.h"
+#include "FundamentalTracker.h"
+
+//==============================================================================
+class SpectrumView : public juce::Component, private juce::Timer
+{
+public:
+	SpectrumView(SpectrumAnalyzer& analyzer, const FundamentalTracker& tracker, juce::AudioProcessorValueTreeState& vts);
+	~SpectrumView() override;
+
+	void paint(juce::Graphics&) override;
+	void resized() override;
+
+private:
+	void timerCallback() override;
+	void renderBackground();
+
+	SpectrumAnalyzer& m_analyzer;
+	const FundamentalTracker& m_tracker;
+	std::atomic<float>* m_frequencyParameter = nullptr;
+	std::atomic<float>* m_trackingParameter = nullptr;
+
+	juce::SharedResourcePointer<SpectrumAnalyzerThread> m_thread;
+
+	// Grid and labels, redrawn only on resize
+	juce::Image m_background;
+	int m_lastFrame = -1;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrumView)
+};
@@ -0,0 +1,141 @@
+/*
+  ==============================================================================
+
+    Editor overlay showing the processBlock telemetry.
+
+  ==============================================================================
+*/
+
+#include "TelemetryOverlay.h"
+#include "PluginProcessor.h"
+
+//==============================================================================
+TelemetryOverlay::TelemetryOverlay(PerformanceTelemetry& telemetry)
+	: m_telemetry(telemetry)
+{
+	addAndMakeVisible(m_clearButton);
+	addAndMakeVisible(m_dumpButton);
+
+	m_clearButton.onClick = [this] { m_telemetry.clear(); };
+	m_dumpButton.onClick = [this] { dump(); };
+
+	setVisible(false);
+}
+
+TelemetryOverlay::~TelemetryOverlay()
+{
+	// Stop collecting once nobody looks
+	m_telemetry.setEnabled(false);
+}
+
+void TelemetryOverlay::setActive(bool shouldBeActive)
+{
+	m_telemetry.setEnabled(shouldBeActive);
+	setVisible(shouldBeActive);
+
+	if (shouldBeActive)
+	{
+		startTimerHz(REFRESH_RATE_HZ);
+	}
+	else
+	{
+		stopTimer();
+	}
+}
+
+void TelemetryOverlay::timerCallback()
+{
+	m_statistics = m_telemetry.getStatistics();
+	repaint();
+}
+
+void TelemetryOverlay::dump()
+{
+	m_fileChooser = std::make_unique<juce::FileChooser>("Save telemetry",
+	                                                    juce::File::getSpecialLocation(juce::File::userDocumentsDirectory).getChildFile("BassEnhancerTelemetry.csv"),
+	                                                    "*.csv");
+
+	m_fileChooser->launchAsync(juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles | juce::FileBrowserComponent::warnAboutOverwriting, [this] (const juce::FileChooser& chooser)
+	{
+		const juce::File file = chooser.getResult();
+
+		if (file != juce::File())
+			m_telemetry.dumpToFile(file);
+	});
+}
+
+//==============================================================================
+void TelemetryOverlay::paint(juce::Graphics& g)
+{
+	static const char* const modeNames[N_DISTORTION_MODES] = { "A", "B", "C", "D", "E" };
+
+	g.fillAll(juce::Colours::black.withAlpha(0.8f));
+
+	const auto& statistics = m_statistics;
+	auto area = getLocalBounds().reduced(MARGIN);
+	auto text = area.removeFromLeft(area.getWidth() / 2);
+
+	// Summary
+	juce::StringArray lines;
+	lines.add("Blocks: " + juce::String(statistics.blocks) + " (" + juce::String(statistics.skippedBlocks) + " silent)");
+	lines.add("Block size: " + juce::String(statistics.minBlockSize) + " - " + juce::String(statistics.maxBlockSize)
+	          + ", oversampling " + BassEnhancerAudioProcessor::oversamplingNames[statistics.oversamplingIndex]
+	          + ", " + CpuDispatch::getName(statistics.instructionSet));
+	lines.add("Load p50 / p99 / max: " + juce::String(statistics.load.getPercentile(0.5), 0) + " / "
+	          + juce::String(statistics.load.getPercentile(0.99), 0) + " / " + juce::String(statistics.load.getMax(), 1) + " %");
+	lines.add("Deadline misses: " + juce::String(statistics.deadlineMisses));
+	lines.add("Cycles/sample p50 / p99: " + juce::String(statistics.cyclesPerSample.getPercentile(0.5), 0) + " / "
+	          + juce::String(statistics.cyclesPerSample.getPercentile(0.99), 0));
+	lines.add("Coefficient updates/block: " + juce::String(statistics.blocks > 0 ? (double)statistics.coefficientUpdates / statistics.blocks : 0.0, 2));
+
+	for (int mode = 0; mode < N_DISTORTION_MODES; ++mode)
+	{
+		if (statistics.modeBlocks[mode] == 0)
+			continue;
+
+		lines.add("Mode " + juce::String(modeNames[mode]) + ": " + juce::String(statistics.modeBlocks[mode]) + " blocks, "
+		          + juce::String(statistics.modeCycles[mode] / juce::jmax((juce::int64)1, statistics.modeSamples[mode]), 1) + " cycles/sample");
+	}
+
+	if (statistics.droppedRecords > 0)
+		lines.add("Dropped records: " + juce::String(statistics.droppedRecords));
+
+	g.setColour(juce::Colours::white);
+	g.setFont((float)LINE_HEIGHT * 0.8f);
+
+	for (const auto& line : lines)
+		g.drawText(line, text.removeFromTop(LINE_HEIGHT), juce::Justification::centredLeft);
+
+	// Load histogram, 0 to 200 % of the block duration
+	area.removeFromBottom(m_dumpButton.getHeight() + MARGIN);
+	const auto& load = statistics.load;
+	juce::int64 maxCount = 1;
+
+	for (int bin = 0; bin <= load.getNumBins(); ++bin)
+		maxCount = juce::jmax(maxCount, load.getCount(bin));
+
+	const float binWidth = (float)area.getWidth() / (load.getNumBins() + 1);
+
+	for (int bin = 0; bin <= load.getNumBins(); ++bin)
+	{
+		const float height = area.getHeight() * (float)load.getCount(bin) / (float)maxCount;
+		const bool late = bin * load.getBinWidth() >= 100.0;
+
+		g.setColour(late ? juce::Colours::red : juce::Colours::lightgrey);
+		g.fillRect(area.getX() + bin * binWidth, area.getBottom() - height, juce::jmax(1.0f, binWidth), height);
+	}
+
+	// Deadline
+	g.setColour(juce::Colours::orange);
+	g.drawVerticalLine(area.getX() + (int)(100.0 / load.getBinWidth() * binWidth), (float)area.getY(), (float)area.getBottom());
+	g.drawText("Load histogram, deadline at 100 %", area.removeFromTop(LINE_HEIGHT), juce::Justification::centredRight);
+}
+
+void TelemetryOverlay::resized()
+{
+	auto area = getLocalBounds().reduced(MARGIN);
+	auto buttons = area.removeFromBottom(LINE_HEIGHT + MARGIN).removeFromRight(LINE_HEIGHT * 8);
+
+	m_dumpButton.setBounds(buttons.removeFromRight(buttons.getWidth() / 2).reduced(2, 0));
+	m_clearButton.setBounds(buttons.reduced(2, 0));
+}
@@ -0,0 +1,43 @@
+/*
+  ==============================================================================
+
+    Editor overlay showing the processBlock telemetry.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PerformanceTelemetry.h"
+
+//==============================================================================
+class TelemetryOverlay : public juce::Component, private juce::Timer
+{
+public:
+	static const int REFRESH_RATE_HZ = 10;
+	static const int MARGIN = 8;
+	static const int LINE_HEIGHT = 16;
+
+	explicit TelemetryOverlay(PerformanceTelemetry& telemetry);
+	~TelemetryOverlay() override;
+
+	// Shows the overlay and turns the telemetry on, or hides it and turns it off
+	void setActive(bool shouldBeActive);
+
+	void paint(juce::Graphics&) override;
+	void resized() override;
+
+private:
+	void timerCallback() override;
+	void dump();
+
+	PerformanceTelemetry& m_telemetry;
+	PerformanceTelemetry::Statistics m_statistics;
+
+	juce::TextButton m_clearButton { "Clear" };
+	juce::TextButton m_dumpButton { "Dump" };
+	std::unique_ptr<juce::FileChooser> m_fileChooser;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TelemetryOverlay)
+};
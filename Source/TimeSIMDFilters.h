@@ -0,0 +1,299 @@
+/*
+  ==============================================================================
+
+    Filters vectorized along time, for single channel processing.
+
+    The filters in SIMDFilters.h fill the lanes with channels, a mono track
+    leaves all but one of them idle. These fill the lanes with successive
+    samples of one channel instead. Each filter is a linear recursion
+    s[n + 1] = A s[n] + B x[n], y[n] = C s[n] + D x[n], so one register of
+    N samples follows from the state at its start:
+
+        y = O s + T x        s' = A^N s + G x
+
+    O holds the rows C A^k, T is the lower triangular Toeplitz matrix of the
+    impulse response and G the columns A^(N - 1 - k) B. They are measured by
+    running the scalar recursion in double from every unit state and from a
+    unit impulse, so they hold whatever the recursion does, the ladder's
+    feedback around its four stages included. A register then costs a few
+    independent multiply-adds instead of N dependent recursion steps.
+
+    Registers stay aligned to the stream. The last one of a block is only
+    previewed, its valid lanes are final but the state does not advance
+    until the next block completes it, so the output does not depend on
+    how the host splits the stream into blocks.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "FilterCoefficients.h"
+#include "SIMDFilters.h"
+
+//==============================================================================
+template <typename SampleType, int N_STATES>
+class TimeSIMDStateSpace
+{
+public:
+	using SIMDType = SIMDVector<SampleType>;
+
+	static const int LANES = (int)SIMDType::SIMDNumElements;
+	static const int STATE_REGISTERS = (N_STATES + LANES - 1) / LANES;
+
+	// step(state, in) advances a double precision copy of the recursion by
+	// one sample and returns its output. The state is kept.
+	template <typename Step>
+	void design(Step&& step)
+	{
+		double state[N_STATES] = {};
+		SampleType column[STATE_REGISTERS * LANES] = {};
+		SampleType output[LANES] = {};
+
+		// Zero input response of every state, and where it is a register later
+		for (int j = 0; j < N_STATES; ++j)
+		{
+			std::fill(state, state + N_STATES, 0.0);
+			state[j] = 1.0;
+
+			for (int k = 0; k < LANES; ++k)
+				output[k] = (SampleType)step(state, 0.0);
+
+			for (int i = 0; i < N_STATES; ++i)
+				column[i] = (SampleType)state[i];
+
+			m_outputFromState[j] = SIMDHelpers::load(output);
+
+			for (int r = 0; r < STATE_REGISTERS; ++r)
+				m_advanceFromState[j][r] = SIMDHelpers::load(column + r * LANES);
+		}
+
+		// Impulse response, the state k samples after the impulse is A^k B
+		double impulse[LANES] = {};
+		double impulseStates[LANES][N_STATES] = {};
+		std::fill(state, state + N_STATES, 0.0);
+
+		for (int k = 0; k < LANES; ++k)
+		{
+			impulse[k] = step(state, k == 0 ? 1.0 : 0.0);
+			std::copy(state, state + N_STATES, impulseStates[k]);
+		}
+
+		// Input i is LANES - 1 - i samples old at the end of the register
+		for (int i = 0; i < LANES; ++i)
+		{
+			for (int k = 0; k < LANES; ++k)
+				output[k] = k >= i ? (SampleType)impulse[k - i] : SampleType(0);
+
+			for (int m = 0; m < N_STATES; ++m)
+				column[m] = (SampleType)impulseStates[LANES - 1 - i][m];
+
+			m_outputFromInput[i] = SIMDHelpers::load(output);
+
+			for (int r = 0; r < STATE_REGISTERS; ++r)
+				m_advanceFromInput[i][r] = SIMDHelpers::load(column + r * LANES);
+		}
+	}
+
+	void reset()
+	{
+		for (auto& state : m_state)
+			state = SIMDType::expand(0);
+	}
+
+	// Without advance the state stays where it is. The outputs are computed the
+	// same way either way, lane k only reads the inputs up to k.
+	SIMDType process(SIMDType in, bool advance)
+	{
+		SIMDType states[N_STATES];
+		SIMDType samples[LANES];
+
+		for (int j = 0; j < N_STATES; ++j)
+			states[j] = SIMDType::expand(m_state[j / LANES].get((size_t)(j % LANES)));
+
+		for (int i = 0; i < LANES; ++i)
+			samples[i] = SIMDType::expand(in.get((size_t)i));
+
+		SIMDType out = SIMDType::expand(0);
+
+		for (int j = 0; j < N_STATES; ++j)
+			out = out + m_outputFromState[j] * states[j];
+
+		for (int i = 0; i < LANES; ++i)
+			out = out + m_outputFromInput[i] * samples[i];
+
+		if (advance)
+		{
+			for (int r = 0; r < STATE_REGISTERS; ++r)
+			{
+				SIMDType next = SIMDType::expand(0);
+
+				for (int j = 0; j < N_STATES; ++j)
+					next = next + m_advanceFromState[j][r] * states[j];
+
+				for (int i = 0; i < LANES; ++i)
+					next = next + m_advanceFromInput[i][r] * samples[i];
+
+				m_state[r] = next;
+			}
+		}
+
+		return out;
+	}
+
+private:
+	SIMDType m_outputFromState[N_STATES];
+	SIMDType m_outputFromInput[LANES];
+	SIMDType m_advanceFromState[N_STATES][STATE_REGISTERS];
+	SIMDType m_advanceFromInput[LANES][STATE_REGISTERS];
+
+	SIMDType m_state[STATE_REGISTERS];
+};
+
+//==============================================================================
+// Common interface of the filters below. The matrices are rebuilt on every
+// coefficient change, from the coefficients rounded to SampleType, so the
+// block recursion is the one the SIMD filters run.
+template <typename SampleType, int N_STATES>
+class TimeSIMDFilter
+{
+public:
+	using SIMDType = SIMDVector<SampleType>;
+	using StateSpace = TimeSIMDStateSpace<SampleType, N_STATES>;
+
+	static const int LANES = StateSpace::LANES;
+
+	TimeSIMDFilter() { m_stateSpace.reset(); }
+
+	void init(int sampleRate) { m_sampleRate = sampleRate; }
+	void reset() { m_stateSpace.reset(); }
+
+	// Set around a register that is only partly filled, at the end of a block
+	void setPreview(bool preview) { m_preview = preview; }
+
+	SIMDType process(SIMDType in)
+	{
+		return m_stateSpace.process(in, !m_preview);
+	}
+
+protected:
+	StateSpace m_stateSpace;
+	int m_sampleRate = 48000;
+	bool m_preview = false;
+};
+
+//==============================================================================
+template <typename SampleType>
+class LowPassFilter12dBTimeSIMD : public TimeSIMDFilter<SampleType, 2>
+{
+public:
+	LowPassFilter12dBTimeSIMD() { setCoef(LowPassCoefficients<double>()); }
+
+	void setCoef(SampleType frequency)
+	{
+		setCoef(FilterDesign::lowPass(frequency, (SampleType)this->m_sampleRate));
+	}
+	template <typename CoefficientType>
+	void setCoef(const LowPassCoefficients<CoefficientType>& coefficients)
+	{
+		const double c = (double)(SampleType)coefficients.inCoef;
+		const double d = (double)(SampleType)coefficients.outLastCoef;
+
+		// State: both stage outputs
+		this->m_stateSpace.design([c, d] (double* state, double in)
+		{
+			state[0] = c * in + d * state[0];
+			state[1] = c * state[0] + d * state[1];
+			return state[1];
+		});
+	}
+};
+
+//==============================================================================
+template <typename SampleType>
+class SecondOrderAllPassTimeSIMD : public TimeSIMDFilter<SampleType, 4>
+{
+public:
+	SecondOrderAllPassTimeSIMD() { setCoef(AllPassCoefficients<double>()); }
+
+	void setCoef(SampleType frequency, SampleType Q)
+	{
+		setCoef(FilterDesign::allPass(frequency, Q, (SampleType)this->m_sampleRate));
+	}
+	template <typename CoefficientType>
+	void setCoef(const AllPassCoefficients<CoefficientType>& coefficients)
+	{
+		const double a1 = (double)(SampleType)coefficients.a1;
+		const double a2 = (double)(SampleType)coefficients.a2;
+
+		// State: x1, x2, y1, y2 of the direct form I
+		this->m_stateSpace.design([a1, a2] (double* state, double in)
+		{
+			const double y = a2 * in + a1 * state[0] + state[1] - a1 * state[2] - a2 * state[3];
+
+			state[1] = state[0];
+			state[0] = in;
+			state[3] = state[2];
+			state[2] = y;
+
+			return y;
+		});
+	}
+};
+
+//==============================================================================
+template <typename SampleType>
+class LadderFilterTimeSIMD : public TimeSIMDFilter<SampleType, 5>
+{
+public:
+	LadderFilterTimeSIMD() { redesign(); }
+
+	void setCoef(SampleType frequency)
+	{
+		setCoef(FilterDesign::lowPass(frequency, (SampleType)this->m_sampleRate));
+	}
+	template <typename CoefficientType>
+	void setCoef(const LowPassCoefficients<CoefficientType>& coefficients)
+	{
+		m_inCoef = (double)(SampleType)coefficients.inCoef;
+		m_outLastCoef = (double)(SampleType)coefficients.outLastCoef;
+		redesign();
+	}
+	void setResonance(SampleType resonance)
+	{
+		m_resonance = (double)resonance;
+		redesign();
+	}
+
+private:
+	double m_inCoef = 1.0;
+	double m_outLastCoef = 0.0;
+	double m_resonance = 0.0;
+
+	// State: previous input of the first stage, then the four stage outputs.
+	// Each later stage's previous input is the previous output before it.
+	void redesign()
+	{
+		const double c = m_inCoef;
+		const double d = m_outLastCoef;
+		const double r = m_resonance;
+
+		this->m_stateSpace.design([c, d, r] (double* state, double in)
+		{
+			const double input = in - r * state[4];
+			const double y1 = c * (input + state[0]) + d * state[1];
+			const double y2 = c * (y1 + state[1]) + d * state[2];
+			const double y3 = c * (y2 + state[2]) + d * state[3];
+			const double y4 = c * (y3 + state[3]) + d * state[4];
+
+			state[0] = input;
+			state[1] = y1;
+			state[2] = y2;
+			state[3] = y3;
+			state[4] = y4;
+
+			return y4;
+		});
+	}
+};
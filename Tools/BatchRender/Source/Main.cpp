@@ -0,0 +1,214 @@
+/*
+  ==============================================================================
+
+    Headless batch renderer.
+
+    Streams WAV/AIFF files through BassEnhancerAudioProcessor without an
+    editor or a host, one file per worker thread at a time. With --chunked
+    each file is split into chunks that are rendered on all threads instead.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "Render.h"
+
+//==============================================================================
+static void printUsage()
+{
+	std::cout << "Usage: BassEnhancerBatchRender [options] <input files or folders...>\n"
+	          << "\n"
+	          << "  --output <folder>      Folder for the rendered files (required)\n"
+	          << "  --preset <file>        Plugin state as saved by a host, or parameter state XML\n"
+	          << "  --set <id>=<value>     Set a parameter in its own units, e.g. --set Frequency=80\n"
+	          << "                         Choices take their index, buttons 0 or 1. Applied after --preset\n"
+	          << "  --block-size <n>       Samples per processBlock call (default 4096)\n"
+	          << "  --threads <n>          Worker threads (default: number of CPUs)\n"
+	          << "  --chunked              Render each file in parallel chunks, for few long files\n"
+	          << "  --chunk-seconds <s>    Chunk length (default 30)\n"
+	          << "  --warmup-seconds <s>   Input rendered and discarded before each chunk (default 2)\n"
+	          << "  --validate             Also render serially and report the max deviation\n";
+}
+
+//==============================================================================
+// Each worker owns one processor and pulls files until the list is exhausted
+class RenderWorker : public juce::ThreadPoolJob
+{
+public:
+	RenderWorker(std::unique_ptr<BassEnhancerAudioProcessor> processor, const juce::Array<juce::File>& files, std::atomic<int>& nextFile,
+	             const RenderSettings& settings, std::vector<RenderResult>& results)
+		: juce::ThreadPoolJob("RenderWorker"), m_processor(std::move(processor)), m_files(files), m_nextFile(nextFile), m_settings(settings), m_results(results)
+	{
+		m_formatManager.registerBasicFormats();
+	}
+
+	JobStatus runJob() override
+	{
+		for (int index = m_nextFile++; index < m_files.size() && !shouldExit(); index = m_nextFile++)
+			m_results[(size_t)index] = renderFile(*m_processor, m_formatManager, m_files[index], m_settings);
+
+		return jobHasFinished;
+	}
+
+private:
+	std::unique_ptr<BassEnhancerAudioProcessor> m_processor;
+	juce::AudioFormatManager m_formatManager;
+
+	const juce::Array<juce::File>& m_files;
+	std::atomic<int>& m_nextFile;
+	const RenderSettings& m_settings;
+	std::vector<RenderResult>& m_results;
+};
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+	juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+	RenderSettings settings;
+	juce::Array<juce::File> files;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const juce::String argument(argv[i]);
+		const juce::String value = (i + 1 < argc) ? juce::String(argv[i + 1]) : juce::String();
+
+		if (argument == "--help" || argument == "-h")
+		{
+			printUsage();
+			return 0;
+		}
+		else if (argument == "--output")
+		{
+			settings.outputFolder = juce::File::getCurrentWorkingDirectory().getChildFile(value);
+			++i;
+		}
+		else if (argument == "--preset")
+		{
+			settings.presetFile = juce::File::getCurrentWorkingDirectory().getChildFile(value);
+			++i;
+		}
+		else if (argument == "--set")
+		{
+			settings.parameterValues.set(value.upToFirstOccurrenceOf("=", false, false), value.fromFirstOccurrenceOf("=", false, false));
+			++i;
+		}
+		else if (argument == "--block-size")
+		{
+			settings.blockSize = juce::jmax(1, value.getIntValue());
+			++i;
+		}
+		else if (argument == "--threads")
+		{
+			settings.threads = juce::jmax(1, value.getIntValue());
+			++i;
+		}
+		else if (argument == "--chunked")
+		{
+			settings.chunked = true;
+		}
+		else if (argument == "--chunk-seconds")
+		{
+			settings.chunkSeconds = juce::jmax(0.1, value.getDoubleValue());
+			++i;
+		}
+		else if (argument == "--warmup-seconds")
+		{
+			settings.warmUpSeconds = juce::jmax(0.0, value.getDoubleValue());
+			++i;
+		}
+		else if (argument == "--validate")
+		{
+			settings.chunked = true;
+			settings.validate = true;
+		}
+		else
+		{
+			const juce::File file = juce::File::getCurrentWorkingDirectory().getChildFile(argument);
+
+			if (file.isDirectory())
+				files.addArray(file.findChildFiles(juce::File::findFiles, false, "*.wav;*.aif;*.aiff"));
+			else
+				files.add(file);
+		}
+	}
+
+	if (files.isEmpty() || settings.outputFolder == juce::File())
+	{
+		printUsage();
+		return 1;
+	}
+
+	settings.outputFolder.createDirectory();
+
+	std::vector<RenderResult> results((size_t)files.size());
+	int threads = settings.threads;
+
+	const double startTime = juce::Time::getMillisecondCounterHiRes();
+
+	if (settings.chunked)
+	{
+		// One file at a time, each spread over all threads
+		for (int i = 0; i < files.size(); ++i)
+			results[(size_t)i] = renderFileChunked(files[i], settings);
+	}
+	else
+	{
+		// Processors are created and configured here, on the message thread
+		threads = juce::jmin(settings.threads, files.size());
+		std::atomic<int> nextFile { 0 };
+
+		juce::OwnedArray<RenderWorker> workers;
+		juce::ThreadPool pool(threads);
+
+		for (int i = 0; i < threads; ++i)
+		{
+			auto processor = std::make_unique<BassEnhancerAudioProcessor>();
+			juce::String error;
+
+			if (!applySettings(*processor, settings, error))
+			{
+				std::cerr << error << std::endl;
+				return 1;
+			}
+
+			workers.add(new RenderWorker(std::move(processor), files, nextFile, settings, results));
+		}
+
+		for (auto* worker : workers)
+			pool.addJob(worker, false);
+
+		for (auto* worker : workers)
+			pool.waitForJobToFinish(worker, -1);
+	}
+
+	const double wallSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+
+	// Report
+	double audioSeconds = 0.0;
+	int failed = 0;
+
+	for (const auto& result : results)
+	{
+		if (result.error.isNotEmpty())
+		{
+			std::cerr << result.name << ": " << result.error << std::endl;
+			++failed;
+			continue;
+		}
+
+		audioSeconds += result.audioSeconds;
+		std::cout << result.name << ": " << result.audioSeconds << " s in " << result.renderSeconds << " s ("
+		          << result.audioSeconds / juce::jmax(result.renderSeconds, 1e-9) << "x realtime)" << std::endl;
+
+		if (result.maxDeviation >= 0.0)
+			std::cout << "  max deviation from serial render: " << result.maxDeviation << " ("
+			          << juce::Decibels::gainToDecibels(result.maxDeviation) << " dBFS)" << std::endl;
+	}
+
+	std::cout << "\n" << (files.size() - failed) << " files, " << audioSeconds << " s of audio in " << wallSeconds << " s on "
+	          << threads << " threads: " << audioSeconds / juce::jmax(wallSeconds, 1e-9) << "x realtime" << std::endl;
+
+	return failed == 0 ? 0 : 1;
+}
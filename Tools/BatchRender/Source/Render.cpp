@@ -0,0 +1,435 @@
+/*
+  ==============================================================================
+
+    Offline rendering of audio files through BassEnhancerAudioProcessor.
+
+  ==============================================================================
+*/
+
+#include "Render.h"
+#include <map>
+
+//==============================================================================
+AlignedRenderer::AlignedRenderer(BassEnhancerAudioProcessor& processor, juce::AudioFormatReader& reader, int blockSize, juce::int64 startSample)
+	: m_processor(processor),
+	  m_reader(reader),
+	  m_buffer((int)reader.numChannels, blockSize),
+	  m_inputPosition(startSample),
+	  m_latencyToDiscard(processor.getLatencySamples())
+{
+}
+
+void AlignedRenderer::render(juce::AudioBuffer<float>& destination, int destinationStart, int numSamples)
+{
+	while (numSamples > 0)
+	{
+		if (m_readyCount == 0)
+			processNextBlock();
+
+		const int count = juce::jmin(numSamples, m_readyCount);
+
+		for (int channel = 0; channel < destination.getNumChannels(); ++channel)
+			destination.copyFrom(channel, destinationStart, m_buffer, channel, m_readyStart, count);
+
+		m_readyStart += count;
+		m_readyCount -= count;
+		destinationStart += count;
+		numSamples -= count;
+	}
+}
+
+void AlignedRenderer::skip(juce::int64 numSamples)
+{
+	while (numSamples > 0)
+	{
+		if (m_readyCount == 0)
+			processNextBlock();
+
+		const int count = (int)juce::jmin<juce::int64>(numSamples, m_readyCount);
+
+		m_readyStart += count;
+		m_readyCount -= count;
+		numSamples -= count;
+	}
+}
+
+void AlignedRenderer::processNextBlock()
+{
+	const int blockSize = m_buffer.getNumSamples();
+	const int samplesToRead = (int)juce::jlimit<juce::int64>(0, blockSize, m_reader.lengthInSamples - m_inputPosition);
+
+	// Past the end of the file the processor runs on silence to render the tail
+	m_buffer.clear();
+
+	if (samplesToRead > 0)
+		m_reader.read(m_buffer.getArrayOfWritePointers(), m_buffer.getNumChannels(), m_inputPosition, samplesToRead);
+
+	m_processor.processBlock(m_buffer, m_midiMessages);
+	m_inputPosition += blockSize;
+
+	const int discard = (int)juce::jmin<juce::int64>(m_latencyToDiscard, blockSize);
+	m_latencyToDiscard -= discard;
+
+	m_readyStart = discard;
+	m_readyCount = blockSize - discard;
+}
+
+//==============================================================================
+bool applySettings(BassEnhancerAudioProcessor& processor, const RenderSettings& settings, juce::String& error)
+{
+	if (settings.presetFile != juce::File())
+	{
+		juce::MemoryBlock data;
+		int program = 0;
+		std::vector<CompactState::Entry> entries;
+
+		// Plugin state as saved by the host, or parameter XML
+		if (settings.presetFile.loadFileAsData(data) && CompactState::read(data.getData(), (int)data.getSize(), program, entries))
+		{
+			processor.setStateInformation(data.getData(), (int)data.getSize());
+		}
+		else
+		{
+			std::unique_ptr<juce::XmlElement> xml(juce::parseXML(settings.presetFile));
+
+			if (xml == nullptr || !xml->hasTagName(processor.apvts.state.getType()))
+			{
+				error = "Invalid preset " + settings.presetFile.getFullPathName();
+				return false;
+			}
+
+			processor.apvts.replaceState(juce::ValueTree::fromXml(*xml));
+		}
+	}
+
+	for (const auto& id : settings.parameterValues.getAllKeys())
+	{
+		auto* parameter = processor.apvts.getParameter(id);
+
+		if (parameter == nullptr)
+		{
+			error = "Unknown parameter " + id;
+			return false;
+		}
+
+		const float value = settings.parameterValues[id].getFloatValue();
+		parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+	}
+
+	return true;
+}
+
+std::unique_ptr<juce::AudioFormatReader> createReader(juce::AudioFormatManager& formatManager, const juce::File& file)
+{
+	// Memory map when the format allows it, otherwise stream through a buffered reader
+	if (auto* format = formatManager.findFormatForFileExtension(file.getFileExtension()))
+	{
+		std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped(format->createMemoryMappedReader(file));
+
+		if (mapped != nullptr && mapped->mapEntireFile())
+			return mapped;
+	}
+
+	return std::unique_ptr<juce::AudioFormatReader>(formatManager.createReaderFor(file));
+}
+
+//==============================================================================
+static bool isSupported(const juce::AudioFormatReader* reader, juce::String& error)
+{
+	if (reader == nullptr)
+	{
+		error = "Cannot read file";
+		return false;
+	}
+
+	if (reader->numChannels < 1)
+	{
+		error = "File has no channels";
+		return false;
+	}
+
+	return true;
+}
+
+// Writer in the same format and bit depth as the input
+static std::unique_ptr<juce::AudioFormatWriter> createWriter(juce::AudioFormatManager& formatManager, const juce::File& input, const juce::AudioFormatReader& reader,
+                                                             const RenderSettings& settings, juce::String& error)
+{
+	const juce::File output = settings.outputFolder.getChildFile(input.getFileName());
+	output.deleteFile();
+
+	auto* format = formatManager.findFormatForFileExtension(input.getFileExtension());
+	auto stream = output.createOutputStream();
+
+	if (format == nullptr || stream == nullptr)
+	{
+		error = "Cannot create " + output.getFullPathName();
+		return nullptr;
+	}
+
+	std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(stream.get(), reader.sampleRate, reader.numChannels, (int)reader.bitsPerSample, {}, 0));
+
+	if (writer == nullptr)
+	{
+		error = "Cannot create writer for " + output.getFullPathName();
+		return nullptr;
+	}
+
+	stream.release();
+	return writer;
+}
+
+static void prepareProcessor(BassEnhancerAudioProcessor& processor, const juce::AudioFormatReader& reader, int blockSize)
+{
+	const int channels = (int)reader.numChannels;
+
+	processor.setPlayConfigDetails(channels, channels, reader.sampleRate, blockSize);
+	processor.setNonRealtime(true);
+	processor.prepareToPlay(reader.sampleRate, blockSize);
+}
+
+static juce::int64 getOutputLength(const BassEnhancerAudioProcessor& processor, const juce::AudioFormatReader& reader)
+{
+	return reader.lengthInSamples + (juce::int64)std::ceil(processor.getTailLengthSeconds() * reader.sampleRate);
+}
+
+//==============================================================================
+RenderResult renderFile(BassEnhancerAudioProcessor& processor, juce::AudioFormatManager& formatManager, const juce::File& input, const RenderSettings& settings)
+{
+	RenderResult result;
+	result.name = input.getFileName();
+
+	auto reader = createReader(formatManager, input);
+
+	if (!isSupported(reader.get(), result.error))
+		return result;
+
+	auto writer = createWriter(formatManager, input, *reader, settings, result.error);
+
+	if (writer == nullptr)
+		return result;
+
+	prepareProcessor(processor, *reader, settings.blockSize);
+
+	const juce::int64 outputLength = getOutputLength(processor, *reader);
+
+	AlignedRenderer renderer(processor, *reader, settings.blockSize, 0);
+	juce::AudioBuffer<float> buffer((int)reader->numChannels, settings.blockSize);
+
+	const double startTime = juce::Time::getMillisecondCounterHiRes();
+
+	for (juce::int64 position = 0; position < outputLength; position += settings.blockSize)
+	{
+		const int samples = (int)juce::jmin<juce::int64>(settings.blockSize, outputLength - position);
+
+		renderer.render(buffer, 0, samples);
+		writer->writeFromAudioSampleBuffer(buffer, 0, samples);
+	}
+
+	result.renderSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+	result.audioSeconds = reader->lengthInSamples / reader->sampleRate;
+
+	processor.releaseResources();
+
+	return result;
+}
+
+//==============================================================================
+namespace
+{
+	struct ChunkPlan
+	{
+		juce::int64 outputLength = 0;
+		juce::int64 chunkLength = 0;
+		juce::int64 warmUpLength = 0;
+		int numChunks = 0;
+	};
+
+	// Writes chunks in file order as they arrive, optionally comparing them
+	// against a serial render that advances in lockstep
+	class ChunkCollector
+	{
+	public:
+		ChunkCollector(juce::AudioFormatWriter& writer, AlignedRenderer* reference)
+			: m_writer(writer), m_reference(reference)
+		{
+		}
+
+		void submit(int index, juce::AudioBuffer<float>&& chunk)
+		{
+			const juce::ScopedLock lock(m_lock);
+
+			m_pending[index] = std::move(chunk);
+
+			for (auto it = m_pending.find(m_nextToWrite); it != m_pending.end(); it = m_pending.find(m_nextToWrite))
+			{
+				const auto& buffer = it->second;
+
+				if (m_reference != nullptr)
+					compare(buffer);
+
+				m_writer.writeFromAudioSampleBuffer(buffer, 0, buffer.getNumSamples());
+
+				m_pending.erase(it);
+				++m_nextToWrite;
+			}
+		}
+
+		double getMaxDeviation() const { return m_maxDeviation; }
+
+	private:
+		void compare(const juce::AudioBuffer<float>& chunk)
+		{
+			m_referenceBuffer.setSize(chunk.getNumChannels(), chunk.getNumSamples(), false, false, true);
+			m_reference->render(m_referenceBuffer, 0, chunk.getNumSamples());
+
+			for (int channel = 0; channel < chunk.getNumChannels(); ++channel)
+			{
+				const float* rendered = chunk.getReadPointer(channel);
+				const float* reference = m_referenceBuffer.getReadPointer(channel);
+
+				for (int sample = 0; sample < chunk.getNumSamples(); ++sample)
+					m_maxDeviation = juce::jmax(m_maxDeviation, (double)std::abs(rendered[sample] - reference[sample]));
+			}
+		}
+
+		juce::CriticalSection m_lock;
+		juce::AudioFormatWriter& m_writer;
+		AlignedRenderer* m_reference;
+		juce::AudioBuffer<float> m_referenceBuffer;
+
+		std::map<int, juce::AudioBuffer<float>> m_pending;
+		int m_nextToWrite = 0;
+		double m_maxDeviation = 0.0;
+	};
+
+	class ChunkWorker : public juce::ThreadPoolJob
+	{
+	public:
+		ChunkWorker(std::unique_ptr<BassEnhancerAudioProcessor> processor, std::unique_ptr<juce::AudioFormatReader> reader, const ChunkPlan& plan,
+		            std::atomic<int>& nextChunk, ChunkCollector& collector, int blockSize)
+			: juce::ThreadPoolJob("ChunkWorker"), m_processor(std::move(processor)), m_reader(std::move(reader)), m_plan(plan),
+			  m_nextChunk(nextChunk), m_collector(collector), m_blockSize(blockSize)
+		{
+		}
+
+		JobStatus runJob() override
+		{
+			for (int index = m_nextChunk++; index < m_plan.numChunks && !shouldExit(); index = m_nextChunk++)
+			{
+				const juce::int64 chunkStart = index * m_plan.chunkLength;
+				const juce::int64 warmUpStart = juce::jmax<juce::int64>(0, chunkStart - m_plan.warmUpLength);
+				const int chunkSamples = (int)juce::jmin(m_plan.chunkLength, m_plan.outputLength - chunkStart);
+
+				// Every chunk starts from silent state and converges over the overlap
+				m_processor->prepareToPlay(m_reader->sampleRate, m_blockSize);
+
+				AlignedRenderer renderer(*m_processor, *m_reader, m_blockSize, warmUpStart);
+				renderer.skip(chunkStart - warmUpStart);
+
+				juce::AudioBuffer<float> chunk((int)m_reader->numChannels, chunkSamples);
+				renderer.render(chunk, 0, chunkSamples);
+
+				m_collector.submit(index, std::move(chunk));
+			}
+
+			return jobHasFinished;
+		}
+
+	private:
+		std::unique_ptr<BassEnhancerAudioProcessor> m_processor;
+		std::unique_ptr<juce::AudioFormatReader> m_reader;
+		const ChunkPlan& m_plan;
+		std::atomic<int>& m_nextChunk;
+		ChunkCollector& m_collector;
+		int m_blockSize;
+	};
+}
+
+RenderResult renderFileChunked(const juce::File& input, const RenderSettings& settings)
+{
+	RenderResult result;
+	result.name = input.getFileName();
+
+	juce::AudioFormatManager formatManager;
+	formatManager.registerBasicFormats();
+
+	auto reader = createReader(formatManager, input);
+
+	if (!isSupported(reader.get(), result.error))
+		return result;
+
+	auto writer = createWriter(formatManager, input, *reader, settings, result.error);
+
+	if (writer == nullptr)
+		return result;
+
+	// Processors and readers are created and configured here, on the calling thread
+	auto createProcessor = [&] ()
+	{
+		auto processor = std::make_unique<BassEnhancerAudioProcessor>();
+
+		if (!applySettings(*processor, settings, result.error))
+			return std::unique_ptr<BassEnhancerAudioProcessor>();
+
+		prepareProcessor(*processor, *reader, settings.blockSize);
+		return processor;
+	};
+
+	auto firstProcessor = createProcessor();
+
+	if (firstProcessor == nullptr)
+		return result;
+
+	ChunkPlan plan;
+	plan.outputLength = getOutputLength(*firstProcessor, *reader);
+	plan.chunkLength = juce::jmax<juce::int64>(settings.blockSize, (juce::int64)(settings.chunkSeconds * reader->sampleRate));
+	plan.warmUpLength = (juce::int64)std::ceil(settings.warmUpSeconds * reader->sampleRate);
+	plan.numChunks = (int)((plan.outputLength + plan.chunkLength - 1) / plan.chunkLength);
+
+	// The serial reference shares the main reader, it only runs inside the collector lock
+	std::unique_ptr<BassEnhancerAudioProcessor> referenceProcessor;
+	std::unique_ptr<AlignedRenderer> reference;
+
+	if (settings.validate)
+	{
+		referenceProcessor = createProcessor();
+
+		if (referenceProcessor == nullptr)
+			return result;
+
+		reference = std::make_unique<AlignedRenderer>(*referenceProcessor, *reader, settings.blockSize, 0);
+	}
+
+	ChunkCollector collector(*writer, reference.get());
+	std::atomic<int> nextChunk { 0 };
+
+	const int threads = juce::jmax(1, juce::jmin(settings.threads, plan.numChunks));
+	juce::OwnedArray<ChunkWorker> workers;
+
+	for (int i = 0; i < threads; ++i)
+	{
+		auto processor = (i == 0) ? std::move(firstProcessor) : createProcessor();
+
+		if (processor == nullptr)
+			return result;
+
+		workers.add(new ChunkWorker(std::move(processor), createReader(formatManager, input), plan, nextChunk, collector, settings.blockSize));
+	}
+
+	juce::ThreadPool pool(threads);
+
+	const double startTime = juce::Time::getMillisecondCounterHiRes();
+
+	for (auto* worker : workers)
+		pool.addJob(worker, false);
+
+	for (auto* worker : workers)
+		pool.waitForJobToFinish(worker, -1);
+
+	result.renderSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+	result.audioSeconds = reader->lengthInSamples / reader->sampleRate;
+	result.maxDeviation = settings.validate ? collector.getMaxDeviation() : -1.0;
+
+	return result;
+}
@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+
+    Offline rendering of audio files through BassEnhancerAudioProcessor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+
+//==============================================================================
+struct RenderSettings
+{
+	juce::File outputFolder;
+	juce::File presetFile;
+	juce::StringPairArray parameterValues;
+	int blockSize = 4096;
+	int threads = juce::SystemStats::getNumCpus();
+
+	// Chunk-parallel rendering of single files
+	bool chunked = false;
+	bool validate = false;
+	double chunkSeconds = 30.0;
+
+	// The slowest converging state is the 40 Hz, Q 7 all-pass, which needs
+	// about 0.8 s to decay below float resolution
+	double warmUpSeconds = 2.0;
+};
+
+struct RenderResult
+{
+	juce::String name;
+	juce::String error;
+	double audioSeconds = 0.0;
+	double renderSeconds = 0.0;
+
+	// Max abs difference to a serial render, negative when not validated
+	double maxDeviation = -1.0;
+};
+
+//==============================================================================
+// Feeds input from a reader through a prepared processor and hands out output
+// that is aligned with the input, i.e. with the processor latency removed.
+class AlignedRenderer
+{
+public:
+	AlignedRenderer(BassEnhancerAudioProcessor& processor, juce::AudioFormatReader& reader, int blockSize, juce::int64 startSample);
+
+	void render(juce::AudioBuffer<float>& destination, int destinationStart, int numSamples);
+	void skip(juce::int64 numSamples);
+
+private:
+	void processNextBlock();
+
+	BassEnhancerAudioProcessor& m_processor;
+	juce::AudioFormatReader& m_reader;
+	juce::AudioBuffer<float> m_buffer;
+	juce::MidiBuffer m_midiMessages;
+
+	juce::int64 m_inputPosition = 0;
+	juce::int64 m_latencyToDiscard = 0;
+	int m_readyStart = 0;
+	int m_readyCount = 0;
+};
+
+//==============================================================================
+bool applySettings(BassEnhancerAudioProcessor& processor, const RenderSettings& settings, juce::String& error);
+std::unique_ptr<juce::AudioFormatReader> createReader(juce::AudioFormatManager& formatManager, const juce::File& file);
+
+// Renders one file on the calling thread
+RenderResult renderFile(BassEnhancerAudioProcessor& processor, juce::AudioFormatManager& formatManager, const juce::File& input, const RenderSettings& settings);
+
+// Splits one file into chunks rendered on settings.threads workers, each
+// chunk pre-rolled over settings.warmUpSeconds of preceding input
+RenderResult renderFileChunked(const juce::File& input, const RenderSettings& settings);
@@ -0,0 +1,1075 @@
+/*
+  ==============================================================================
+
+    Micro-benchmarks for the enhancer filters, their coefficient updates and
+    the full processBlock in every distortion mode, in float and in double.
+    ADAA is compared against 2x / 4x oversampling on CPU and on alias level.
+
+    Every case is swept over block sizes, sample rates and channel counts.
+    Timings are the median of several runs and are reported per channel
+    sample (per call for coefficient updates). Cycles come from the time
+    stamp counter, which ticks at the nominal CPU frequency.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <map>
+#include "../../../Source/PluginProcessor.h"
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+//==============================================================================
+struct BenchmarkSettings
+{
+	juce::Array<int> blockSizes { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+	juce::Array<double> sampleRates { 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+	juce::Array<int> channels { 1, 2, 6, 16 };
+	juce::String filter;
+	int oversampling = 0;
+	double minSeconds = 0.02;
+
+	// -1 picks the best the CPU supports, as the plugin does
+	int instructionSet = -1;
+};
+
+struct BenchmarkResult
+{
+	juce::String name;
+	int blockSize = 0;
+	double sampleRate = 0.0;
+	int channels = 0;
+	juce::String unit;
+	double nanoseconds = 0.0;
+	double cycles = 0.0;
+
+	juce::String getKey() const
+	{
+		return name + "/" + juce::String(blockSize) + "/" + juce::String(sampleRate) + "/" + juce::String(channels);
+	}
+};
+
+//==============================================================================
+static const int REPEATS = 7;
+static const float TEST_FREQUENCY = 80.0f;
+
+static volatile float s_sink = 0.0f;
+static void* volatile s_escape = nullptr;
+
+// Keeps the compiler from dropping work whose result is never read
+template <typename Type>
+static void doNotOptimize(Type& value)
+{
+#if JUCE_MSVC
+	s_escape = &value;
+	_ReadWriteBarrier();
+#else
+	asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+static juce::uint64 readCycleCounter()
+{
+#if JUCE_INTEL
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+struct Timing
+{
+	double nanoseconds = 0.0;
+	double cycles = 0.0;
+};
+
+// Median of REPEATS runs, each repeating the work long enough to hide timer resolution
+static Timing measure(const std::function<void()>& work, double minSeconds)
+{
+	using Clock = std::chrono::steady_clock;
+
+	// Warms up caches and branch predictors while calibrating the iteration count
+	int iterations = 1;
+
+	for (;;)
+	{
+		const auto start = Clock::now();
+
+		for (int i = 0; i < iterations; ++i)
+			work();
+
+		const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+		if (elapsed >= minSeconds / REPEATS || iterations >= (1 << 24))
+			break;
+
+		iterations *= 2;
+	}
+
+	std::vector<Timing> runs;
+
+	for (int repeat = 0; repeat < REPEATS; ++repeat)
+	{
+		const juce::uint64 cyclesStart = readCycleCounter();
+		const auto start = Clock::now();
+
+		for (int i = 0; i < iterations; ++i)
+			work();
+
+		const auto end = Clock::now();
+		const juce::uint64 cyclesEnd = readCycleCounter();
+
+		Timing timing;
+		timing.nanoseconds = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+		timing.cycles = (double)(cyclesEnd - cyclesStart) / iterations;
+		runs.push_back(timing);
+	}
+
+	std::sort(runs.begin(), runs.end(), [] (const Timing& a, const Timing& b) { return a.nanoseconds < b.nanoseconds; });
+	return runs[REPEATS / 2];
+}
+
+//==============================================================================
+class BenchmarkRunner
+{
+public:
+	explicit BenchmarkRunner(const BenchmarkSettings& settings)
+		: m_settings(settings)
+	{
+	}
+
+	bool shouldRun(const juce::String& name) const
+	{
+		return m_settings.filter.isEmpty() || name.containsIgnoreCase(m_settings.filter);
+	}
+
+	// work processes units (channel samples or calls) per invocation
+	void run(const juce::String& name, int blockSize, double sampleRate, int channels, const juce::String& unit, int units, const std::function<void()>& work)
+	{
+		const Timing timing = measure(work, m_settings.minSeconds);
+
+		BenchmarkResult result;
+		result.name = name;
+		result.blockSize = blockSize;
+		result.sampleRate = sampleRate;
+		result.channels = channels;
+		result.unit = unit;
+		result.nanoseconds = timing.nanoseconds / units;
+		result.cycles = timing.cycles / units;
+
+		std::cout << name.paddedRight(' ', 28) << juce::String(blockSize).paddedLeft(' ', 6) << juce::String(sampleRate, 0).paddedLeft(' ', 8)
+		          << juce::String(channels).paddedLeft(' ', 4) << juce::String(result.nanoseconds, 3).paddedLeft(' ', 12) << " ns/" << unit
+		          << juce::String(result.cycles, 2).paddedLeft(' ', 10) << " cycles/" << unit << std::endl;
+
+		m_results.add(result);
+	}
+
+	const BenchmarkSettings& getSettings() const { return m_settings; }
+	const juce::Array<BenchmarkResult>& getResults() const { return m_results; }
+
+private:
+	const BenchmarkSettings& m_settings;
+	juce::Array<BenchmarkResult> m_results;
+};
+
+//==============================================================================
+// White noise at -12 dBFS, so no filter state ever becomes denormal
+static juce::AudioBuffer<float> createNoise(int channels, int samples)
+{
+	juce::AudioBuffer<float> noise(channels, samples);
+	juce::Random random(1234);
+
+	for (int channel = 0; channel < channels; ++channel)
+		for (int sample = 0; sample < samples; ++sample)
+			noise.setSample(channel, sample, 0.25f * (2.0f * random.nextFloat() - 1.0f));
+
+	return noise;
+}
+
+// setup initialises a filter for a sample rate, one filter runs per channel
+template <typename Filter>
+static void benchmarkFilter(BenchmarkRunner& runner, const juce::String& name, const std::function<void(Filter&, int)>& setup)
+{
+	if (!runner.shouldRun(name))
+		return;
+
+	const auto& settings = runner.getSettings();
+
+	for (double sampleRate : settings.sampleRates)
+		for (int blockSize : settings.blockSizes)
+			for (int channels : settings.channels)
+			{
+				std::vector<Filter> filters((size_t)channels);
+
+				for (auto& filter : filters)
+					setup(filter, (int)sampleRate);
+
+				const juce::AudioBuffer<float> input = createNoise(channels, blockSize);
+				juce::AudioBuffer<float> output(channels, blockSize);
+
+				runner.run(name, blockSize, sampleRate, channels, "sample", blockSize * channels, [&] ()
+				{
+					for (int channel = 0; channel < channels; ++channel)
+					{
+						Filter& filter = filters[(size_t)channel];
+						const float* in = input.getReadPointer(channel);
+						float* out = output.getWritePointer(channel);
+
+						for (int sample = 0; sample < blockSize; ++sample)
+							out[sample] = filter.process(in[sample]);
+					}
+
+					s_sink = output.getSample(0, blockSize - 1);
+				});
+			}
+}
+
+// As benchmarkFilter, with channels in the lanes of one SIMD filter per group
+// of SIMDNumElements channels, stepped together as processBlock does
+template <typename Filter>
+static void benchmarkSIMDFilter(BenchmarkRunner& runner, const juce::String& name, const std::function<void(Filter&, int)>& setup)
+{
+	using SIMDType = typename Filter::SIMDType;
+	using SampleType = typename SIMDType::ElementType;
+
+	if (!runner.shouldRun(name))
+		return;
+
+	const auto& settings = runner.getSettings();
+	const int lanes = (int)SIMDType::SIMDNumElements;
+
+	for (double sampleRate : settings.sampleRates)
+		for (int blockSize : settings.blockSizes)
+			for (int channels : settings.channels)
+			{
+				const int numGroups = (channels + lanes - 1) / lanes;
+				std::vector<Filter> filters((size_t)numGroups);
+
+				for (auto& filter : filters)
+					setup(filter, (int)sampleRate);
+
+				const juce::AudioBuffer<float> noise = createNoise(channels, blockSize);
+				std::vector<SIMDType> input((size_t)(blockSize * numGroups), SIMDType::expand(0));
+				std::vector<SIMDType> output(input.size());
+
+				for (int sample = 0; sample < blockSize; ++sample)
+					for (int channel = 0; channel < channels; ++channel)
+						input[(size_t)(sample * numGroups + channel / lanes)].set((size_t)(channel % lanes), (SampleType)noise.getSample(channel, sample));
+
+				runner.run(name, blockSize, sampleRate, channels, "sample", blockSize * channels, [&] ()
+				{
+					for (int sample = 0; sample < blockSize; ++sample)
+						for (int group = 0; group < numGroups; ++group)
+							output[(size_t)(sample * numGroups + group)] = filters[(size_t)group].process(input[(size_t)(sample * numGroups + group)]);
+
+					s_sink = (float)output.back().get(0);
+				});
+			}
+}
+
+// The SIMD filters of one sample precision, as used by processBlock
+template <typename SampleType>
+static void benchmarkSIMDFilters(BenchmarkRunner& runner, const juce::String& suffix)
+{
+	const SampleType Q = BassEnhancerAudioProcessor::ALL_PASS_Q;
+
+	benchmarkSIMDFilter<LowPassFilter12dBSIMD<SampleType>>(runner, "LowPassFilter12dBSIMD" + suffix, [] (LowPassFilter12dBSIMD<SampleType>& filter, int sampleRate)
+	{
+		filter.init(sampleRate);
+		filter.setCoef((SampleType)TEST_FREQUENCY);
+	});
+	benchmarkSIMDFilter<LadderFilterSIMD<SampleType>>(runner, "LadderFilterSIMD" + suffix, [] (LadderFilterSIMD<SampleType>& filter, int sampleRate)
+	{
+		filter.init(sampleRate);
+		filter.setCoef((SampleType)(TEST_FREQUENCY * BassEnhancerAudioProcessor::LADDER_FILTER_FREQUENCY_FACTOR));
+		filter.setResonance(BassEnhancerAudioProcessor::LADDER_FILTER_RESONANCE);
+	});
+	benchmarkSIMDFilter<SecondOrderAllPassSIMD<SampleType>>(runner, "SecondOrderAllPassSIMD" + suffix, [Q] (SecondOrderAllPassSIMD<SampleType>& filter, int sampleRate)
+	{
+		filter.init(sampleRate);
+		filter.setCoef((SampleType)TEST_FREQUENCY, Q);
+	});
+}
+
+// As benchmarkFilter, with successive samples of one channel in the lanes
+// of one time vectorized filter per channel, as mono processBlock does
+template <typename Filter>
+static void benchmarkTimeSIMDFilter(BenchmarkRunner& runner, const juce::String& name, const std::function<void(Filter&, int)>& setup)
+{
+	using SIMDType = typename Filter::SIMDType;
+	using SampleType = typename SIMDType::ElementType;
+
+	if (!runner.shouldRun(name))
+		return;
+
+	const auto& settings = runner.getSettings();
+	const int lanes = (int)SIMDType::SIMDNumElements;
+
+	for (double sampleRate : settings.sampleRates)
+		for (int blockSize : settings.blockSizes)
+			for (int channels : settings.channels)
+			{
+				std::vector<Filter> filters((size_t)channels);
+
+				for (auto& filter : filters)
+					setup(filter, (int)sampleRate);
+
+				const juce::AudioBuffer<float> noise = createNoise(channels, blockSize);
+				juce::AudioBuffer<SampleType> input(channels, blockSize);
+				juce::AudioBuffer<SampleType> output(channels, blockSize);
+
+				for (int channel = 0; channel < channels; ++channel)
+					for (int sample = 0; sample < blockSize; ++sample)
+						input.setSample(channel, sample, (SampleType)noise.getSample(channel, sample));
+
+				// A trailing partial register is left out, the default block sizes have none
+				runner.run(name, blockSize, sampleRate, channels, "sample", blockSize * channels, [&] ()
+				{
+					for (int channel = 0; channel < channels; ++channel)
+					{
+						Filter& filter = filters[(size_t)channel];
+						const SampleType* in = input.getReadPointer(channel);
+						SampleType* out = output.getWritePointer(channel);
+
+						for (int sample = 0; sample + lanes <= blockSize; sample += lanes)
+							SIMDHelpers::store(out + sample, filter.process(SIMDHelpers::load(in + sample)));
+					}
+
+					s_sink = (float)output.getSample(0, blockSize - 1);
+				});
+			}
+}
+
+// The time vectorized filters of one sample precision, as used by mono processBlock
+template <typename SampleType>
+static void benchmarkTimeSIMDFilters(BenchmarkRunner& runner, const juce::String& suffix)
+{
+	const SampleType Q = BassEnhancerAudioProcessor::ALL_PASS_Q;
+
+	benchmarkTimeSIMDFilter<LowPassFilter12dBTimeSIMD<SampleType>>(runner, "LowPassFilter12dBTimeSIMD" + suffix, [] (LowPassFilter12dBTimeSIMD<SampleType>& filter, int sampleRate)
+	{
+		filter.init(sampleRate);
+		filter.setCoef((SampleType)TEST_FREQUENCY);
+	});
+	benchmarkTimeSIMDFilter<LadderFilterTimeSIMD<SampleType>>(runner, "LadderFilterTimeSIMD" + suffix, [] (LadderFilterTimeSIMD<SampleType>& filter, int sampleRate)
+	{
+		filter.init(sampleRate);
+		filter.setCoef((SampleType)(TEST_FREQUENCY * BassEnhancerAudioProcessor::LADDER_FILTER_FREQUENCY_FACTOR));
+		filter.setResonance(BassEnhancerAudioProcessor::LADDER_FILTER_RESONANCE);
+	});
+	benchmarkTimeSIMDFilter<SecondOrderAllPassTimeSIMD<SampleType>>(runner, "SecondOrderAllPassTimeSIMD" + suffix, [Q] (SecondOrderAllPassTimeSIMD<SampleType>& filter, int sampleRate)
+	{
+		filter.init(sampleRate);
+		filter.setCoef((SampleType)TEST_FREQUENCY, Q);
+	});
+}
+
+// Coefficient updates over a sweep of frequencies, reported per call
+template <typename Filter>
+static void benchmarkSetCoef(BenchmarkRunner& runner, const juce::String& name, const std::function<void(Filter&, float)>& setCoef)
+{
+	if (!runner.shouldRun(name))
+		return;
+
+	static const int N_FREQUENCIES = 256;
+	float frequencies[N_FREQUENCIES];
+
+	for (int i = 0; i < N_FREQUENCIES; ++i)
+		frequencies[i] = 20.0f + 480.0f * i / N_FREQUENCIES;
+
+	for (double sampleRate : runner.getSettings().sampleRates)
+	{
+		Filter filter;
+		filter.init((int)sampleRate);
+
+		runner.run(name, 0, sampleRate, 1, "call", N_FREQUENCIES, [&] ()
+		{
+			for (float frequency : frequencies)
+			{
+				setCoef(filter, frequency);
+				doNotOptimize(filter);
+			}
+		});
+	}
+}
+
+//==============================================================================
+static void setParameter(BassEnhancerAudioProcessor& processor, const juce::String& id, float value)
+{
+	auto* parameter = processor.apvts.getParameter(id);
+	jassert(parameter != nullptr);
+
+	parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+}
+
+// Float runs keep their names, so older result files still compare
+template <typename SampleType>
+static void benchmarkProcessBlock(BenchmarkRunner& runner, const juce::String& suffix)
+{
+	static const char* const buttons[N_DISTORTION_MODES] = { "ButtonA", "ButtonB", "ButtonC", "ButtonD", "ButtonE" };
+	static const char* const modeNames[N_DISTORTION_MODES] = { "processBlock A", "processBlock B", "processBlock C", "processBlock D", "processBlock E" };
+
+	const auto& settings = runner.getSettings();
+
+	// Every mode with the minimum phase prefilters, then with the linear-phase band split
+	for (int mode = 0; mode < 2 * N_DISTORTION_MODES; ++mode)
+	{
+		const bool linearPhase = mode >= N_DISTORTION_MODES;
+		const juce::String name = juce::String(modeNames[mode % N_DISTORTION_MODES]) + (linearPhase ? " linear phase" : "") + suffix;
+
+		if (!runner.shouldRun(name))
+			continue;
+
+		BassEnhancerAudioProcessor processor;
+		processor.setInstructionSetOverride(settings.instructionSet);
+		processor.setProcessingPrecision(std::is_same<SampleType, double>::value ? juce::AudioProcessor::doublePrecision : juce::AudioProcessor::singlePrecision);
+
+		// Buttons take precedence in order, so only the selected one is enabled
+		for (int button = 0; button < N_DISTORTION_MODES; ++button)
+			setParameter(processor, buttons[button], button == mode % N_DISTORTION_MODES ? 1.0f : 0.0f);
+
+		setParameter(processor, "Oversampling", (float)settings.oversampling);
+		setParameter(processor, "OversamplingOffline", (float)settings.oversampling);
+		setParameter(processor, "LinearPhase", linearPhase ? 1.0f : 0.0f);
+
+		for (double sampleRate : settings.sampleRates)
+			for (int blockSize : settings.blockSizes)
+				for (int channels : settings.channels)
+				{
+					processor.setPlayConfigDetails(channels, channels, sampleRate, blockSize);
+					processor.prepareToPlay(sampleRate, blockSize);
+
+					juce::AudioBuffer<SampleType> input;
+					input.makeCopyOf(createNoise(channels, blockSize));
+					juce::AudioBuffer<SampleType> buffer(channels, blockSize);
+					juce::MidiBuffer midiMessages;
+
+					// Processing runs in place, so every run starts from a fresh copy of the input
+					runner.run(name, blockSize, sampleRate, channels, "sample", blockSize * channels, [&] ()
+					{
+						buffer.makeCopyOf(input, true);
+						processor.processBlock(buffer, midiMessages);
+
+						s_sink = (float)buffer.getSample(0, blockSize - 1);
+					});
+
+					processor.releaseResources();
+				}
+	}
+}
+
+// Silent input after a burst of noise, with silence skipping on and off
+static void benchmarkSilence(BenchmarkRunner& runner)
+{
+	const auto& settings = runner.getSettings();
+
+	for (bool skipSilence : { false, true })
+	{
+		const juce::String name = skipSilence ? "processBlock silence skipped" : "processBlock silence";
+
+		if (!runner.shouldRun(name))
+			continue;
+
+		BassEnhancerAudioProcessor processor;
+		processor.setInstructionSetOverride(settings.instructionSet);
+		processor.setSkipSilence(skipSilence);
+
+		setParameter(processor, "Oversampling", (float)settings.oversampling);
+		setParameter(processor, "OversamplingOffline", (float)settings.oversampling);
+
+		for (double sampleRate : settings.sampleRates)
+			for (int blockSize : settings.blockSizes)
+				for (int channels : settings.channels)
+				{
+					processor.setPlayConfigDetails(channels, channels, sampleRate, blockSize);
+					processor.prepareToPlay(sampleRate, blockSize);
+
+					const juce::AudioBuffer<float> noise = createNoise(channels, blockSize);
+					juce::AudioBuffer<float> buffer(channels, blockSize);
+					juce::MidiBuffer midiMessages;
+
+					// Half a second of noise, then silence until the tail has rung out
+					const int noiseBlocks = (int)(0.5 * sampleRate / blockSize) + 1;
+					const int tailBlocks = (int)(processor.getTailLengthSeconds() * sampleRate / blockSize) + 2;
+
+					for (int i = 0; i < noiseBlocks + tailBlocks; ++i)
+					{
+						if (i < noiseBlocks)
+							buffer.makeCopyOf(noise, true);
+						else
+							buffer.clear();
+
+						processor.processBlock(buffer, midiMessages);
+					}
+
+					runner.run(name, blockSize, sampleRate, channels, "sample", blockSize * channels, [&] ()
+					{
+						buffer.clear();
+						processor.processBlock(buffer, midiMessages);
+
+						s_sink = buffer.getSample(0, blockSize - 1);
+					});
+
+					processor.releaseResources();
+				}
+	}
+}
+
+// Stereo with the chain on left and right, then once on mid
+static void benchmarkMidSide(BenchmarkRunner& runner)
+{
+	const auto& settings = runner.getSettings();
+	const int channels = 2;
+
+	for (bool midSide : { false, true })
+	{
+		const juce::String name = midSide ? "processBlock mid/side" : "processBlock left/right";
+
+		if (!runner.shouldRun(name))
+			continue;
+
+		BassEnhancerAudioProcessor processor;
+		processor.setInstructionSetOverride(settings.instructionSet);
+
+		setParameter(processor, "Oversampling", (float)settings.oversampling);
+		setParameter(processor, "OversamplingOffline", (float)settings.oversampling);
+		setParameter(processor, "MidSide", midSide ? 1.0f : 0.0f);
+
+		for (double sampleRate : settings.sampleRates)
+			for (int blockSize : settings.blockSizes)
+			{
+				processor.setPlayConfigDetails(channels, channels, sampleRate, blockSize);
+				processor.prepareToPlay(sampleRate, blockSize);
+
+				const juce::AudioBuffer<float> input = createNoise(channels, blockSize);
+				juce::AudioBuffer<float> buffer(channels, blockSize);
+				juce::MidiBuffer midiMessages;
+
+				runner.run(name, blockSize, sampleRate, channels, "sample", blockSize * channels, [&] ()
+				{
+					buffer.makeCopyOf(input, true);
+					processor.processBlock(buffer, midiMessages);
+
+					s_sink = buffer.getSample(0, blockSize - 1);
+				});
+
+				processor.releaseResources();
+			}
+	}
+}
+
+// The output meter costs nothing until something attaches to it
+static void benchmarkMeter(BenchmarkRunner& runner)
+{
+	const auto& settings = runner.getSettings();
+
+	for (bool metered : { false, true })
+	{
+		const juce::String name = metered ? "processBlock metered" : "processBlock unmetered";
+
+		if (!runner.shouldRun(name))
+			continue;
+
+		BassEnhancerAudioProcessor processor;
+		processor.setInstructionSetOverride(settings.instructionSet);
+
+		setParameter(processor, "Oversampling", (float)settings.oversampling);
+		setParameter(processor, "OversamplingOffline", (float)settings.oversampling);
+
+		if (metered)
+			processor.getMeter().attach();
+
+		for (double sampleRate : settings.sampleRates)
+			for (int blockSize : settings.blockSizes)
+				for (int channels : settings.channels)
+				{
+					processor.setPlayConfigDetails(channels, channels, sampleRate, blockSize);
+					processor.prepareToPlay(sampleRate, blockSize);
+
+					const juce::AudioBuffer<float> input = createNoise(channels, blockSize);
+					juce::AudioBuffer<float> buffer(channels, blockSize);
+					juce::MidiBuffer midiMessages;
+
+					runner.run(name, blockSize, sampleRate, channels, "sample", blockSize * channels, [&] ()
+					{
+						buffer.makeCopyOf(input, true);
+						processor.processBlock(buffer, midiMessages);
+
+						s_sink = processor.getMeter().getShortTerm();
+					});
+
+					processor.releaseResources();
+				}
+
+		if (metered)
+			processor.getMeter().detach();
+	}
+}
+
+//==============================================================================
+// ADAA against oversampling, compared on CPU and on alias level
+struct AntialiasingCase
+{
+	const char* name;
+	int oversampling;
+	int antialiasing;
+};
+
+static const AntialiasingCase antialiasingCases[] =
+{
+	{ "1x",        0, ANTIALIASING_OFF },
+	{ "1x ADAA 1", 0, ANTIALIASING_ADAA1 },
+	{ "1x ADAA 2", 0, ANTIALIASING_ADAA2 },
+	{ "2x",        1, ANTIALIASING_OFF },
+	{ "4x",        2, ANTIALIASING_OFF }
+};
+
+static const float ALIAS_TEST_FREQUENCY = 400.0f;
+static const float ALIAS_TEST_AMPLITUDE = 0.5f;
+
+// Power of everything that is not a harmonic relative to the harmonics, in dB.
+// The sine sits exactly on an odd FFT bin, which is coprime with the FFT size,
+// so after warm-up the output is periodic over the FFT length and aliases can
+// never land on a harmonic bin.
+static double measureAliasing(BassEnhancerAudioProcessor& processor, double sampleRate)
+{
+	static const int FFT_ORDER = 16;
+	const int fftSize = 1 << FFT_ORDER;
+	const int blockSize = 512;
+	const int bin = (int)(ALIAS_TEST_FREQUENCY * fftSize / sampleRate) | 1;
+
+	// One second to settle filters and smoothers, in whole blocks
+	const int warmUp = blockSize * juce::jmax(1, (int)sampleRate / blockSize);
+
+	processor.setPlayConfigDetails(1, 1, sampleRate, blockSize);
+	processor.prepareToPlay(sampleRate, blockSize);
+
+	juce::AudioBuffer<float> buffer(1, blockSize);
+	juce::MidiBuffer midiMessages;
+	std::vector<float> fftData((size_t)(2 * fftSize), 0.0f);
+
+	for (int position = 0; position < warmUp + fftSize; position += blockSize)
+	{
+		for (int sample = 0; sample < blockSize; ++sample)
+		{
+			// Phase wrapped in integers keeps the sine exactly periodic
+			const juce::int64 phase = ((juce::int64)(position + sample) * bin) % fftSize;
+			buffer.setSample(0, sample, ALIAS_TEST_AMPLITUDE * (float)std::sin(juce::MathConstants<double>::twoPi * phase / fftSize));
+		}
+
+		processor.processBlock(buffer, midiMessages);
+
+		for (int sample = 0; sample < blockSize; ++sample)
+			if (position + sample >= warmUp)
+				fftData[(size_t)(position + sample - warmUp)] = buffer.getSample(0, sample);
+	}
+
+	processor.releaseResources();
+
+	juce::dsp::FFT fft(FFT_ORDER);
+	fft.performFrequencyOnlyForwardTransform(fftData.data());
+
+	double harmonics = 0.0;
+	double aliases = 0.0;
+
+	for (int i = 1; i < fftSize / 2; ++i)
+	{
+		const double power = (double)fftData[(size_t)i] * fftData[(size_t)i];
+
+		if (i % bin == 0)
+			harmonics += power;
+		else
+			aliases += power;
+	}
+
+	return 10.0 * std::log10(juce::jmax(aliases, 1.0e-30) / juce::jmax(harmonics, 1.0e-30));
+}
+
+static void benchmarkAntialiasing(BenchmarkRunner& runner)
+{
+	static const char* const buttons[N_DISTORTION_MODES] = { "ButtonA", "ButtonB", "ButtonC", "ButtonD", "ButtonE" };
+	static const char* const modeNames[N_DISTORTION_MODES] = { "A", "B", "C", "D", "E" };
+
+	const auto& settings = runner.getSettings();
+
+	for (int mode = 0; mode < N_DISTORTION_MODES; ++mode)
+	{
+		for (const auto& antialiasingCase : antialiasingCases)
+		{
+			const juce::String name = juce::String("antialiasing ") + modeNames[mode] + " " + antialiasingCase.name;
+
+			if (!runner.shouldRun(name))
+				continue;
+
+			BassEnhancerAudioProcessor processor;
+			processor.setInstructionSetOverride(settings.instructionSet);
+
+			for (int button = 0; button < N_DISTORTION_MODES; ++button)
+				setParameter(processor, buttons[button], button == mode ? 1.0f : 0.0f);
+
+			setParameter(processor, "Frequency", ALIAS_TEST_FREQUENCY);
+			setParameter(processor, "Oversampling", (float)antialiasingCase.oversampling);
+			setParameter(processor, "OversamplingOffline", (float)antialiasingCase.oversampling);
+			setParameter(processor, "Antialiasing", (float)antialiasingCase.antialiasing);
+
+			for (double sampleRate : settings.sampleRates)
+			{
+				for (int blockSize : settings.blockSizes)
+					for (int channels : settings.channels)
+					{
+						processor.setPlayConfigDetails(channels, channels, sampleRate, blockSize);
+						processor.prepareToPlay(sampleRate, blockSize);
+
+						const juce::AudioBuffer<float> input = createNoise(channels, blockSize);
+						juce::AudioBuffer<float> buffer(channels, blockSize);
+						juce::MidiBuffer midiMessages;
+
+						runner.run(name, blockSize, sampleRate, channels, "sample", blockSize * channels, [&] ()
+						{
+							buffer.makeCopyOf(input, true);
+							processor.processBlock(buffer, midiMessages);
+
+							s_sink = buffer.getSample(0, blockSize - 1);
+						});
+
+						processor.releaseResources();
+					}
+
+				std::cout << name.paddedRight(' ', 28) << "  alias" << juce::String(sampleRate, 0).paddedLeft(' ', 8)
+				          << juce::String(measureAliasing(processor, sampleRate), 1).paddedLeft(' ', 10) << " dB" << std::endl;
+			}
+		}
+	}
+}
+
+static void runBenchmarks(BenchmarkRunner& runner)
+{
+	const float Q = BassEnhancerAudioProcessor::ALL_PASS_Q;
+
+	// Scalar filters
+	benchmarkFilter<LowPassFilter<float>>(runner, "LowPassFilter", [] (LowPassFilter<float>& filter, int sampleRate)
+	{
+		filter.init(sampleRate);
+		filter.setCoef(TEST_FREQUENCY);
+	});
+	benchmarkFilter<LowPassFilter12dB<float>>(runner, "LowPassFilter12dB", [] (LowPassFilter12dB<float>& filter, int sampleRate)
+	{
+		filter.init(sampleRate);
+		filter.setCoef(TEST_FREQUENCY);
+	});
+	benchmarkFilter<LadderFilter<float>>(runner, "LadderFilter", [] (LadderFilter<float>& filter, int sampleRate)
+	{
+		filter.init(sampleRate);
+		filter.setCoef(TEST_FREQUENCY * BassEnhancerAudioProcessor::LADDER_FILTER_FREQUENCY_FACTOR);
+		filter.setResonance(BassEnhancerAudioProcessor::LADDER_FILTER_RESONANCE);
+	});
+	benchmarkFilter<SecondOrderAllPass<float>>(runner, "SecondOrderAllPass", [Q] (SecondOrderAllPass<float>& filter, int sampleRate)
+	{
+		filter.init(sampleRate);
+		filter.setCoef(TEST_FREQUENCY, Q);
+	});
+
+	// SIMD filters as used by processBlock
+	benchmarkSIMDFilters<float>(runner, "");
+	benchmarkSIMDFilters<double>(runner, " double");
+	benchmarkTimeSIMDFilters<float>(runner, "");
+	benchmarkTimeSIMDFilters<double>(runner, " double");
+
+	// Coefficient updates
+	benchmarkSetCoef<LowPassFilter<float>>(runner, "LowPassFilter::setCoef", [] (LowPassFilter<float>& filter, float frequency)
+	{
+		filter.setCoef(frequency);
+	});
+	benchmarkSetCoef<LowPassFilter12dB<float>>(runner, "LowPassFilter12dB::setCoef", [] (LowPassFilter12dB<float>& filter, float frequency)
+	{
+		filter.setCoef(frequency);
+	});
+	benchmarkSetCoef<LadderFilter<float>>(runner, "LadderFilter::setCoef", [] (LadderFilter<float>& filter, float frequency)
+	{
+		filter.setCoef(frequency);
+	});
+	benchmarkSetCoef<SecondOrderAllPass<float>>(runner, "SecondOrderAllPass::setCoef", [Q] (SecondOrderAllPass<float>& filter, float frequency)
+	{
+		filter.setCoef(frequency, Q);
+	});
+
+	// Time vectorized filters rebuild their block matrices on every update
+	benchmarkSetCoef<LowPassFilter12dBTimeSIMD<float>>(runner, "LowPassFilter12dBTimeSIMD::setCoef", [] (LowPassFilter12dBTimeSIMD<float>& filter, float frequency)
+	{
+		filter.setCoef(frequency);
+	});
+	benchmarkSetCoef<LadderFilterTimeSIMD<float>>(runner, "LadderFilterTimeSIMD::setCoef", [] (LadderFilterTimeSIMD<float>& filter, float frequency)
+	{
+		filter.setCoef(frequency);
+	});
+	benchmarkSetCoef<SecondOrderAllPassTimeSIMD<float>>(runner, "SecondOrderAllPassTimeSIMD::setCoef", [Q] (SecondOrderAllPassTimeSIMD<float>& filter, float frequency)
+	{
+		filter.setCoef(frequency, Q);
+	});
+
+	const juce::String tableName = "FilterCoefficientTable::lookup";
+
+	if (runner.shouldRun(tableName))
+	{
+		for (double sampleRate : runner.getSettings().sampleRates)
+		{
+			FilterCoefficientTable table;
+			table.build(20.0, 500.0, 1.0, sampleRate, BassEnhancerAudioProcessor::LADDER_FILTER_FREQUENCY_FACTOR, BassEnhancerAudioProcessor::LADDER_FILTER_RESONANCE, Q);
+
+			EnhancerFilters<float> filters;
+			filters.init((int)sampleRate);
+
+			runner.run(tableName, 0, sampleRate, 1, "call", 256, [&] ()
+			{
+				for (int i = 0; i < 256; ++i)
+				{
+					filters.setCoef(table.lookup(20.0f + 1.875f * i));
+					doNotOptimize(filters);
+				}
+			});
+		}
+	}
+
+	// Whole plugin
+	benchmarkProcessBlock<float>(runner, "");
+	benchmarkProcessBlock<double>(runner, " double");
+	benchmarkSilence(runner);
+	benchmarkMidSide(runner);
+	benchmarkMeter(runner);
+	benchmarkAntialiasing(runner);
+}
+
+//==============================================================================
+static juce::var toJSON(const juce::Array<BenchmarkResult>& results, const juce::String& label, int instructionSet)
+{
+	juce::Array<juce::var> entries;
+
+	for (const auto& result : results)
+	{
+		auto* entry = new juce::DynamicObject();
+		entry->setProperty("name", result.name);
+		entry->setProperty("blockSize", result.blockSize);
+		entry->setProperty("sampleRate", result.sampleRate);
+		entry->setProperty("channels", result.channels);
+		entry->setProperty("unit", result.unit);
+		entry->setProperty("ns", result.nanoseconds);
+		entry->setProperty("cycles", result.cycles);
+		entries.add(juce::var(entry));
+	}
+
+	auto* root = new juce::DynamicObject();
+	root->setProperty("label", label);
+	root->setProperty("date", juce::Time::getCurrentTime().toISO8601(true));
+	root->setProperty("cpu", juce::SystemStats::getCpuModel());
+	root->setProperty("isa", CpuDispatch::getName(instructionSet));
+	root->setProperty("results", entries);
+
+	return juce::var(root);
+}
+
+// Prints the change against a previous run, returns the number of cases slower than threshold
+static int compareWithBaseline(const juce::Array<BenchmarkResult>& results, const juce::File& baselineFile, double threshold)
+{
+	const juce::var baseline = juce::JSON::parse(baselineFile);
+	const auto* entries = baseline["results"].getArray();
+
+	if (entries == nullptr)
+	{
+		std::cerr << "Cannot read baseline " << baselineFile.getFullPathName() << std::endl;
+		return -1;
+	}
+
+	std::map<juce::String, double> baselineTimes;
+
+	for (const auto& entry : *entries)
+	{
+		BenchmarkResult result;
+		result.name = entry["name"].toString();
+		result.blockSize = entry["blockSize"];
+		result.sampleRate = entry["sampleRate"];
+		result.channels = entry["channels"];
+		baselineTimes[result.getKey()] = entry["ns"];
+	}
+
+	std::cout << "\nComparison with " << baseline["label"].toString() << " (" << baselineFile.getFileName() << ")" << std::endl;
+
+	int regressions = 0;
+
+	for (const auto& result : results)
+	{
+		const auto it = baselineTimes.find(result.getKey());
+
+		if (it == baselineTimes.end() || it->second <= 0.0)
+			continue;
+
+		const double change = result.nanoseconds / it->second - 1.0;
+
+		if (change > threshold)
+		{
+			std::cout << "  slower " << juce::String(change * 100.0, 1).paddedLeft(' ', 7) << " %  " << result.getKey() << std::endl;
+			++regressions;
+		}
+		else if (change < -threshold)
+		{
+			std::cout << "  faster " << juce::String(-change * 100.0, 1).paddedLeft(' ', 7) << " %  " << result.getKey() << std::endl;
+		}
+	}
+
+	std::cout << regressions << " regressions above " << threshold * 100.0 << " %" << std::endl;
+	return regressions;
+}
+
+//==============================================================================
+static void printUsage()
+{
+	std::cout << "Usage: BassEnhancerBenchmark [options]\n"
+	          << "\n"
+	          << "  --filter <text>          Only run benchmarks whose name contains text\n"
+	          << "  --block-sizes <list>     Comma separated (default 16,32,...,4096)\n"
+	          << "  --sample-rates <list>    Comma separated (default 44100,48000,88200,96000,176400,192000)\n"
+	          << "  --channels <list>        Comma separated (default 1,2,6,16)\n"
+	          << "  --oversampling <index>   Oversampling choice for processBlock, 0 = 1x (default 0),\n"
+	          << "                           the antialiasing cases set their own\n"
+	          << "  --isa <name>             Kernels for every benchmark: sse2 or avx2 (default: best supported)\n"
+	          << "  --min-time <ms>          Measuring time per case (default 20)\n"
+	          << "  --output <file>          Write the results as JSON\n"
+	          << "  --label <text>           Name stored in the JSON, e.g. a commit hash\n"
+	          << "  --compare <file>         Compare with a JSON written by --output, exit code 1 on regressions\n"
+	          << "  --threshold <percent>    Change reported by --compare (default 10)\n";
+}
+
+static juce::StringArray splitList(const juce::String& list)
+{
+	return juce::StringArray::fromTokens(list, ",", "");
+}
+
+int main (int argc, char* argv[])
+{
+	juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+	BenchmarkSettings settings;
+	juce::File outputFile;
+	juce::File baselineFile;
+	juce::String label;
+	double threshold = 0.1;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const juce::String argument(argv[i]);
+		const juce::String value = (i + 1 < argc) ? juce::String(argv[i + 1]) : juce::String();
+
+		if (argument == "--help" || argument == "-h")
+		{
+			printUsage();
+			return 0;
+		}
+		else if (argument == "--filter")
+		{
+			settings.filter = value;
+			++i;
+		}
+		else if (argument == "--block-sizes")
+		{
+			settings.blockSizes.clear();
+
+			for (const auto& token : splitList(value))
+				settings.blockSizes.add(juce::jmax(1, token.getIntValue()));
+
+			++i;
+		}
+		else if (argument == "--sample-rates")
+		{
+			settings.sampleRates.clear();
+
+			for (const auto& token : splitList(value))
+				settings.sampleRates.add(juce::jmax(1.0, token.getDoubleValue()));
+
+			++i;
+		}
+		else if (argument == "--channels")
+		{
+			settings.channels.clear();
+
+			for (const auto& token : splitList(value))
+				settings.channels.add(juce::jmax(1, token.getIntValue()));
+
+			++i;
+		}
+		else if (argument == "--oversampling")
+		{
+			settings.oversampling = juce::jlimit(0, BassEnhancerAudioProcessor::N_OVERSAMPLING_FACTORS - 1, value.getIntValue());
+			++i;
+		}
+		else if (argument == "--isa")
+		{
+			settings.instructionSet = CpuDispatch::findByName(value);
+
+			if (!CpuDispatch::isSupported(settings.instructionSet))
+			{
+				std::cerr << "Instruction set " << value << " is not built or not supported by this CPU" << std::endl;
+				return 1;
+			}
+
+			++i;
+		}
+		else if (argument == "--min-time")
+		{
+			settings.minSeconds = juce::jmax(1.0, value.getDoubleValue()) * 0.001;
+			++i;
+		}
+		else if (argument == "--output")
+		{
+			outputFile = juce::File::getCurrentWorkingDirectory().getChildFile(value);
+			++i;
+		}
+		else if (argument == "--label")
+		{
+			label = value;
+			++i;
+		}
+		else if (argument == "--compare")
+		{
+			baselineFile = juce::File::getCurrentWorkingDirectory().getChildFile(value);
+			++i;
+		}
+		else if (argument == "--threshold")
+		{
+			threshold = juce::jmax(0.0, value.getDoubleValue()) * 0.01;
+			++i;
+		}
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+
+	const int instructionSet = CpuDispatch::choose(settings.instructionSet);
+	std::cout << "Kernels: " << CpuDispatch::getName(instructionSet) << std::endl;
+
+	BenchmarkRunner runner(settings);
+	runBenchmarks(runner);
+
+	if (outputFile != juce::File())
+	{
+		if (!outputFile.replaceWithText(juce::JSON::toString(toJSON(runner.getResults(), label, instructionSet))))
+		{
+			std::cerr << "Cannot write " << outputFile.getFullPathName() << std::endl;
+			return 1;
+		}
+	}
+
+	if (baselineFile != juce::File())
+		return compareWithBaseline(runner.getResults(), baselineFile, threshold) == 0 ? 0 : 1;
+
+	return 0;
+}
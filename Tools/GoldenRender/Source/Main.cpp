@@ -0,0 +1,739 @@
+/*
+  ==============================================================================
+
+    Golden-render regression check.
+
+    Renders fixed test signals through BassEnhancerAudioProcessor in every
+    distortion mode, over a grid of Frequency / Gain / Mix / Volume values
+    and sample rates, along every processing path (float, double, 64-bit
+    in a float host, oversampling, ADAA, linear phase, silence skipping,
+    the time vectorized mono kernels, mid/side, fundamental tracking).
+
+    The 1x paths of modes A-D are compared against a port of the original
+    processBlock (OriginalProcessBlock.h), so they need no stored files and
+    stay tied to the sound before any optimization. Everything else is
+    compared against reference renders in the reference folder, with the
+    tolerance of its path. --record writes those as 32 bit float WAV files,
+    and only when every case checked against the original passes first.
+
+    Every render must be free of NaN and Inf, and must not change when the
+    same input arrives in different block sizes. Any failure gives a
+    non-zero exit code, so a build can run this after every change to the
+    DSP. --original-only runs just the cases that need no references.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <iostream>
+#include "../../../Source/PluginProcessor.h"
+#include "OriginalProcessBlock.h"
+
+//==============================================================================
+struct GoldenSettings
+{
+	juce::File referenceFolder;
+	juce::Array<double> sampleRates { 44100.0, 48000.0, 96000.0 };
+	juce::String filter;
+	int instructionSet = -1;
+	bool record = false;
+	bool originalOnly = false;
+	bool verbose = false;
+};
+
+// One processing configuration, applied on top of the parameter defaults.
+// Tolerances are max abs differences relative to the reference peak, or to
+// full scale for quieter renders.
+struct RenderPath
+{
+	juce::String name;
+	juce::StringPairArray parameterValues;
+	bool doublePrecisionHost = false;
+	bool skipSilence = false;
+
+	// Rendered as a host's offline bounce
+	bool nonRealtime = false;
+
+	// The first channels of the test signal, 0 for all of them. One channel
+	// runs through the time vectorized kernels.
+	int channels = 0;
+
+	// 1x paths the original processBlock already had, up to precision and
+	// silence skipping. They are held to its port instead of a stored render.
+	bool original = false;
+
+	double referenceTolerance = 1.0e-4;
+	double blockSizeTolerance = 1.0e-6;
+};
+
+struct ParameterPoint
+{
+	float frequency = 80.0f;
+	float gain = 0.5f;
+	float mix = 1.0f;
+	float volume = 0.0f;
+
+	juce::String getName() const
+	{
+		return "F" + juce::String(frequency) + " G" + juce::String(gain) + " M" + juce::String(mix) + " V" + juce::String(volume);
+	}
+};
+
+struct RenderCase
+{
+	int mode = DISTORTION_MODE_A;
+	RenderPath path;
+	ParameterPoint point;
+	double sampleRate = 48000.0;
+
+	// Not part of the name, every instruction set is held to the same references
+	int instructionSet = -1;
+
+	bool isCheckedAgainstOriginal() const
+	{
+		return path.original && mode < DISTORTION_MODE_E;
+	}
+
+	juce::String getName() const
+	{
+		return juce::String::charToString((juce::juce_wchar)('A' + mode)) + " " + path.name + " " + point.getName() + " " + juce::String(juce::roundToInt(sampleRate));
+	}
+
+	juce::String getFileName() const
+	{
+		return getName().replaceCharacter(' ', '_') + ".wav";
+	}
+};
+
+struct CaseResult
+{
+	juce::String name;
+	juce::StringArray failures;
+	double referenceDifference = -1.0;
+	double originalDifference = -1.0;
+	double blockSizeDifference = 0.0;
+};
+
+//==============================================================================
+// Every render is prepared for this size, the block size patterns stay below it.
+// The linear-phase partitions follow the prepared size, not the calls.
+static const int MAX_BLOCK_SIZE = 1024;
+
+static const double SIGNAL_SECONDS = 0.25;
+static const double SILENCE_SECONDS = 0.1;
+
+// Covers one partial SIMD group in float and in double
+static const int CHANNELS = 5;
+
+//==============================================================================
+static void printUsage()
+{
+	std::cout << "Usage: BassEnhancerGoldenRender --references <folder> [options]\n"
+	          << "\n"
+	          << "  --references <folder>  Folder with the reference renders (required unless --original-only)\n"
+	          << "  --record               Write the references instead of comparing against them\n"
+	          << "  --original-only        Only the cases compared against the original processBlock\n"
+	          << "  --filter <text>        Only run cases whose name contains text, e.g. \"B ADAA\"\n"
+	          << "  --sample-rates <list>  Comma separated (default 44100,48000,96000)\n"
+	          << "  --isa <name>           Kernels to check: sse2 or avx2 (default: best supported)\n"
+	          << "  --verbose              Print every case, not only failures\n";
+}
+
+static juce::StringArray splitList(const juce::String& list)
+{
+	juce::StringArray tokens;
+	tokens.addTokens(list, ",", "");
+	tokens.trim();
+	tokens.removeEmptyStrings();
+
+	return tokens;
+}
+
+//==============================================================================
+static juce::Array<RenderPath> createPaths()
+{
+	juce::Array<RenderPath> paths;
+
+	auto addPath = [&] (const juce::String& name, const juce::String& parameter, const juce::String& value, double referenceTolerance)
+	{
+		RenderPath path;
+		path.name = name;
+		path.referenceTolerance = referenceTolerance;
+
+		if (parameter.isNotEmpty())
+			path.parameterValues.set(parameter, value);
+
+		paths.add(path);
+		return &paths.getReference(paths.size() - 1);
+	};
+
+	// The first path runs the whole parameter grid, the others its default point
+	addPath("float", {}, {}, 1.0e-4)->original = true;
+
+	// References are stored in float, that is all double paths can be held to
+	auto* doublePath = addPath("double", {}, {}, 1.0e-6);
+	doublePath->doublePrecisionHost = true;
+	doublePath->original = true;
+	addPath("64-bit", "DoublePrecision", "1", 1.0e-6)->original = true;
+
+	addPath("2x", "Oversampling", "1", 1.0e-4);
+	addPath("4x", "Oversampling", "2", 1.0e-4);
+
+	// ADAA2 divides by second differences, near its fallback threshold rounding moves more
+	addPath("ADAA1", "Antialiasing", "1", 1.0e-4);
+	addPath("ADAA2", "Antialiasing", "2", 1.0e-3);
+
+	addPath("linear-phase", "LinearPhase", "1", 1.0e-4);
+
+	// Skipping is decided per block, so block sizes may differ by up to the silence threshold
+	auto* skip = addPath("skip-silence", {}, {}, 1.0e-4);
+	skip->skipSilence = true;
+	skip->original = true;
+	skip->blockSizeTolerance = 2.0 * BassEnhancerAudioProcessor::SILENCE_THRESHOLD;
+
+	// Registers along time instead of channels, the stages are built again for them
+	auto addMonoPath = [&] (const juce::String& name, const juce::String& parameter, const juce::String& value, double referenceTolerance)
+	{
+		auto* path = addPath(name, parameter, value, referenceTolerance);
+		path->channels = 1;
+		return path;
+	};
+
+	addMonoPath("mono", {}, {}, 1.0e-4)->original = true;
+	auto* monoDouble = addMonoPath("mono-double", {}, {}, 1.0e-6);
+	monoDouble->doublePrecisionHost = true;
+	monoDouble->original = true;
+	addMonoPath("mono-ADAA1", "Antialiasing", "1", 1.0e-4);
+	addMonoPath("mono-ADAA2", "Antialiasing", "2", 1.0e-3);
+	addMonoPath("mono-linear-phase", "LinearPhase", "1", 1.0e-4);
+
+	// Mid through the time vectorized kernels, side dry
+	addPath("mid-side", "MidSide", "1", 1.0e-4)->channels = 2;
+	auto* midSideLinearPhase = addPath("mid-side-linear-phase", "MidSide", "1", 1.0e-4);
+	midSideLinearPhase->parameterValues.set("LinearPhase", "1");
+	midSideLinearPhase->channels = 2;
+
+	// Offline the tracker runs inline, so where Frequency moves depends on the input alone
+	auto* tracking = addPath("tracking", "Tracking", "1", 1.0e-4);
+	tracking->nonRealtime = true;
+
+	return paths;
+}
+
+// The defaults, each parameter at both ends of its range and everything hot at once
+static juce::Array<ParameterPoint> createParameterPoints()
+{
+	juce::Array<ParameterPoint> points;
+	points.add({});
+
+	ParameterPoint point;
+	point.frequency = 40.0f;  points.add(point);
+	point.frequency = 400.0f; points.add(point);
+
+	point = {};
+	point.gain = 0.0f; points.add(point);
+	point.gain = 1.0f; points.add(point);
+
+	point = {};
+	point.mix = 0.0f; points.add(point);
+	point.mix = 0.5f; points.add(point);
+
+	point = {};
+	point.volume = -24.0f; points.add(point);
+	point.volume = 24.0f;  points.add(point);
+
+	points.add({ 40.0f, 1.0f, 1.0f, 24.0f });
+
+	return points;
+}
+
+static juce::Array<RenderCase> createCases(const GoldenSettings& settings)
+{
+	const auto paths = createPaths();
+	const auto points = createParameterPoints();
+
+	juce::Array<RenderCase> cases;
+
+	for (double sampleRate : settings.sampleRates)
+		for (int mode = 0; mode < N_DISTORTION_MODES; ++mode)
+			for (int path = 0; path < paths.size(); ++path)
+				for (int point = 0; point < (path == 0 ? points.size() : 1); ++point)
+				{
+					RenderCase renderCase;
+					renderCase.mode = mode;
+					renderCase.path = paths[path];
+					renderCase.point = points[point];
+					renderCase.sampleRate = sampleRate;
+					renderCase.instructionSet = settings.instructionSet;
+
+					if (settings.originalOnly && !renderCase.isCheckedAgainstOriginal())
+						continue;
+
+					if (renderCase.getName().contains(settings.filter))
+						cases.add(renderCase);
+				}
+
+	// Recording starts only after every case checked against the original has passed
+	std::stable_partition(cases.begin(), cases.end(), [] (const RenderCase& renderCase) { return renderCase.isCheckedAgainstOriginal(); });
+
+	return cases;
+}
+
+// The reference pattern first, then every sample on its own, an odd size that
+// splits the coefficient update steps and a seeded random sequence
+static juce::Array<juce::Array<int>> createBlockSizePatterns()
+{
+	juce::Array<juce::Array<int>> patterns;
+	patterns.add({ MAX_BLOCK_SIZE });
+	patterns.add({ 1 });
+	patterns.add({ 37 });
+
+	juce::Array<int> randomSizes;
+	juce::Random random(42);
+
+	for (int i = 0; i < 64; ++i)
+		randomSizes.add(1 + random.nextInt(MAX_BLOCK_SIZE));
+
+	patterns.add(randomSizes);
+
+	return patterns;
+}
+
+//==============================================================================
+// Log sweep 20 Hz - 2 kHz, low-passed noise and gated 60 Hz bursts at full
+// scale, repeated at half level on the remaining channels, then silence
+static juce::AudioBuffer<float> createTestSignal(double sampleRate)
+{
+	const int signalSamples = juce::roundToInt(SIGNAL_SECONDS * sampleRate);
+	const int totalSamples = signalSamples + juce::roundToInt(SILENCE_SECONDS * sampleRate);
+
+	juce::AudioBuffer<float> signal(CHANNELS, totalSamples);
+	signal.clear();
+
+	const double noiseCoef = 1.0 - std::exp(-juce::MathConstants<double>::twoPi * 200.0 / sampleRate);
+	const int burstSamples = juce::roundToInt(0.05 * sampleRate);
+
+	for (int channel = 0; channel < CHANNELS; ++channel)
+	{
+		float* data = signal.getWritePointer(channel);
+		const double level = channel < 3 ? 1.0 : 0.5;
+
+		juce::Random random(1234 + channel);
+		double phase = 0.0;
+		double noise = 0.0;
+
+		for (int sample = 0; sample < signalSamples; ++sample)
+		{
+			const double time = sample / sampleRate;
+			double value = 0.0;
+
+			switch (channel % 3)
+			{
+				case 0:
+					phase += juce::MathConstants<double>::twoPi * 20.0 * std::pow(100.0, time / SIGNAL_SECONDS) / sampleRate;
+					value = 0.8 * std::sin(phase);
+					break;
+
+				case 1:
+					noise += noiseCoef * ((2.0 * random.nextDouble() - 1.0) - noise);
+					value = juce::jlimit(-1.0, 1.0, 4.0 * noise);
+					break;
+
+				default:
+					value = ((sample / burstSamples) % 2 == 0) ? std::sin(juce::MathConstants<double>::twoPi * 60.0 * time) : 0.0;
+					break;
+			}
+
+			data[sample] = (float)(level * value);
+		}
+	}
+
+	return signal;
+}
+
+//==============================================================================
+static void setParameter(BassEnhancerAudioProcessor& processor, const juce::String& id, float value)
+{
+	auto* parameter = processor.apvts.getParameter(id);
+	jassert(parameter != nullptr);
+
+	parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+}
+
+static void configure(BassEnhancerAudioProcessor& processor, const RenderCase& renderCase)
+{
+	static const char* const buttons[N_DISTORTION_MODES] = { "ButtonA", "ButtonB", "ButtonC", "ButtonD", "ButtonE" };
+
+	// Buttons take precedence in order, so only the selected one is enabled
+	for (int button = 0; button < N_DISTORTION_MODES; ++button)
+		setParameter(processor, buttons[button], button == renderCase.mode ? 1.0f : 0.0f);
+
+	setParameter(processor, "Frequency", renderCase.point.frequency);
+	setParameter(processor, "Gain", renderCase.point.gain);
+	setParameter(processor, "Mix", renderCase.point.mix);
+	setParameter(processor, "Volume", renderCase.point.volume);
+
+	for (const auto& id : renderCase.path.parameterValues.getAllKeys())
+		setParameter(processor, id, renderCase.path.parameterValues[id].getFloatValue());
+
+	processor.setSkipSilence(renderCase.path.skipSilence);
+	processor.setInstructionSetOverride(renderCase.instructionSet);
+	processor.setProcessingPrecision(renderCase.path.doublePrecisionHost ? juce::AudioProcessor::doublePrecision : juce::AudioProcessor::singlePrecision);
+}
+
+// Renders input plus the latency in blocks that cycle through blockSizes,
+// returns the output aligned with the input
+template <typename SampleType>
+static juce::AudioBuffer<float> render(const RenderCase& renderCase, const juce::AudioBuffer<float>& input, const juce::Array<int>& blockSizes)
+{
+	const int channels = renderCase.path.channels > 0 ? juce::jmin(renderCase.path.channels, input.getNumChannels()) : input.getNumChannels();
+
+	BassEnhancerAudioProcessor processor;
+	configure(processor, renderCase);
+
+	processor.setPlayConfigDetails(channels, channels, renderCase.sampleRate, MAX_BLOCK_SIZE);
+	processor.setNonRealtime(renderCase.path.nonRealtime);
+	processor.prepareToPlay(renderCase.sampleRate, MAX_BLOCK_SIZE);
+
+	const int latency = processor.getLatencySamples();
+	const int length = input.getNumSamples() + latency;
+
+	juce::AudioBuffer<SampleType> buffer(channels, length);
+	buffer.clear();
+
+	for (int channel = 0; channel < channels; ++channel)
+	{
+		const float* source = input.getReadPointer(channel);
+		SampleType* destination = buffer.getWritePointer(channel);
+
+		for (int sample = 0; sample < input.getNumSamples(); ++sample)
+			destination[sample] = (SampleType)source[sample];
+	}
+
+	juce::MidiBuffer midiMessages;
+
+	for (int start = 0, block = 0; start < length; ++block)
+	{
+		const int blockSize = juce::jmin(blockSizes[block % blockSizes.size()], length - start);
+
+		juce::AudioBuffer<SampleType> view(buffer.getArrayOfWritePointers(), channels, start, blockSize);
+		processor.processBlock(view, midiMessages);
+
+		start += blockSize;
+	}
+
+	processor.releaseResources();
+
+	juce::AudioBuffer<float> output(channels, input.getNumSamples());
+
+	for (int channel = 0; channel < channels; ++channel)
+	{
+		const SampleType* source = buffer.getReadPointer(channel, latency);
+		float* destination = output.getWritePointer(channel);
+
+		for (int sample = 0; sample < output.getNumSamples(); ++sample)
+			destination[sample] = (float)source[sample];
+	}
+
+	return output;
+}
+
+static juce::AudioBuffer<float> render(const RenderCase& renderCase, const juce::AudioBuffer<float>& input, const juce::Array<int>& blockSizes)
+{
+	if (renderCase.path.doublePrecisionHost)
+		return render<double>(renderCase, input, blockSizes);
+
+	return render<float>(renderCase, input, blockSizes);
+}
+
+// The original ran in float, the 64-bit path is held to the double port
+template <typename SampleType>
+static juce::AudioBuffer<float> renderOriginal(const RenderCase& renderCase, const juce::AudioBuffer<float>& input)
+{
+	const int channels = renderCase.path.channels > 0 ? juce::jmin(renderCase.path.channels, input.getNumChannels()) : input.getNumChannels();
+	const int samples = input.getNumSamples();
+
+	juce::AudioBuffer<SampleType> buffer(channels, samples);
+
+	for (int channel = 0; channel < channels; ++channel)
+		for (int sample = 0; sample < samples; ++sample)
+			buffer.setSample(channel, sample, (SampleType)input.getSample(channel, sample));
+
+	OriginalProcessBlock<SampleType> original(channels, renderCase.sampleRate);
+	const auto& point = renderCase.point;
+
+	for (int start = 0; start < samples; start += MAX_BLOCK_SIZE)
+		original.process(buffer, start, juce::jmin(MAX_BLOCK_SIZE, samples - start), renderCase.mode, point.frequency, point.gain, point.mix, point.volume);
+
+	juce::AudioBuffer<float> output(channels, samples);
+
+	for (int channel = 0; channel < channels; ++channel)
+		for (int sample = 0; sample < samples; ++sample)
+			output.setSample(channel, sample, (float)buffer.getSample(channel, sample));
+
+	return output;
+}
+
+static juce::AudioBuffer<float> renderOriginal(const RenderCase& renderCase, const juce::AudioBuffer<float>& input)
+{
+	if (renderCase.path.doublePrecisionHost || renderCase.path.parameterValues.containsKey("DoublePrecision"))
+		return renderOriginal<double>(renderCase, input);
+
+	return renderOriginal<float>(renderCase, input);
+}
+
+//==============================================================================
+static bool isFinite(const juce::AudioBuffer<float>& buffer)
+{
+	for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+	{
+		const float* data = buffer.getReadPointer(channel);
+
+		for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
+			if (!std::isfinite(data[sample]))
+				return false;
+	}
+
+	return true;
+}
+
+// Max abs difference relative to the reference peak, infinite when the shapes differ
+static double getDifference(const juce::AudioBuffer<float>& rendered, const juce::AudioBuffer<float>& reference)
+{
+	if (rendered.getNumChannels() != reference.getNumChannels() || rendered.getNumSamples() != reference.getNumSamples())
+		return std::numeric_limits<double>::infinity();
+
+	double difference = 0.0;
+	double peak = 1.0;
+
+	for (int channel = 0; channel < reference.getNumChannels(); ++channel)
+	{
+		const float* a = rendered.getReadPointer(channel);
+		const float* b = reference.getReadPointer(channel);
+
+		for (int sample = 0; sample < reference.getNumSamples(); ++sample)
+		{
+			difference = juce::jmax(difference, (double)std::abs(a[sample] - b[sample]));
+			peak = juce::jmax(peak, (double)std::abs(b[sample]));
+		}
+	}
+
+	return difference / peak;
+}
+
+static bool readReference(const juce::File& file, juce::AudioBuffer<float>& buffer)
+{
+	if (!file.existsAsFile())
+		return false;
+
+	juce::WavAudioFormat format;
+	std::unique_ptr<juce::AudioFormatReader> reader(format.createReaderFor(file.createInputStream().release(), true));
+
+	if (reader == nullptr)
+		return false;
+
+	buffer.setSize((int)reader->numChannels, (int)reader->lengthInSamples);
+	return reader->read(&buffer, 0, buffer.getNumSamples(), 0, true, true);
+}
+
+static bool writeReference(const juce::File& file, const juce::AudioBuffer<float>& buffer, double sampleRate)
+{
+	file.deleteFile();
+
+	juce::WavAudioFormat format;
+	auto stream = file.createOutputStream();
+
+	if (stream == nullptr)
+		return false;
+
+	// 32 bits are written as float, the renders are stored exactly
+	std::unique_ptr<juce::AudioFormatWriter> writer(format.createWriterFor(stream.get(), sampleRate, (unsigned int)buffer.getNumChannels(), 32, {}, 0));
+
+	if (writer == nullptr)
+		return false;
+
+	stream.release();
+	return writer->writeFromAudioSampleBuffer(buffer, 0, buffer.getNumSamples());
+}
+
+//==============================================================================
+static CaseResult runCase(const RenderCase& renderCase, const GoldenSettings& settings, const juce::Array<juce::Array<int>>& blockSizePatterns)
+{
+	CaseResult result;
+	result.name = renderCase.getName();
+
+	const juce::AudioBuffer<float> input = createTestSignal(renderCase.sampleRate);
+	const juce::AudioBuffer<float> rendered = render(renderCase, input, blockSizePatterns[0]);
+
+	if (!isFinite(rendered))
+		result.failures.add("NaN or Inf in output");
+
+	// The same input in other block sizes
+	for (int pattern = 1; pattern < blockSizePatterns.size(); ++pattern)
+	{
+		const auto& blockSizes = blockSizePatterns[pattern];
+		const juce::AudioBuffer<float> other = render(renderCase, input, blockSizes);
+		const juce::String patternName = blockSizes.size() == 1 ? "block size " + juce::String(blockSizes[0]) : "random block sizes";
+
+		if (!isFinite(other))
+			result.failures.add("NaN or Inf in output with " + patternName);
+
+		const double difference = getDifference(other, rendered);
+		result.blockSizeDifference = juce::jmax(result.blockSizeDifference, difference);
+
+		if (!(difference <= renderCase.path.blockSizeTolerance))
+			result.failures.add("output changes with " + patternName + " by " + juce::String(difference));
+	}
+
+	if (renderCase.isCheckedAgainstOriginal())
+	{
+		result.originalDifference = getDifference(rendered, renderOriginal(renderCase, input));
+
+		if (!(result.originalDifference <= renderCase.path.referenceTolerance))
+			result.failures.add("differs from the original processBlock by " + juce::String(result.originalDifference) + " (tolerance " + juce::String(renderCase.path.referenceTolerance) + ")");
+
+		return result;
+	}
+
+	const juce::File referenceFile = settings.referenceFolder.getChildFile(renderCase.getFileName());
+
+	if (settings.record)
+	{
+		// A broken render must not become the reference
+		if (result.failures.isEmpty() && !writeReference(referenceFile, rendered, renderCase.sampleRate))
+			result.failures.add("cannot write " + referenceFile.getFullPathName());
+
+		return result;
+	}
+
+	juce::AudioBuffer<float> reference;
+
+	if (!readReference(referenceFile, reference))
+	{
+		result.failures.add("no reference " + referenceFile.getFileName() + ", record one with --record");
+		return result;
+	}
+
+	result.referenceDifference = getDifference(rendered, reference);
+
+	if (!(result.referenceDifference <= renderCase.path.referenceTolerance))
+		result.failures.add("differs from reference by " + juce::String(result.referenceDifference) + " (tolerance " + juce::String(renderCase.path.referenceTolerance) + ")");
+
+	return result;
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+	juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+	GoldenSettings settings;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const juce::String argument(argv[i]);
+		const juce::String value = (i + 1 < argc) ? juce::String(argv[i + 1]) : juce::String();
+
+		if (argument == "--help" || argument == "-h")
+		{
+			printUsage();
+			return 0;
+		}
+		else if (argument == "--references")
+		{
+			settings.referenceFolder = juce::File::getCurrentWorkingDirectory().getChildFile(value);
+			++i;
+		}
+		else if (argument == "--record")
+		{
+			settings.record = true;
+		}
+		else if (argument == "--original-only")
+		{
+			settings.originalOnly = true;
+		}
+		else if (argument == "--filter")
+		{
+			settings.filter = value;
+			++i;
+		}
+		else if (argument == "--sample-rates")
+		{
+			settings.sampleRates.clear();
+
+			for (const auto& token : splitList(value))
+				settings.sampleRates.add(juce::jmax(8000.0, token.getDoubleValue()));
+
+			++i;
+		}
+		else if (argument == "--isa")
+		{
+			settings.instructionSet = CpuDispatch::findByName(value);
+
+			if (!CpuDispatch::isSupported(settings.instructionSet))
+			{
+				std::cerr << "Instruction set " << value << " is not built or not supported by this CPU" << std::endl;
+				return 1;
+			}
+
+			++i;
+		}
+		else if (argument == "--verbose")
+		{
+			settings.verbose = true;
+		}
+		else
+		{
+			std::cerr << "Unknown option " << argument << std::endl;
+			printUsage();
+			return 1;
+		}
+	}
+
+	if (settings.referenceFolder == juce::File() && !settings.originalOnly)
+	{
+		printUsage();
+		return 1;
+	}
+
+	if (settings.record)
+		settings.referenceFolder.createDirectory();
+
+	std::cout << "Kernels: " << CpuDispatch::getName(CpuDispatch::choose(settings.instructionSet)) << std::endl;
+
+	const auto cases = createCases(settings);
+	const auto blockSizePatterns = createBlockSizePatterns();
+	int failed = 0;
+	int originalFailed = 0;
+
+	for (const auto& renderCase : cases)
+	{
+		// A build that no longer matches the original must not record references
+		if (settings.record && originalFailed > 0 && !renderCase.isCheckedAgainstOriginal())
+		{
+			std::cerr << "\n" << originalFailed << " cases differ from the original processBlock, nothing recorded" << std::endl;
+			return 1;
+		}
+
+		const CaseResult result = runCase(renderCase, settings, blockSizePatterns);
+
+		if (!result.failures.isEmpty())
+		{
+			++failed;
+
+			if (renderCase.isCheckedAgainstOriginal())
+				++originalFailed;
+
+			for (const auto& failure : result.failures)
+				std::cerr << result.name << ": " << failure << std::endl;
+		}
+		else if (settings.verbose)
+		{
+			std::cout << result.name << ": ok, original " << result.originalDifference << ", reference " << result.referenceDifference << ", block sizes " << result.blockSizeDifference << std::endl;
+		}
+	}
+
+	std::cout << "\n" << cases.size() << " cases " << (settings.record ? "recorded" : "compared") << ", " << failed << " failed" << std::endl;
+
+	return failed == 0 ? 0 : 1;
+}
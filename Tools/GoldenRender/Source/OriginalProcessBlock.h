@@ -0,0 +1,201 @@
+/*
+  ==============================================================================
+
+    The processBlock of the plugin before any optimization, as a scalar port.
+
+    Every channel runs its own prefilter -> shaper -> ladder chain with the
+    coefficients set once per block and no parameter smoothing, exactly as
+    the original did. The 1x paths are compared against it, so SIMD,
+    coefficient tables, fast math and templating stay tied to the original
+    sound instead of to a render of an already changed build.
+
+    The float port is the original line for line, pi rounded to 3.141593f
+    included. The double port runs the same chain in double with the digits
+    of pi a double chain has, that is all the double paths changed. Mode E
+    did not exist then.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+template <typename SampleType>
+struct OriginalFilters
+{
+	static constexpr SampleType PI = std::is_same<SampleType, float>::value ? (SampleType)3.141593f : juce::MathConstants<SampleType>::pi;
+
+	struct LowPass
+	{
+		int sampleRate = 48000;
+		SampleType inCoef = 1;
+		SampleType outLastCoef = 0;
+		SampleType outLast = 0;
+		SampleType inLast = 0;
+
+		void setCoef(SampleType frequency)
+		{
+			const SampleType warp = std::tan((frequency * PI) / (SampleType)sampleRate);
+			outLastCoef = (1 - warp) / (1 + warp);
+			inCoef = warp / (1 + warp);
+		}
+
+		SampleType process(SampleType in)
+		{
+			outLast = inCoef * (in + inLast) + outLastCoef * outLast;
+			inLast = in;
+			return outLast;
+		}
+	};
+
+	struct LowPass12dB : LowPass
+	{
+		SampleType outLast2 = 0;
+
+		SampleType process(SampleType in)
+		{
+			this->outLast = this->inCoef * in + this->outLastCoef * this->outLast;
+			return outLast2 = this->inCoef * this->outLast + this->outLastCoef * outLast2;
+		}
+	};
+
+	struct Ladder
+	{
+		LowPass stages[4];
+		SampleType outLast = 0;
+		SampleType resonance = 2;
+
+		void setCoef(SampleType frequency)
+		{
+			for (auto& stage : stages)
+				stage.setCoef(frequency);
+		}
+
+		SampleType process(SampleType in)
+		{
+			SampleType lowPass = in - resonance * outLast;
+
+			for (auto& stage : stages)
+				lowPass = stage.process(lowPass);
+
+			return outLast = lowPass;
+		}
+	};
+
+	struct AllPass
+	{
+		SampleType sampleRate = 48000;
+		SampleType a1 = 0;
+		SampleType a2 = 0;
+		SampleType b0 = 0;
+		SampleType b1 = 0;
+		SampleType b2 = 1;
+		SampleType x1 = 0;
+		SampleType x2 = 0;
+		SampleType y1 = 0;
+		SampleType y2 = 0;
+
+		void setCoef(SampleType frequency, SampleType Q)
+		{
+			const SampleType bandWidth = frequency / Q;
+			const SampleType t = std::tan(PI * bandWidth / sampleRate);
+			const SampleType c = (t - 1) / (t + 1);
+			const SampleType d = -1 * std::cos(2 * PI * frequency / sampleRate);
+
+			a1 = d * (1 - c);
+			a2 = -c;
+			b0 = a2;
+			b1 = a1;
+		}
+
+		SampleType process(SampleType in)
+		{
+			const SampleType y = b0 * in + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+
+			y2 = y1;
+			y1 = y;
+			x2 = x1;
+			x1 = in;
+
+			return y;
+		}
+	};
+
+	LowPass12dB lowPass;
+	Ladder ladder;
+	AllPass allPass;
+
+	explicit OriginalFilters(int sampleRate)
+	{
+		lowPass.sampleRate = sampleRate;
+
+		for (auto& stage : ladder.stages)
+			stage.sampleRate = sampleRate;
+
+		allPass.sampleRate = (SampleType)sampleRate;
+	}
+};
+
+//==============================================================================
+// mode is DISTORTION_MODE_A..D, the buttons in order of precedence with D the fallback
+template <typename SampleType>
+class OriginalProcessBlock
+{
+public:
+	OriginalProcessBlock(int channels, double sampleRate)
+	{
+		for (int channel = 0; channel < channels; ++channel)
+			m_filters.emplace_back((int)sampleRate);
+	}
+
+	void process(juce::AudioBuffer<SampleType>& buffer, int startSample, int samples, int mode, float frequencyParameter, float gainParameter, float mixParameter, float volumeParameter)
+	{
+		const SampleType frequency = frequencyParameter;
+		const SampleType gain = juce::Decibels::decibelsToGain(gainParameter * 24.0f);
+		const SampleType mix = mixParameter;
+		const SampleType mixInverse = 1.0f - mixParameter;
+		const SampleType volume = juce::Decibels::decibelsToGain(volumeParameter);
+		const SampleType half = (SampleType)0.5;
+
+		for (int channel = 0; channel < (int)m_filters.size(); ++channel)
+		{
+			SampleType* channelBuffer = buffer.getWritePointer(channel, startSample);
+			auto& filters = m_filters[(size_t)channel];
+
+			filters.lowPass.setCoef(frequency);
+			filters.ladder.setCoef(frequency * (SampleType)1.23f);
+			filters.allPass.setCoef(frequency, (SampleType)7.0f);
+
+			for (int sample = 0; sample < samples; ++sample)
+			{
+				const SampleType in = channelBuffer[sample];
+				SampleType inDistort = 0;
+
+				if (mode == 0)
+				{
+					const SampleType inPreFilter = filters.lowPass.process(in) * gain;
+					inDistort = juce::jmax((SampleType)-1, juce::jmin((SampleType)1, inPreFilter / (1 + std::abs(inPreFilter))));
+				}
+				else
+				{
+					const SampleType inPreFilter = half * (in - filters.allPass.process(in)) * gain;
+
+					if (mode == 1)
+						inDistort = juce::jmax((SampleType)-1, juce::jmin((SampleType)1, inPreFilter / (1 + std::abs(inPreFilter))));
+					else if (mode == 2)
+						inDistort = (std::abs(inPreFilter) > (SampleType)0.25) ? ((inPreFilter >= 0) ? (SampleType)1 : (SampleType)-1) : (SampleType)0;
+					else
+						inDistort = ((inPreFilter >= 0) ? (SampleType)1 : (SampleType)-1) * std::pow(juce::jmin(std::abs(inPreFilter), (SampleType)1), (SampleType)2);
+				}
+
+				const SampleType inPostFilter = filters.ladder.process(inDistort);
+				channelBuffer[sample] = volume * (mix * inPostFilter + mixInverse * in);
+			}
+		}
+	}
+
+private:
+	std::vector<OriginalFilters<SampleType>> m_filters;
+};
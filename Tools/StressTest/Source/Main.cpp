@@ -0,0 +1,384 @@
+/*
+  ==============================================================================
+
+    Multi-instance stress test.
+
+    Creates N BassEnhancerAudioProcessor instances in one process and drives
+    them from simulated audio callbacks, paced at the real buffer period on
+    one or more threads. Reports memory per instance, the distribution of
+    callback times and how many callbacks missed their deadline.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include "../../../Source/PluginProcessor.h"
+
+#if JUCE_WINDOWS
+ #include <windows.h>
+ #include <psapi.h>
+ #pragma comment(lib, "psapi.lib")
+#elif JUCE_MAC
+ #include <mach/mach.h>
+#elif JUCE_LINUX
+ #include <cstdio>
+ #include <unistd.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+//==============================================================================
+struct StressSettings
+{
+	juce::Array<int> instanceCounts { 100 };
+	juce::StringPairArray parameterValues;
+	double sampleRate = 48000.0;
+	int blockSize = 128;
+	int channels = 2;
+	int threads = 1;
+	double seconds = 10.0;
+	bool freeRun = false;
+};
+
+struct StressResult
+{
+	int instances = 0;
+	double constructedBytesPerInstance = 0.0;
+	double preparedBytesPerInstance = 0.0;
+	double deadlineMicroseconds = 0.0;
+	double p50Microseconds = 0.0;
+	double p99Microseconds = 0.0;
+	double maxMicroseconds = 0.0;
+	int callbacks = 0;
+	int missedDeadlines = 0;
+};
+
+// Callbacks in the first half second are page faulting and warming caches
+static const double WARM_UP_SECONDS = 0.5;
+
+//==============================================================================
+static juce::int64 getResidentMemoryBytes()
+{
+#if JUCE_LINUX
+	long pages = 0, residentPages = 0;
+
+	if (FILE* statm = fopen("/proc/self/statm", "r"))
+	{
+		if (fscanf(statm, "%ld %ld", &pages, &residentPages) != 2)
+			residentPages = 0;
+
+		fclose(statm);
+	}
+
+	return (juce::int64)residentPages * sysconf(_SC_PAGESIZE);
+#elif JUCE_WINDOWS
+	PROCESS_MEMORY_COUNTERS counters;
+
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return (juce::int64)counters.WorkingSetSize;
+
+	return 0;
+#elif JUCE_MAC
+	mach_task_basic_info info;
+	mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+
+	if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) == KERN_SUCCESS)
+		return (juce::int64)info.resident_size;
+
+	return 0;
+#else
+	return 0;
+#endif
+}
+
+static bool applySettings(BassEnhancerAudioProcessor& processor, const StressSettings& settings, juce::String& error)
+{
+	for (const auto& id : settings.parameterValues.getAllKeys())
+	{
+		auto* parameter = processor.apvts.getParameter(id);
+
+		if (parameter == nullptr)
+		{
+			error = "Unknown parameter " + id;
+			return false;
+		}
+
+		const float value = settings.parameterValues[id].getFloatValue();
+		parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+	}
+
+	return true;
+}
+
+//==============================================================================
+// One simulated audio thread, processing its share of the instances in every callback
+class CallbackWorker : public juce::ThreadPoolJob
+{
+public:
+	CallbackWorker(juce::Array<BassEnhancerAudioProcessor*> processors, const StressSettings& settings, const juce::AudioBuffer<float>& input,
+	               Clock::time_point startTime, int numCallbacks)
+		: juce::ThreadPoolJob("CallbackWorker"), m_processors(processors), m_settings(settings), m_input(input),
+		  m_startTime(startTime), m_numCallbacks(numCallbacks)
+	{
+		// Every instance gets its own buffer, as in a host
+		for (int i = 0; i < m_processors.size(); ++i)
+			m_buffers.add(new juce::AudioBuffer<float>(settings.channels, settings.blockSize));
+
+		m_durations.resize((size_t)numCallbacks, 0.0);
+	}
+
+	JobStatus runJob() override
+	{
+		const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(m_settings.blockSize / m_settings.sampleRate));
+
+		for (int callback = 0; callback < m_numCallbacks && !shouldExit(); ++callback)
+		{
+			// A late callback starts right away, like a host that keeps its schedule
+			if (!m_settings.freeRun)
+				std::this_thread::sleep_until(m_startTime + callback * period);
+
+			const auto start = Clock::now();
+
+			for (int i = 0; i < m_processors.size(); ++i)
+			{
+				auto& buffer = *m_buffers[i];
+				buffer.makeCopyOf(m_input, true);
+				m_processors[i]->processBlock(buffer, m_midiMessages);
+			}
+
+			m_durations[(size_t)callback] = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+		}
+
+		return jobHasFinished;
+	}
+
+	const std::vector<double>& getDurations() const { return m_durations; }
+
+private:
+	juce::Array<BassEnhancerAudioProcessor*> m_processors;
+	juce::OwnedArray<juce::AudioBuffer<float>> m_buffers;
+	juce::MidiBuffer m_midiMessages;
+
+	const StressSettings& m_settings;
+	const juce::AudioBuffer<float>& m_input;
+	Clock::time_point m_startTime;
+	int m_numCallbacks;
+
+	std::vector<double> m_durations;
+};
+
+//==============================================================================
+static bool runStressTest(int instances, const StressSettings& settings, StressResult& result, juce::String& error)
+{
+	result.instances = instances;
+
+	// Memory
+	const juce::int64 baseMemory = getResidentMemoryBytes();
+
+	juce::OwnedArray<BassEnhancerAudioProcessor> processors;
+
+	for (int i = 0; i < instances; ++i)
+	{
+		auto* processor = processors.add(new BassEnhancerAudioProcessor());
+
+		if (!applySettings(*processor, settings, error))
+			return false;
+	}
+
+	const juce::int64 constructedMemory = getResidentMemoryBytes();
+
+	for (auto* processor : processors)
+	{
+		processor->setPlayConfigDetails(settings.channels, settings.channels, settings.sampleRate, settings.blockSize);
+		processor->prepareToPlay(settings.sampleRate, settings.blockSize);
+	}
+
+	const juce::int64 preparedMemory = getResidentMemoryBytes();
+
+	result.constructedBytesPerInstance = (double)(constructedMemory - baseMemory) / instances;
+	result.preparedBytesPerInstance = (double)(preparedMemory - baseMemory) / instances;
+
+	// Input shared by all instances, white noise at -12 dBFS
+	juce::AudioBuffer<float> input(settings.channels, settings.blockSize);
+	juce::Random random(1234);
+
+	for (int channel = 0; channel < settings.channels; ++channel)
+		for (int sample = 0; sample < settings.blockSize; ++sample)
+			input.setSample(channel, sample, 0.25f * (2.0f * random.nextFloat() - 1.0f));
+
+	// Instances are spread evenly over the callback threads
+	const int threads = juce::jmin(settings.threads, instances);
+	const double period = settings.blockSize / settings.sampleRate;
+	const int numCallbacks = juce::jmax(1, (int)(settings.seconds / period));
+	const int warmUpCallbacks = juce::jmin(numCallbacks - 1, (int)(WARM_UP_SECONDS / period));
+	const auto startTime = Clock::now() + std::chrono::milliseconds(100);
+
+	juce::OwnedArray<CallbackWorker> workers;
+	juce::ThreadPool pool(threads);
+
+	for (int thread = 0; thread < threads; ++thread)
+	{
+		juce::Array<BassEnhancerAudioProcessor*> share;
+
+		for (int i = thread; i < instances; i += threads)
+			share.add(processors[i]);
+
+		workers.add(new CallbackWorker(share, settings, input, startTime, numCallbacks));
+	}
+
+	for (auto* worker : workers)
+		pool.addJob(worker, false);
+
+	for (auto* worker : workers)
+		pool.waitForJobToFinish(worker, -1);
+
+	// All threads start a callback together, so it takes as long as the slowest one
+	std::vector<double> durations;
+
+	for (int callback = warmUpCallbacks; callback < numCallbacks; ++callback)
+	{
+		double duration = 0.0;
+
+		for (auto* worker : workers)
+			duration = juce::jmax(duration, worker->getDurations()[(size_t)callback]);
+
+		durations.push_back(duration);
+	}
+
+	result.deadlineMicroseconds = period * 1.0e6;
+	result.callbacks = (int)durations.size();
+	result.missedDeadlines = (int)std::count_if(durations.begin(), durations.end(), [&] (double duration) { return duration > result.deadlineMicroseconds; });
+
+	std::sort(durations.begin(), durations.end());
+
+	auto percentile = [&] (double fraction)
+	{
+		return durations[juce::jmin(durations.size() - 1, (size_t)(fraction * durations.size()))];
+	};
+
+	result.p50Microseconds = percentile(0.5);
+	result.p99Microseconds = percentile(0.99);
+	result.maxMicroseconds = durations.back();
+
+	for (auto* processor : processors)
+		processor->releaseResources();
+
+	return true;
+}
+
+//==============================================================================
+static void printUsage()
+{
+	std::cout << "Usage: BassEnhancerStressTest [options]\n"
+	          << "\n"
+	          << "  --instances <list>     Comma separated instance counts, each run in turn (default 100)\n"
+	          << "  --block-size <n>       Samples per callback (default 128)\n"
+	          << "  --sample-rate <hz>     Sample rate (default 48000)\n"
+	          << "  --channels <n>         Channels per instance (default 2)\n"
+	          << "  --threads <n>          Simulated audio threads sharing the instances (default 1)\n"
+	          << "  --seconds <s>          Simulated duration of every run (default 10)\n"
+	          << "  --set <id>=<value>     Set a parameter in its own units, e.g. --set Oversampling=2\n"
+	          << "  --free-run             Start every callback immediately instead of once per buffer period\n"
+	          << "\n"
+	          << "Exits with code 2 when any run missed a deadline.\n";
+}
+
+int main (int argc, char* argv[])
+{
+	juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+	StressSettings settings;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const juce::String argument(argv[i]);
+		const juce::String value = (i + 1 < argc) ? juce::String(argv[i + 1]) : juce::String();
+
+		if (argument == "--help" || argument == "-h")
+		{
+			printUsage();
+			return 0;
+		}
+		else if (argument == "--instances")
+		{
+			settings.instanceCounts.clear();
+
+			for (const auto& token : juce::StringArray::fromTokens(value, ",", ""))
+				settings.instanceCounts.add(juce::jmax(1, token.getIntValue()));
+
+			++i;
+		}
+		else if (argument == "--block-size")
+		{
+			settings.blockSize = juce::jmax(1, value.getIntValue());
+			++i;
+		}
+		else if (argument == "--sample-rate")
+		{
+			settings.sampleRate = juce::jmax(1.0, value.getDoubleValue());
+			++i;
+		}
+		else if (argument == "--channels")
+		{
+			settings.channels = juce::jmax(1, value.getIntValue());
+			++i;
+		}
+		else if (argument == "--threads")
+		{
+			settings.threads = juce::jmax(1, value.getIntValue());
+			++i;
+		}
+		else if (argument == "--seconds")
+		{
+			settings.seconds = juce::jmax(WARM_UP_SECONDS + 0.1, value.getDoubleValue());
+			++i;
+		}
+		else if (argument == "--set")
+		{
+			settings.parameterValues.set(value.upToFirstOccurrenceOf("=", false, false), value.fromFirstOccurrenceOf("=", false, false));
+			++i;
+		}
+		else if (argument == "--free-run")
+		{
+			settings.freeRun = true;
+		}
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+
+	std::cout << settings.blockSize << " samples at " << settings.sampleRate << " Hz, " << settings.channels << " channels, "
+	          << settings.threads << " threads, deadline " << juce::String(settings.blockSize / settings.sampleRate * 1.0e6, 1) << " us\n\n"
+	          << "instances   KiB/instance (constructed/prepared)     p50 us     p99 us     max us   missed" << std::endl;
+
+	bool anyMissed = false;
+
+	for (int instances : settings.instanceCounts)
+	{
+		StressResult result;
+		juce::String error;
+
+		if (!runStressTest(instances, settings, result, error))
+		{
+			std::cerr << error << std::endl;
+			return 1;
+		}
+
+		std::cout << juce::String(result.instances).paddedLeft(' ', 9)
+		          << juce::String(result.constructedBytesPerInstance / 1024.0, 1).paddedLeft(' ', 16)
+		          << " / " << juce::String(result.preparedBytesPerInstance / 1024.0, 1).paddedRight(' ', 23)
+		          << juce::String(result.p50Microseconds, 1).paddedLeft(' ', 9)
+		          << juce::String(result.p99Microseconds, 1).paddedLeft(' ', 11)
+		          << juce::String(result.maxMicroseconds, 1).paddedLeft(' ', 11)
+		          << juce::String(result.missedDeadlines).paddedLeft(' ', 9) << " of " << result.callbacks << std::endl;
+
+		anyMissed = anyMissed || result.missedDeadlines > 0;
+	}
+
+	return anyMissed ? 2 : 0;
+}